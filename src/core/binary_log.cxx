@@ -0,0 +1,302 @@
+#include "core/binary_log.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+namespace core::binlog {
+
+namespace {
+
+template <typename T>
+void append(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendText16(std::string& out, const std::string& text) {
+    auto len = static_cast<uint16_t>(std::min<std::size_t>(text.size(), UINT16_MAX));
+    append(out, len);
+    out.append(text.data(), len);
+}
+
+// 越界检查的读取辅助
+class Cursor {
+public:
+    Cursor(const char* data, std::size_t size)
+        : data_(data)
+        , size_(size) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (pos_ + sizeof(T) > size_) {
+            return false;
+        }
+        std::memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool readText(std::string& out, std::size_t len) {
+        if (pos_ + len > size_) {
+            return false;
+        }
+        out.assign(data_ + pos_, len);
+        pos_ += len;
+        return true;
+    }
+
+    std::size_t position() const { return pos_; }
+
+private:
+    const char* data_;
+    std::size_t size_;
+    std::size_t pos_{0};
+};
+
+} // namespace
+
+ThreadRing::ThreadRing(std::size_t capacity, uint32_t index)
+    : mask_([capacity]() {
+        std::size_t cap = 4096;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        return cap - 1;
+    }())
+    , index_(index)
+    , buffer_(new char[mask_ + 1]) {
+}
+
+char* ThreadRing::reserve(uint32_t size) {
+    const std::size_t capacity = mask_ + 1;
+    const uint32_t exact = size + static_cast<uint32_t>(sizeof(uint32_t));
+    const uint32_t total = (exact + 7u) & ~7u;  // 占用空间按 8 字节对齐
+    if (total > capacity / 2) {
+        return nullptr; // 单条记录过大
+    }
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    std::size_t contiguous = capacity - (head & mask_);
+
+    if (total > contiguous) {
+        // 尾部剩余空间不够：写一条填充记录，回绕到缓冲区开头
+        if (head + contiguous + total - tail > capacity) {
+            return nullptr;
+        }
+        uint32_t pad = static_cast<uint32_t>(contiguous) | kPadFlag;
+        std::memcpy(&buffer_[head & mask_], &pad, sizeof(pad));
+        head += contiguous;
+        head_.store(head, std::memory_order_release);
+    } else if (head + total - tail > capacity) {
+        return nullptr;
+    }
+
+    std::memcpy(&buffer_[head & mask_], &exact, sizeof(exact));
+    pendingHead_ = head + total;
+    return &buffer_[(head & mask_) + sizeof(uint32_t)];
+}
+
+void ThreadRing::commit() {
+    head_.store(pendingHead_, std::memory_order_release);
+}
+
+const char* levelName(uint8_t level) {
+    switch (level) {
+    case 0: return "TRACE";
+    case 1: return "DEBUG";
+    case 2: return "INFO";
+    case 3: return "WARN";
+    case 4: return "ERROR";
+    case 5: return "CRITICAL";
+    default: return "UNKNOWN";
+    }
+}
+
+std::string formatMessage(const Site& site, const char* payload, std::size_t size) {
+    Cursor in(payload, size);
+    std::ostringstream oss;
+    for (const auto& arg : site.args) {
+        switch (arg.type) {
+        case ArgType::Literal:
+            oss << arg.literal;
+            break;
+        case ArgType::Int: {
+            int64_t v = 0;
+            in.read(v);
+            oss << v;
+            break;
+        }
+        case ArgType::UInt: {
+            uint64_t v = 0;
+            in.read(v);
+            oss << v;
+            break;
+        }
+        case ArgType::Double: {
+            double v = 0;
+            in.read(v);
+            oss << v;
+            break;
+        }
+        case ArgType::Bool: {
+            char v = 0;
+            in.read(v);
+            oss << (v != 0);
+            break;
+        }
+        case ArgType::Char: {
+            char v = 0;
+            in.read(v);
+            oss << v;
+            break;
+        }
+        default: {
+            uint32_t len = 0;
+            std::string text;
+            if (in.read(len) && in.readText(text, len)) {
+                oss << text;
+            }
+            break;
+        }
+        }
+    }
+    return oss.str();
+}
+
+std::string formatLine(uint8_t level, int64_t timestampNs, std::string_view component, std::string_view message) {
+    std::time_t time = static_cast<std::time_t>(timestampNs / 1000000000);
+    std::tm tm{};
+    localtime_r(&time, &tm);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    std::string line;
+    line.reserve(64 + message.size());
+    line.append(stamp);
+    line.append(" [");
+    line.append(levelName(level));
+    line.append("] [");
+    line.append(component);
+    line.append("] ");
+    line.append(message);
+    line.push_back('\n');
+    return line;
+}
+
+void appendSiteRecord(std::string& out, const Site& site) {
+    out.push_back(static_cast<char>(kSiteRecord));
+    append(out, site.id);
+    append(out, site.level);
+    appendText16(out, site.component);
+    appendText16(out, site.file);
+    append(out, site.line);
+    append(out, static_cast<uint16_t>(site.args.size()));
+    for (const auto& arg : site.args) {
+        append(out, static_cast<uint8_t>(arg.type));
+        if (arg.type == ArgType::Literal) {
+            append(out, static_cast<uint32_t>(arg.literal.size()));
+            out.append(arg.literal);
+        }
+    }
+}
+
+bool Reader::open(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good()) {
+        error_ = "cannot open " + path;
+        return false;
+    }
+    data_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data_.size() < 16 || std::memcmp(data_.data(), kMagic, sizeof(kMagic)) != 0) {
+        error_ = "not a binary log file";
+        return false;
+    }
+    pos_ = 16;
+    return true;
+}
+
+bool Reader::readSite() {
+    Cursor in(data_.data() + pos_, data_.size() - pos_);
+    Site site;
+    uint16_t len = 0;
+    uint16_t argCount = 0;
+    if (!in.read(site.id) || !in.read(site.level) ||
+        !in.read(len) || !in.readText(site.component, len) ||
+        !in.read(len) || !in.readText(site.file, len) ||
+        !in.read(site.line) || !in.read(argCount)) {
+        return false;
+    }
+    for (uint16_t i = 0; i < argCount; ++i) {
+        SiteArg arg;
+        uint8_t type = 0;
+        if (!in.read(type)) {
+            return false;
+        }
+        arg.type = static_cast<ArgType>(type);
+        if (arg.type == ArgType::Literal) {
+            uint32_t textLen = 0;
+            if (!in.read(textLen) || !in.readText(arg.literal, textLen)) {
+                return false;
+            }
+        }
+        site.args.push_back(std::move(arg));
+    }
+    pos_ += in.position();
+
+    if (site.id >= sites_.size()) {
+        sites_.resize(site.id + 1);
+    }
+    sites_[site.id] = std::move(site);  // 同一 id 重复定义时以后者为准
+    return true;
+}
+
+bool Reader::next(Message& message) {
+    while (pos_ < data_.size()) {
+        auto type = static_cast<uint8_t>(data_[pos_++]);
+        if (type == kSiteRecord) {
+            if (!readSite()) {
+                error_ = "truncated site record";
+                return false;
+            }
+            continue;
+        }
+
+        Cursor in(data_.data() + pos_, data_.size() - pos_);
+        if (type == kDropRecord) {
+            message = Message{};
+            if (!in.read(message.timestampNs) || !in.read(message.dropped)) {
+                error_ = "truncated drop record";
+                return false;
+            }
+            pos_ += in.position();
+            return true;
+        }
+        if (type == kMessageRecord) {
+            message = Message{};
+            uint32_t size = 0;
+            if (!in.read(message.siteId) || !in.read(message.timestampNs) ||
+                !in.read(message.thread) || !in.read(size) || !in.readText(message.payload, size)) {
+                error_ = "truncated message record";
+                return false;
+            }
+            pos_ += in.position();
+            return true;
+        }
+
+        error_ = "unknown record type";
+        return false;
+    }
+    return false;
+}
+
+const Site* Reader::site(uint32_t id) const {
+    if (id == 0 || id >= sites_.size() || sites_[id].id != id) {
+        return nullptr;
+    }
+    return &sites_[id];
+}
+
+} // namespace core::binlog
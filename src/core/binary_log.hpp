@@ -0,0 +1,246 @@
+// 二进制日志格式（NanoLog 风格的延迟格式化）
+// LOG_* 调用点第一次执行时登记为一个“站点”（组件、文件、行号、每个参数的类型、字面量文本），
+// 之后每次调用只把站点 ID、时间戳和非字面量参数的原始字节拷进当前线程的环形缓冲区；
+// 文本格式化推迟到后台线程（仅控制台回显）或离线解码工具（AquaLogDecoder）
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace core::binlog {
+
+// 文件头："AQBLOG01" + 4 字节版本号 + 4 字节保留
+inline constexpr char kMagic[8] = {'A', 'Q', 'B', 'L', 'O', 'G', '0', '1'};
+inline constexpr uint32_t kVersion = 1;
+
+// 文件中的记录类型（1 字节）
+//   'S' 站点定义：u32 id, u8 level, u16+组件, u16+文件, u32 行号, u16 参数个数, 每个参数 u8 类型 [+ u32+字面量]
+//   'M' 日志消息：u32 站点 id, u64 时间戳(ns), u32 线程序号, u32 参数字节数, 参数字节
+//   'D' 丢弃通知：u64 时间戳(ns), u64 丢弃条数
+enum RecordType : uint8_t {
+    kSiteRecord = 'S',
+    kMessageRecord = 'M',
+    kDropRecord = 'D'
+};
+
+// 参数类型
+enum class ArgType : uint8_t {
+    Literal = 0,    // 字符数组（字符串字面量），文本保存在站点定义里，运行时不拷贝
+    Int = 1,        // 有符号整数 / 枚举，8 字节
+    UInt = 2,       // 无符号整数，8 字节
+    Double = 3,     // 浮点数，8 字节
+    Bool = 4,       // 1 字节
+    Char = 5,       // 1 字节
+    String = 6,     // u32 长度 + 字节
+    Other = 255     // 其他可输出到流的类型：调用线程先转成字符串，按 String 记录
+};
+
+// 站点中的单个参数描述
+struct SiteArg {
+    ArgType type{ArgType::String};
+    std::string literal;    // type == Literal 时的文本
+};
+
+// 一个 LOG_* 调用点
+struct Site {
+    uint32_t id{0};
+    uint8_t level{0};
+    std::string component;
+    std::string file;
+    uint32_t line{0};
+    std::vector<SiteArg> args;
+};
+
+// 参数类型推导（注意：字符数组按字面量处理，内容以站点第一次调用时为准）
+template <typename T>
+constexpr ArgType argTypeOf() {
+    using Raw = std::remove_cv_t<std::remove_reference_t<T>>;
+    if constexpr (std::is_array_v<Raw> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<Raw>>, char>) {
+        return ArgType::Literal;
+    } else if constexpr (std::is_same_v<Raw, bool>) {
+        return ArgType::Bool;
+    } else if constexpr (std::is_same_v<Raw, char> || std::is_same_v<Raw, signed char> || std::is_same_v<Raw, unsigned char>) {
+        return ArgType::Char;   // 与 ostream 的行为一致：按字符输出
+    } else if constexpr (std::is_enum_v<Raw>) {
+        return std::is_signed_v<std::underlying_type_t<Raw>> ? ArgType::Int : ArgType::UInt;
+    } else if constexpr (std::is_integral_v<Raw>) {
+        return std::is_signed_v<Raw> ? ArgType::Int : ArgType::UInt;
+    } else if constexpr (std::is_floating_point_v<Raw>) {
+        return ArgType::Double;
+    } else if constexpr (std::is_convertible_v<const Raw&, std::string_view>) {
+        return ArgType::String;
+    } else {
+        return ArgType::Other;
+    }
+}
+
+// 不支持直接编码的类型先转成字符串，其余原样转发
+template <typename T>
+decltype(auto) normalize(T&& value) {
+    if constexpr (argTypeOf<T>() == ArgType::Other) {
+        std::ostringstream oss;
+        oss << value;
+        return oss.str();
+    } else {
+        return std::forward<T>(value);
+    }
+}
+
+// 站点登记时描述一个参数
+template <typename T>
+SiteArg describe(const T& value) {
+    SiteArg arg;
+    arg.type = argTypeOf<const T&>();
+    if constexpr (argTypeOf<const T&>() == ArgType::Literal) {
+        arg.literal.assign(value, ::strnlen(value, sizeof(T)));
+    }
+    return arg;
+}
+
+// 参数编码后的字节数
+template <typename T>
+std::size_t encodedSize(const T& value) {
+    constexpr ArgType type = argTypeOf<const T&>();
+    if constexpr (type == ArgType::Literal) {
+        return 0;
+    } else if constexpr (type == ArgType::Bool || type == ArgType::Char) {
+        return 1;
+    } else if constexpr (type == ArgType::String) {
+        return sizeof(uint32_t) + std::string_view(value).size();
+    } else {
+        return 8;
+    }
+}
+
+template <typename T>
+char* put(char* out, const T& value) {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+// 编码一个参数，返回写入后的位置
+template <typename T>
+char* encode(char* out, const T& value) {
+    constexpr ArgType type = argTypeOf<const T&>();
+    if constexpr (type == ArgType::Literal) {
+        return out;
+    } else if constexpr (type == ArgType::Bool || type == ArgType::Char) {
+        *out = static_cast<char>(value);
+        return out + 1;
+    } else if constexpr (type == ArgType::Int) {
+        return put(out, static_cast<int64_t>(value));
+    } else if constexpr (type == ArgType::UInt) {
+        return put(out, static_cast<uint64_t>(value));
+    } else if constexpr (type == ArgType::Double) {
+        return put(out, static_cast<double>(value));
+    } else {
+        std::string_view text(value);
+        out = put(out, static_cast<uint32_t>(text.size()));
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+}
+
+// 单生产者（所属线程）/ 单消费者（日志后台线程）的字节环形缓冲区
+// 记录格式：u32 长度（含本字段）+ 内容，占用空间按 8 字节对齐；最高位为 1 表示回绕填充
+class ThreadRing {
+public:
+    ThreadRing(std::size_t capacity, uint32_t index);
+
+    uint32_t index() const { return index_; }
+
+    // 预留 size 字节的连续空间，空间不足返回 nullptr
+    char* reserve(uint32_t size);
+
+    // 提交最近一次 reserve 的记录
+    void commit();
+
+    // 消费所有已提交的记录：fn(const char* data, uint32_t size)
+    template <typename Fn>
+    std::size_t consume(Fn&& fn) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        std::size_t count = 0;
+        while (tail < head) {
+            uint32_t header;
+            std::memcpy(&header, &buffer_[tail & mask_], sizeof(header));
+            if (header & kPadFlag) {
+                tail += (header & ~kPadFlag);
+                continue;
+            }
+            fn(&buffer_[(tail & mask_) + sizeof(uint32_t)], header - static_cast<uint32_t>(sizeof(uint32_t)));
+            tail += (header + 7u) & ~7u;
+            ++count;
+        }
+        tail_.store(tail, std::memory_order_release);
+        return count;
+    }
+
+    bool empty() const {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+    std::atomic<bool> retired{false};   // 所属线程已退出，排空后可回收
+
+private:
+    static constexpr uint32_t kPadFlag = 0x80000000u;
+
+    const std::size_t mask_;
+    const uint32_t index_;
+    std::unique_ptr<char[]> buffer_;
+    alignas(64) std::atomic<uint64_t> head_{0};     // 生产者写入位置
+    alignas(64) std::atomic<uint64_t> tail_{0};     // 消费者读取位置
+    uint64_t pendingHead_{0};                       // reserve 之后、commit 之前的位置
+};
+
+// 把一条消息的参数字节按站点定义格式化为文本
+std::string formatMessage(const Site& site, const char* payload, std::size_t size);
+
+// 生成与文本日志一致的一行：2024-01-14 10:30:45 [INFO] [component] message
+std::string formatLine(uint8_t level, int64_t timestampNs, std::string_view component, std::string_view message);
+
+// 日志级别名称
+const char* levelName(uint8_t level);
+
+// 序列化一条站点定义（'S' 记录）
+void appendSiteRecord(std::string& out, const Site& site);
+
+// 顺序读取二进制日志文件（离线解码用）
+class Reader {
+public:
+    struct Message {
+        uint32_t siteId{0};
+        int64_t timestampNs{0};
+        uint32_t thread{0};
+        std::string payload;
+        uint64_t dropped{0};    // 非 0 表示这是一条丢弃通知（siteId 为 0）
+    };
+
+    // 打开文件并校验文件头
+    bool open(const std::string& path);
+
+    // 读取下一条消息（站点定义在内部登记），到文件末尾返回 false
+    bool next(Message& message);
+
+    const Site* site(uint32_t id) const;
+    const std::string& error() const { return error_; }
+
+private:
+    bool readSite();
+
+    std::string data_;
+    std::size_t pos_{0};
+    std::vector<Site> sites_;   // 下标即站点 id（从 1 开始）
+    std::string error_;
+};
+
+} // namespace core::binlog
@@ -91,21 +91,79 @@ Configuration ConfigurationManager::fromJson(const std::string& jsonText) {
             cfg.publisher.port = it->value("port", cfg.publisher.port);
             cfg.publisher.workerThreads = it->value("workerThreads", cfg.publisher.workerThreads);
             cfg.publisher.maxConnections = it->value("maxConnections", cfg.publisher.maxConnections);
+            cfg.publisher.transport = it->value("transport", cfg.publisher.transport);
+            cfg.publisher.listenerShards = it->value("listenerShards", cfg.publisher.listenerShards);
+            cfg.publisher.shmRing = it->value("shmRing", cfg.publisher.shmRing);
+            cfg.publisher.shmRingKb = it->value("shmRingKb", cfg.publisher.shmRingKb);
+            cfg.publisher.localSocket = it->value("localSocket", cfg.publisher.localSocket);
+            cfg.publisher.localAllowedUids = it->value("localAllowedUids", cfg.publisher.localAllowedUids);
+            cfg.publisher.localAllowedGids = it->value("localAllowedGids", cfg.publisher.localAllowedGids);
+            cfg.publisher.bulkChunkKb = it->value("bulkChunkKb", cfg.publisher.bulkChunkKb);
+            cfg.publisher.bulkQueueFrames = it->value("bulkQueueFrames", cfg.publisher.bulkQueueFrames);
+            cfg.publisher.controlQueueFrames = it->value("controlQueueFrames", cfg.publisher.controlQueueFrames);
+            cfg.publisher.notSentLowatKb = it->value("notSentLowatKb", cfg.publisher.notSentLowatKb);
         }
 
         if (auto it = json.find("video"); it != json.end()) {
             cfg.video.port = it->value("port", cfg.video.port);
+            cfg.video.transport = it->value("transport", cfg.video.transport);
+            cfg.video.subscriberQueuePackets = it->value("subscriberQueuePackets", cfg.video.subscriberQueuePackets);
+            cfg.video.maxPendingKb = it->value("maxPendingKb", cfg.video.maxPendingKb);
+            cfg.video.dropPolicy = it->value("dropPolicy", cfg.video.dropPolicy);
+            cfg.video.gopCache = it->value("gopCache", cfg.video.gopCache);
+            cfg.video.gopCacheFrames = it->value("gopCacheFrames", cfg.video.gopCacheFrames);
+            cfg.video.gopCacheKb = it->value("gopCacheKb", cfg.video.gopCacheKb);
+            cfg.video.relayWorkers = it->value("relayWorkers", cfg.video.relayWorkers);
+            cfg.video.relayQueuePackets = it->value("relayQueuePackets", cfg.video.relayQueuePackets);
+            cfg.video.directFanout = it->value("directFanout", cfg.video.directFanout);
+            if (auto recording = it->find("recording"); recording != it->end() && recording->is_object()) {
+                cfg.video.recording.enabled = recording->value("enabled", cfg.video.recording.enabled);
+                cfg.video.recording.directory = recording->value("directory", cfg.video.recording.directory);
+                cfg.video.recording.segmentSeconds = recording->value("segmentSeconds", cfg.video.recording.segmentSeconds);
+                cfg.video.recording.retentionHours = recording->value("retentionHours", cfg.video.recording.retentionHours);
+                cfg.video.recording.maxTotalMb = recording->value("maxTotalMb", cfg.video.recording.maxTotalMb);
+                cfg.video.recording.flushIntervalMs = recording->value("flushIntervalMs", cfg.video.recording.flushIntervalMs);
+                cfg.video.recording.queuePackets = recording->value("queuePackets", cfg.video.recording.queuePackets);
+            }
+            if (auto multicast = it->find("multicast"); multicast != it->end() && multicast->is_object()) {
+                cfg.video.multicast.enabled = multicast->value("enabled", cfg.video.multicast.enabled);
+                cfg.video.multicast.group = multicast->value("group", cfg.video.multicast.group);
+                cfg.video.multicast.basePort = multicast->value("basePort", cfg.video.multicast.basePort);
+                cfg.video.multicast.interfaceAddress = multicast->value("interfaceAddress", cfg.video.multicast.interfaceAddress);
+                cfg.video.multicast.ttl = multicast->value("ttl", cfg.video.multicast.ttl);
+                cfg.video.multicast.loopback = multicast->value("loopback", cfg.video.multicast.loopback);
+                cfg.video.multicast.nackPort = multicast->value("nackPort", cfg.video.multicast.nackPort);
+                cfg.video.multicast.mtu = multicast->value("mtu", cfg.video.multicast.mtu);
+                cfg.video.multicast.retransmitPackets = multicast->value("retransmitPackets", cfg.video.multicast.retransmitPackets);
+                cfg.video.multicast.nackRatePackets = multicast->value("nackRatePackets", cfg.video.multicast.nackRatePackets);
+            }
         }
 
         if (auto it = json.find("health"); it != json.end()) {
             cfg.health.statusFile = it->value("statusFile", cfg.health.statusFile);
             cfg.health.intervalSeconds = it->value("intervalSeconds", cfg.health.intervalSeconds);
+            cfg.health.heartbeatSeconds = it->value("heartbeatSeconds", cfg.health.heartbeatSeconds);
+            cfg.health.statusBlock = it->value("statusBlock", cfg.health.statusBlock);
+        }
+
+        if (auto it = json.find("metrics"); it != json.end()) {
+            cfg.metrics.enabled = it->value("enabled", cfg.metrics.enabled);
+            cfg.metrics.bindAddress = it->value("bindAddress", cfg.metrics.bindAddress);
+            cfg.metrics.port = it->value("port", cfg.metrics.port);
+        }
+
+        if (auto it = json.find("tracing"); it != json.end()) {
+            cfg.tracing.enabled = it->value("enabled", cfg.tracing.enabled);
+            cfg.tracing.sampleEvery = it->value("sampleEvery", cfg.tracing.sampleEvery);
+            cfg.tracing.slowFrameMs = it->value("slowFrameMs", cfg.tracing.slowFrameMs);
+            cfg.tracing.ringCapacity = it->value("ringCapacity", cfg.tracing.ringCapacity);
         }
 
         if (auto it = json.find("pipeline"); it != json.end()) {
             cfg.pipeline.realtimeIntervalSeconds = it->value("realtimeSeconds", cfg.pipeline.realtimeIntervalSeconds);
             cfg.pipeline.historicalIntervalSeconds = it->value("historicalSeconds", cfg.pipeline.historicalIntervalSeconds);
             cfg.pipeline.cacheSize = it->value("cacheSize", cfg.pipeline.cacheSize);
+            cfg.pipeline.historyHours = it->value("historyHours", cfg.pipeline.historyHours);
         }
 
         if (auto it = json.find("redis"); it != json.end()) {
@@ -118,6 +176,27 @@ Configuration ConfigurationManager::fromJson(const std::string& jsonText) {
             cfg.redis.enabled = it->value("enabled", cfg.redis.enabled);
         }
 
+        if (auto it = json.find("logging"); it != json.end()) {
+            cfg.logging.level = it->value("level", cfg.logging.level);
+            cfg.logging.file = it->value("file", cfg.logging.file);
+            cfg.logging.console = it->value("console", cfg.logging.console);
+            cfg.logging.queueCapacity = it->value("queueCapacity", cfg.logging.queueCapacity);
+            cfg.logging.flushIntervalMs = it->value("flushIntervalMs", cfg.logging.flushIntervalMs);
+            cfg.logging.format = it->value("format", cfg.logging.format);
+            cfg.logging.binaryFile = it->value("binaryFile", cfg.logging.binaryFile);
+            cfg.logging.threadBufferKb = it->value("threadBufferKb", cfg.logging.threadBufferKb);
+            cfg.logging.maxFileMb = it->value("maxFileMb", cfg.logging.maxFileMb);
+            cfg.logging.maxFileAgeHours = it->value("maxFileAgeHours", cfg.logging.maxFileAgeHours);
+            cfg.logging.keepFiles = it->value("keepFiles", cfg.logging.keepFiles);
+            cfg.logging.preallocate = it->value("preallocate", cfg.logging.preallocate);
+            if (auto components = it->find("components"); components != it->end() && components->is_object()) {
+                cfg.logging.components.clear();
+                for (const auto& [component, level] : components->items()) {
+                    cfg.logging.components[component] = level.get<std::string>();
+                }
+            }
+        }
+
     } catch (const std::exception& ex) {
         LOG_ERROR("config", "Failed to parse configuration. Using defaults. Error: ", ex.what());
     }
@@ -144,16 +223,68 @@ std::string ConfigurationManager::defaultJson() {
          {{"bindAddress", "0.0.0.0"},
           {"port", 5555},
           {"workerThreads", 4},
-          {"maxConnections", 200}}},
+          {"maxConnections", 200},
+          {"transport", "hpsocket"},
+          {"listenerShards", 0},
+          {"shmRing", ""},
+          {"shmRingKb", 4096},
+          {"localSocket", ""},
+          {"localAllowedUids", nlohmann::json::array()},
+          {"localAllowedGids", nlohmann::json::array()},
+          {"bulkChunkKb", 16},
+          {"bulkQueueFrames", 64},
+          {"controlQueueFrames", 1024},
+          {"notSentLowatKb", 64}}},
         {"video",
-         {{"port", 6000}}},
+         {{"port", 6000},
+          {"transport", "hpsocket"},
+          {"subscriberQueuePackets", 256},
+          {"maxPendingKb", 1024},
+          {"dropPolicy", "drop_oldest"},
+          {"gopCache", true},
+          {"gopCacheFrames", 250},
+          {"gopCacheKb", 8192},
+          {"relayWorkers", 2},
+          {"relayQueuePackets", 4096},
+          {"directFanout", false},
+          {"recording",
+           {{"enabled", false},
+            {"directory", "recordings"},
+            {"segmentSeconds", 60},
+            {"retentionHours", 72},
+            {"maxTotalMb", 0},
+            {"flushIntervalMs", 200},
+            {"queuePackets", 8192}}},
+          {"multicast",
+           {{"enabled", false},
+            {"group", "239.255.42.1"},
+            {"basePort", 5004},
+            {"interfaceAddress", ""},
+            {"ttl", 1},
+            {"loopback", true},
+            {"nackPort", 0},
+            {"mtu", 1400},
+            {"retransmitPackets", 1024},
+            {"nackRatePackets", 2000}}}}},
         {"health",
          {{"statusFile", "artifacts/health_status.json"},
-          {"intervalSeconds", 10}}},
+          {"intervalSeconds", 10},
+          {"heartbeatSeconds", 60},
+          {"statusBlock", ""}}},
+        {"metrics",
+         {{"enabled", false},
+          {"bindAddress", "127.0.0.1"},
+          {"port", 9464}}},
+        {"tracing",
+         {{"enabled", false},
+          {"sampleEvery", 100},
+          {"slowFrameMs", 50},
+          {"ringCapacity", 16384}}},
         {"pipeline",
          {{"realtimeSeconds", 5},
           {"historicalSeconds", 60},
-          {"cacheSize", 120}}},
+          {"cacheSize", 120},
+          {"historyHours", 168}}},
         {"redis",
          {{"host", "127.0.0.1"},
           {"port", 6379},
@@ -161,7 +292,21 @@ std::string ConfigurationManager::defaultJson() {
           {"database", 0},
           {"poolSize", 10},
           {"timeoutMs", 3000},
-          {"enabled", true}}}
+          {"enabled", true}}},
+        {"logging",
+         {{"level", "info"},
+          {"file", "logs/aqua_regulator.log"},
+          {"console", true},
+          {"queueCapacity", 8192},
+          {"flushIntervalMs", 200},
+          {"format", "text"},
+          {"binaryFile", "logs/aqua_regulator.binlog"},
+          {"threadBufferKb", 64},
+          {"components", nlohmann::json::object()},
+          {"maxFileMb", 50},
+          {"maxFileAgeHours", 24},
+          {"keepFiles", 5},
+          {"preallocate", true}}}
     };
 
     return json.dump(4);    //缩进4个空格
@@ -2,8 +2,10 @@
 
 #include <chrono>
 #include <filesystem>
+#include <map>
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace core {
 
@@ -32,17 +34,82 @@ struct PublisherConfig {
     uint16_t port = 5555;
     uint16_t workerThreads = 4; //线程数
     uint16_t maxConnections = 200;  //最大连接数
+    std::string transport = "hpsocket"; // 传输后端：hpsocket / epoll（内置的边沿触发 epoll）
+    uint16_t listenerShards = 0;    // >0 时开这么多个 SO_REUSEPORT 监听，每个一个绑核的事件循环和自己的连接分片（需要 epoll，此时不看 workerThreads）
+    std::string shmRing;            // 共享内存遥测环路径（为空不发布，建议 /dev/shm/aqua_telemetry），本机消费者只读映射
+    uint32_t shmRingKb = 4096;      // 环的数据区大小（向上取 2 的幂），单帧上限为其四分之一
+    std::string localSocket;        // 同时监听的 Unix 域套接字路径（为空不监听，需要 epoll），帧格式和命令与 TCP 相同
+    std::vector<uint32_t> localAllowedUids; // 允许连接本机套接字的用户（SO_PEERCRED 校验，与 localAllowedGids 命中其一即可）
+    std::vector<uint32_t> localAllowedGids; // 允许的组；两项都为空时只允许与本进程同一用户和 root
+    uint32_t bulkChunkKb = 16;      // 历史帧和快照按这么大的块交给传输层，命令应答和实时帧可以插在批量帧之间
+    uint32_t bulkQueueFrames = 64;  // 每个连接排队的历史帧和快照上限，满了丢最旧的
+    uint32_t controlQueueFrames = 1024; // 每个连接排队的应答和实时帧上限，超过说明客户端不读了，断开连接
+    uint32_t notSentLowatKb = 64;   // 每个连接内核里未发出数据的上限（TCP_NOTSENT_LOWAT，需要 epoll），否则几 MB 的内核缓冲区会排在应答前面；0 为内核默认
+};
+
+// 视频录像配置
+struct VideoRecordingConfig {
+    bool enabled = false;
+    std::string directory = "recordings";   // 每路流一个子目录
+    uint32_t segmentSeconds = 60;           // 分段时长（分帧流在到时后的下一个关键帧处切段）
+    uint32_t retentionHours = 72;           // 超过这么久的段删除（0 表示不按时间删除）
+    uint32_t maxTotalMb = 0;                // 所有录像的总大小上限，超过后从最旧的段删起（0 表示不限）
+    uint32_t flushIntervalMs = 200;         // 后台线程攒批写盘的间隔
+    uint32_t queuePackets = 8192;           // 转发路径到录像线程的队列长度，满了丢弃并计数
+};
+
+// 视频组播出口配置（局域网订阅端加入组播组，远程订阅端仍走 TCP）
+struct VideoMulticastConfig {
+    bool enabled = false;
+    std::string group = "239.255.42.1";     // 组播地址，各路流共用，按端口区分
+    uint16_t basePort = 5004;               // 流编号 n 的端口为 basePort + 2 * ((n - 1) % 256)，被还在使用的流占着时顺延
+    std::string interfaceAddress;           // 发送网卡地址（为空由系统选择，回环测试用 127.0.0.1）
+    uint32_t ttl = 1;                       // 组播 TTL（1 表示不出本网段）
+    bool loopback = true;                   // 本机的接收端也能收到（IP_MULTICAST_LOOP）
+    uint16_t nackPort = 0;                  // 发送组播和接收 NACK 的本地端口（0 表示随机）
+    uint32_t mtu = 1400;                    // 单个 UDP 报文（含 RTP 头）的最大字节数
+    uint32_t retransmitPackets = 1024;      // 每路流保留可重传的报文数
+    uint32_t nackRatePackets = 2000;        // 每个接收端地址每秒最多重传的报文数（NACK 可被伪造，防止被当成放大器）
 };
 
 // 视频模块配置
 struct VideoConfig {
     uint16_t port = 6000;
+    std::string transport = "hpsocket";     // 传输后端：hpsocket / epoll
+    uint32_t subscriberQueuePackets = 256;  // 每个订阅端最多排队的包数
+    uint32_t maxPendingKb = 1024;           // 每个订阅端交给传输层但未发出的数据上限，超过后先在队列里等
+    std::string dropPolicy = "drop_oldest"; // 队列满时：drop_oldest / drop_until_keyframe / disconnect
+    bool gopCache = true;                   // 缓存每路分帧流最近的 GOP，新订阅端从关键帧开始播放
+    uint32_t gopCacheFrames = 250;          // 每路 GOP 缓存的帧数上限（不超过订阅端队列长度）
+    uint32_t gopCacheKb = 8192;             // 每路 GOP 缓存的字节上限，超过后丢掉缓存等下一个关键帧
+    uint32_t relayWorkers = 2;              // 转发线程数，各路流按流名哈希分到其中一个
+    uint32_t relayQueuePackets = 4096;      // 每个转发线程最多排队的包数，满了丢弃新到的包
+    bool directFanout = false;              // 在推流端的接收回调里直接分发给订阅端，不经过转发线程
+    VideoRecordingConfig recording;
+    VideoMulticastConfig multicast;
 };
 
 // 健康监控配置
 struct HealthConfig {
     std::string statusFile = "artifacts/health_status.json";
     uint16_t intervalSeconds = 5;
+    uint16_t heartbeatSeconds = 60; // 状态没变化时最长隔多久重写一次文件（0 表示只在变化时写）
+    std::string statusBlock;        // mmap 二进制状态块路径（为空不发布，建议 /dev/shm/aqua_health）
+};
+
+// 指标 HTTP 端口配置（/metrics、/health）
+struct MetricsConfig {
+    bool enabled = false;
+    std::string bindAddress = "127.0.0.1";  // 默认只监听本机
+    uint16_t port = 9464;
+};
+
+// 帧延迟追踪配置
+struct TracingConfig {
+    bool enabled = false;
+    uint32_t sampleEvery = 100;     // 每 100 帧完整记录 1 帧（0 表示只记录慢帧）
+    uint32_t slowFrameMs = 50;      // 超过该耗时的帧总会被记录
+    uint32_t ringCapacity = 16384;  // 环形缓冲区事件数
 };
 
 // 数据采集管道配置（modbus传感器）
@@ -50,6 +117,7 @@ struct PipelineConfig {
     uint16_t realtimeIntervalSeconds = 5;   // 实时数据每 5 秒采集一次
     uint16_t historicalIntervalSeconds = 30;    // 历史数据每 30 秒采集一次
     uint16_t cacheSize = 120;   //// 缓存 120 条数据
+    uint16_t historyHours = 168;    // 内存压缩历史保留时长（小时，默认一周）
 };
 
 // Redis 配置
@@ -63,6 +131,23 @@ struct RedisConfig {
     bool enabled = true;            // 是否启用 Redis
 };
 
+// 日志配置
+struct LoggingConfig {
+    std::string level = "info";     // trace/debug/info/warn/error/critical
+    std::string file = "logs/aqua_regulator.log";
+    bool console = true;            // 是否同时输出到控制台
+    uint32_t queueCapacity = 8192;  // 异步队列容量（条），满了丢弃并计数
+    uint16_t flushIntervalMs = 200; // 后台线程攒批写出的最长间隔
+    std::string format = "text";    // text：文本日志；binary：二进制日志（用 AquaLogDecoder 解码）
+    std::string binaryFile = "logs/aqua_regulator.binlog";
+    uint32_t threadBufferKb = 64;   // 二进制模式下每个线程的环形缓冲区大小（KB）
+    std::map<std::string, std::string> components;  // 按组件覆盖级别，如 {"redis_client": "debug"}
+    uint32_t maxFileMb = 50;        // 单个日志文件超过该大小就轮转（0 表示不限）
+    uint32_t maxFileAgeHours = 24;  // 单个日志文件写满该时长就轮转（0 表示不限）
+    uint32_t keepFiles = 5;         // 保留的历史日志文件个数
+    bool preallocate = true;        // 预分配日志文件的磁盘空间
+};
+
 // 聚合所有配置
 struct Configuration {
     DatabaseConfig database;
@@ -70,8 +155,11 @@ struct Configuration {
     PublisherConfig publisher;
     VideoConfig video;
     HealthConfig health;
+    MetricsConfig metrics;
+    TracingConfig tracing;
     PipelineConfig pipeline;
     RedisConfig redis;
+    LoggingConfig logging;
 };
 
 // 配置管理器
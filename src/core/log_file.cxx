@@ -0,0 +1,194 @@
+#include "core/log_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace core {
+
+namespace {
+
+constexpr uint64_t kPreallocateChunk = 8 * 1024 * 1024;    // 每次预分配 8MB（不超过 maxBytes）
+
+// 已有文件的创建时间（文件系统不记录时退回修改时间），用来接着算按时间轮转的年龄
+std::chrono::system_clock::time_point fileBirth(int fd, const struct stat& st)
+{
+#if defined(STATX_BTIME)
+    struct statx stx{};
+    if (::statx(fd, "", AT_EMPTY_PATH, STATX_BTIME, &stx) == 0 && (stx.stx_mask & STATX_BTIME) != 0)
+    {
+        return std::chrono::system_clock::time_point(
+            std::chrono::seconds(stx.stx_btime.tv_sec) + std::chrono::nanoseconds(stx.stx_btime.tv_nsec));
+    }
+#else
+    (void)fd;
+#endif
+    return std::chrono::system_clock::time_point(
+        std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec));
+}
+
+} // namespace
+
+LogFile::~LogFile()
+{
+    close();
+}
+
+bool LogFile::open(const std::string& path, const LogRotation& rotation)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    // O_APPEND：每次 write 都追加到文件末尾
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    close();
+    struct stat st{};
+    const bool statOk = ::fstat(fd, &st) == 0;
+    fd_ = fd;
+    path_ = path;
+    rotation_ = rotation;
+    bytes_ = statOk ? static_cast<uint64_t>(st.st_size) : 0;
+    allocated_ = bytes_;
+    retryAfter_ = 0;
+    openedAt_ = std::chrono::steady_clock::now();
+    // 重启后接着写已有文件：年龄从文件创建时算起，而不是从进程启动算起
+    if (statOk && bytes_ > 0)
+    {
+        const auto age = std::chrono::system_clock::now() - fileBirth(fd, st);
+        if (age > std::chrono::system_clock::duration::zero())
+        {
+            openedAt_ -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+        }
+    }
+    return true;
+}
+
+void LogFile::close()
+{
+    if (fd_ < 0)
+    {
+        return;
+    }
+    // KEEP_SIZE 预分配的块在文件末尾之后，截断到实际长度把它们还给文件系统
+    if (allocated_ > bytes_)
+    {
+        [[maybe_unused]] int rc = ::ftruncate(fd_, static_cast<off_t>(bytes_));
+    }
+    ::close(fd_);
+    fd_ = -1;
+    bytes_ = 0;
+    allocated_ = 0;
+}
+
+void LogFile::reserve(std::size_t size)
+{
+#if defined(__linux__)
+    if (!rotation_.preallocate || bytes_ + size <= allocated_ || bytes_ < retryAfter_)
+    {
+        return;
+    }
+    uint64_t chunk = std::max<uint64_t>(kPreallocateChunk, size);
+    if (rotation_.maxBytes > 0 && rotation_.maxBytes > bytes_)
+    {
+        chunk = std::min(chunk, std::max<uint64_t>(rotation_.maxBytes - bytes_, size));
+    }
+    if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(bytes_), static_cast<off_t>(chunk)) == 0)
+    {
+        allocated_ = bytes_ + chunk;
+    }
+    else if (errno == EOPNOTSUPP || errno == ENOSYS)
+    {
+        // 文件系统或内核不支持（如 tmpfs 的旧内核）：不再尝试
+        rotation_.preallocate = false;
+    }
+    else
+    {
+        // 暂时失败（磁盘满、配额等）：照常写，再写满一块后重试
+        retryAfter_ = bytes_ + chunk;
+    }
+#else
+    (void)size;
+#endif
+}
+
+void LogFile::write(const char* data, std::size_t size)
+{
+    if (fd_ < 0 || size == 0)
+    {
+        return;
+    }
+    reserve(size);
+
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd_, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        bytes_ += static_cast<uint64_t>(n);
+    }
+}
+
+bool LogFile::rotationDue(std::chrono::steady_clock::time_point now) const
+{
+    if (fd_ < 0 || bytes_ == 0)
+    {
+        return false;
+    }
+    if (rotation_.maxBytes > 0 && bytes_ >= rotation_.maxBytes)
+    {
+        return true;
+    }
+    return rotation_.maxAge.count() > 0 && now - openedAt_ >= rotation_.maxAge;
+}
+
+bool LogFile::rotate()
+{
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    // 历史文件依次后移，最旧的一个被覆盖（keepFiles 为 0 时直接删除当前文件）
+    if (rotation_.keepFiles == 0)
+    {
+        std::remove(path_.c_str());
+    }
+    else
+    {
+        for (uint32_t i = rotation_.keepFiles; i > 1; --i)
+        {
+            std::rename((path_ + "." + std::to_string(i - 1)).c_str(), (path_ + "." + std::to_string(i)).c_str());
+        }
+        std::rename(path_.c_str(), (path_ + ".1").c_str());
+    }
+
+    // 旧 fd 仍指向改名后的文件，新文件打开成功后再切换
+    const std::string path = path_;
+    const LogRotation rotation = rotation_;
+    if (!open(path, rotation))
+    {
+        openedAt_ = std::chrono::steady_clock::now();   // 避免每一轮都重试
+        return false;
+    }
+    return true;
+}
+
+} // namespace core
@@ -0,0 +1,65 @@
+// 日志文件：按大小 / 时间轮转，保留固定个数的历史文件
+// 活动文件用 fallocate 预分配磁盘空间（KEEP_SIZE，不改变文件长度），追加写入时不必每次分配新块；
+// 轮转时先把当前文件改名为 path.1（已打开的 fd 跟随 inode，不丢数据），再打开新的 path
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace core {
+
+// 轮转参数（0 表示不按该条件轮转）
+struct LogRotation {
+    uint64_t maxBytes{0};               // 单个文件的最大字节数
+    std::chrono::seconds maxAge{0};     // 单个文件的最长写入时间
+    uint32_t keepFiles{5};              // 保留的历史文件个数（path.1 ~ path.N）
+    bool preallocate{true};             // 是否预分配磁盘空间
+};
+
+// 只由日志后台线程（持有 drainMutex_）访问，不做内部加锁
+class LogFile {
+public:
+    LogFile() = default;
+    ~LogFile();
+
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    // 以追加方式打开（已打开则先关闭旧文件），必要时创建目录
+    bool open(const std::string& path, const LogRotation& rotation);
+
+    // 关闭文件并释放未用完的预分配空间
+    void close();
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // 当前文件的长度（字节）
+    uint64_t size() const { return bytes_; }
+
+    // 追加写入（处理 EINTR 和部分写）
+    void write(const char* data, std::size_t size);
+
+    // 到达大小或时间阈值（且文件非空）
+    bool rotationDue(std::chrono::steady_clock::time_point now) const;
+
+    // 轮转：path.(N-1) -> path.N ... path -> path.1，然后打开新的 path
+    // 打开新文件失败时继续写旧的 fd，返回 false
+    bool rotate();
+
+private:
+    // 写入前确保预分配的空间足够
+    void reserve(std::size_t size);
+
+    std::string path_;
+    LogRotation rotation_;
+    int fd_{-1};
+    uint64_t bytes_{0};         // 文件长度
+    uint64_t allocated_{0};     // 已预分配到的位置
+    uint64_t retryAfter_{0};    // 预分配暂时失败后，写到这个位置再重试
+    std::chrono::steady_clock::time_point openedAt_{};   // 文件的起始时刻（已有文件按创建时间折算）
+};
+
+} // namespace core
@@ -1,42 +1,274 @@
 #include "core/logger.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
 #include <ctime>
-#include <filesystem>
-#include <iostream>
+#include <exception>
+
+#include <unistd.h>
 
 namespace core {
 
+namespace {
+
+constexpr std::size_t kBatchBytes = 64 * 1024;      // 批量缓冲区达到该大小就写出一次
+constexpr std::size_t kMaxMessageBytes = 4096;      // 单条日志的最大长度（保证内存有界）
+
+// 把整个缓冲区写到 fd（处理 EINTR 和部分写）
+void writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+} // namespace
+
 //单例
-Logger& Logger::instance() 
+Logger& Logger::instance()
 {
     // C++11 保证线程安全的静态初始化
-    //从 C++11 开始，标准规定了：如果多个线程试图同时初始化同一个静态局部变量，初始化行为会序列化发生。 
+    //从 C++11 开始，标准规定了：如果多个线程试图同时初始化同一个静态局部变量，初始化行为会序列化发生。
     //也就是说，编译器会自动帮你加锁，确保只有一个线程执行构造，其他线程会阻塞等待直到构造完成
     static Logger instance; // static 变量在第一次调用instance时初始化，之后返回同一个实例
     return instance;
 }
 
-//配置方法（设置最低日志级别、打印到哪个文件、是否要输出到控制台）
-void Logger::configure(LogLevel level, const std::string& filePath, bool useConsole) 
+Logger::~Logger()
+{
+    shutdown();
+}
+
+std::optional<LogLevel> tryParseLogLevel(std::string_view text)
+{
+    std::string lower(text);
+    for (auto& c : lower)
+    {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (lower == "trace") return LogLevel::Trace;
+    if (lower == "debug") return LogLevel::Debug;
+    if (lower == "info") return LogLevel::Info;
+    if (lower == "warn" || lower == "warning") return LogLevel::Warn;
+    if (lower == "error") return LogLevel::Error;
+    if (lower == "critical") return LogLevel::Critical;
+    return std::nullopt;
+}
+
+LogLevel parseLogLevel(std::string_view text, LogLevel fallback)
 {
+    return tryParseLogLevel(text).value_or(fallback);
+}
+
+uint16_t Logger::resolveComponent(std::string_view component)
+{
+    // 表项只追加不删除，名字在发布（componentCount_ 的 release 写）之后不再修改
+    const std::size_t len = std::min(component.size(), sizeof(ComponentEntry::name) - 1);
+    auto find = [&](std::size_t count) -> uint16_t {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const char* name = components_[i].name;
+            if (std::strlen(name) == len && std::memcmp(name, component.data(), len) == 0)
+            {
+                return static_cast<uint16_t>(i + 1);
+            }
+        }
+        return 0;
+    };
+
+    if (uint16_t slot = find(componentCount_.load(std::memory_order_acquire)); slot != 0)
+    {
+        return slot;
+    }
+
+    std::lock_guard<std::mutex> lk(componentsMutex_);
+    const std::size_t count = componentCount_.load(std::memory_order_relaxed);
+    if (uint16_t slot = find(count); slot != 0)
+    {
+        return slot;
+    }
+    if (count >= kMaxComponents)
+    {
+        return kNoComponent;
+    }
+    std::memcpy(components_[count].name, component.data(), len);
+    componentCount_.store(static_cast<uint16_t>(count + 1), std::memory_order_release);
+    return static_cast<uint16_t>(count + 1);
+}
+
+bool Logger::setComponentLevel(std::string_view component, std::optional<LogLevel> level)
+{
+    uint16_t slot = resolveComponent(component);
+    if (slot == kNoComponent)
+    {
+        return false;
+    }
+    components_[slot - 1].level.store(level ? static_cast<uint8_t>(*level) : kInheritLevel,
+                                      std::memory_order_relaxed);
+    return true;
+}
+
+bool Logger::hasComponent(std::string_view component) const
+{
+    const std::size_t len = std::min(component.size(), sizeof(ComponentEntry::name) - 1);
+    const std::size_t count = componentCount_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const char* name = components_[i].name;
+        if (std::strlen(name) == len && std::memcmp(name, component.data(), len) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::pair<std::string, LogLevel>> Logger::componentLevels() const
+{
+    std::vector<std::pair<std::string, LogLevel>> result;
+    const std::size_t count = componentCount_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        uint8_t level = components_[i].level.load(std::memory_order_relaxed);
+        if (level != kInheritLevel)
+        {
+            result.emplace_back(components_[i].name, static_cast<LogLevel>(level));
+        }
+    }
+    return result;
+}
+
+void Logger::configure(LogLevel level, const std::string& filePath, bool useConsole)
+{
+    LoggerOptions options;
+    options.level = level;
+    options.filePath = filePath;
+    options.useConsole = useConsole;
+    configure(options);
+}
+
+//配置方法（设置最低日志级别、打印到哪个文件、是否要输出到控制台、队列容量、攒批间隔）
+void Logger::configure(const LoggerOptions& options)
+{
+    std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+
+    // 如果后台线程已经在运行，先停下来并排空队列，保证旧配置下的日志写到旧文件
+    if (running_.exchange(false))
+    {
+        wakeCv_.notify_all();
+        if (writer_.joinable())
+        {
+            writer_.join();
+        }
+    }
+
     // 设置最低级别（原子操作）
-    minLevel_.store(level);
-    consoleEnabled_ = useConsole;   //设置是否输出到控制台
+    minLevel_.store(options.level);
+    flushInterval_ = options.flushInterval;
+
+    // 按组件的级别：先全部恢复为跟随全局级别，再应用配置
+    const std::size_t componentCount = componentCount_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < componentCount; ++i)
+    {
+        components_[i].level.store(kInheritLevel, std::memory_order_relaxed);
+    }
+    for (const auto& [component, level] : options.componentLevels)
+    {
+        setComponentLevel(component, level);
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(drainMutex_);
+        drain();
+        drainBinary();
+        writeOut();
+
+        consoleEnabled_ = options.useConsole;   //设置是否输出到控制台
+
+        // 如果指定了文件路径（传入的path不为空），打开文件（按需创建多级目录）
+        if (!options.filePath.empty())
+        {
+            textFile_.open(options.filePath, options.rotation);
+        }
+
+        // 二进制日志文件
+        if (options.binary && !options.binaryPath.empty() && binaryFile_.open(options.binaryPath, options.rotation))
+        {
+            startBinaryFile();
+        }
+        {
+            std::lock_guard<std::mutex> ringsLock(ringsMutex_);
+            threadBufferBytes_ = options.threadBufferBytes;
+        }
+        binary_.store(options.binary && binaryFile_.isOpen());
+    }
+
+    // 队列只创建一次：生产者线程随时可能在投递，不能中途替换
+    if (!queue_)
+    {
+        queue_ = std::make_unique<BoundedMpmcQueue<Record>>(options.queueCapacity);
+        batch_.reserve(kBatchBytes * 2);
+        installCrashHandlers();
+    }
+
+    running_ = true;
+    writer_ = std::thread(&Logger::writerLoop, this);
+}
 
-    // 如果指定了文件路径（传入的path不为空），打开文件
-    if (!filePath.empty()) 
+void Logger::flush()
+{
+    if (!running_)
     {
-        // 创建多级目录（指的是如果路径为data/logs/v1这样三级目录,但是此时只有data一级，则调用创建多级目录创建这个三级的）（如果存在就返回false，在这里不影响）
-        std::filesystem::create_directories(std::filesystem::path(filePath).parent_path()); 
-        fileStream_.open(filePath, std::ios::out | std::ios::app);  //打开模式：输出（写入文件）、append（每次写入追加到文件末尾）
-        fileEnabled_ = fileStream_.is_open();   //文件如果打开，则是否输出到文件置为true
+        std::lock_guard<std::mutex> lk(drainMutex_);
+        drain();
+        drainBinary();
+        reportDrops();
+        writeOut();
+        return;
     }
+
+    // 等后台线程完整地跑完一轮在本次调用之后开始的写出（当前这一轮可能已经取完了队列）
+    std::unique_lock<std::mutex> lk(wakeMutex_);
+    const uint64_t target = cycles_.load() + 2;
+    flushRequested_ = true;
+    wakeCv_.notify_one();
+    flushedCv_.wait(lk, [&]() { return cycles_.load() >= target || !running_; });
+}
+
+void Logger::shutdown()
+{
+    std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+    if (running_.exchange(false))
+    {
+        wakeCv_.notify_all();
+        if (writer_.joinable())
+        {
+            writer_.join();
+        }
+    }
+
+    // 后台线程退出后，把剩余的日志同步写出
+    std::lock_guard<std::mutex> lk(drainMutex_);
+    drain();
+    drainBinary();
+    reportDrops();
+    writeOut();
 }
 
 // 日志级别转字符串
-std::string Logger::levelToString(LogLevel level) const 
+const char* Logger::levelToString(LogLevel level)
 {
-    switch (level) 
+    switch (level)
     {
     case LogLevel::Trace: return "TRACE";
     case LogLevel::Debug: return "DEBUG";
@@ -48,46 +280,345 @@ std::string Logger::levelToString(LogLevel level) const
     }
 }
 
-// 核心日志写入逻辑
+// 投递日志（调用线程）
 //level：写入的日志级别
 //component：代码模块
 //message：写入的内容
-void Logger::write(LogLevel level, std::string_view component, const std::string& message) 
+void Logger::write(LogLevel level, std::string_view component, std::string message)
+{
+    Record record;
+    record.level = level;
+    record.time = std::chrono::system_clock::now();
+    auto len = std::min(component.size(), sizeof(record.component) - 1);
+    std::memcpy(record.component, component.data(), len);
+    if (message.size() > kMaxMessageBytes)
+    {
+        message.resize(kMaxMessageBytes);
+    }
+    record.message = std::move(message);
+
+    // 后台线程没启动（configure 之前或 shutdown 之后）：直接同步输出
+    if (!running_)
+    {
+        std::lock_guard<std::mutex> lk(drainMutex_);
+        append(record);
+        writeOut();
+        return;
+    }
+
+    // 队列满：丢弃并计数，由后台线程在日志中报告
+    if (!queue_->tryPush(std::move(record)))
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        wakeCv_.notify_one();
+        return;
+    }
+
+    if (level >= LogLevel::Critical)
+    {
+        // 严重错误之后进程很可能退出，同步刷到磁盘
+        flush();
+    }
+    else if (queue_->sizeApprox() >= queue_->capacity() / 2)
+    {
+        // 队列过半时提前唤醒后台线程，不等攒批周期
+        wakeCv_.notify_one();
+    }
+}
+
+void Logger::writerLoop()
 {
-    std::lock_guard<std::mutex> lk(mutex_); //加锁
+    while (running_)
+    {
+        {
+            std::lock_guard<std::mutex> lk(drainMutex_);
+            drain();
+            drainBinary();
+            reportDrops();
+            writeOut(); // 每轮最多一次（大批量时几次）write 调用
+            rotateIfDue();
+        }
+
+        std::unique_lock<std::mutex> lk(wakeMutex_);
+        cycles_.fetch_add(1);
+        flushRequested_ = false;
+        flushedCv_.notify_all();
+        wakeCv_.wait_for(lk, flushInterval_, [this]() { return flushRequested_ || !running_; });
+    }
 
-    // 获取当前时间
-    auto now = std::chrono::system_clock::now();    //获取当前时间点（此时的时间是以“时钟周期”衡量的，人类无法直接阅读）
+    {
+        std::lock_guard<std::mutex> lk(drainMutex_);
+        drain();
+        drainBinary();
+        reportDrops();
+        writeOut();
+    }
+    std::lock_guard<std::mutex> lk(wakeMutex_);
+    cycles_.fetch_add(1);
+    flushedCv_.notify_all();
+}
 
-    //将 chrono 时间点转换为传统的 std::time_t（c风格的时间戳）
-    //time_t: 通常是一个长整型（long），表示从 Unix 纪元（1970年1月1日 00:00:00 UTC）到现在的秒数
-    std::time_t time = std::chrono::system_clock::to_time_t(now);   
+// 调用方持有 drainMutex_
+std::size_t Logger::drain()
+{
+    if (!queue_)
+    {
+        return 0;
+    }
 
-    // C 风格的结构体，包含年、月、日、时、分、秒等成员
-    std::tm tm{};   //初始化为空
+    std::size_t count = 0;
+    Record record;
+    while (queue_->tryPop(record))
+    {
+        append(record);
+        ++count;
+        if (batch_.size() >= kBatchBytes)
+        {
+            writeOut();
+        }
+    }
 
-    // 线程安全地获取本地时间
-#ifdef _WIN32
-    localtime_s(&tm, &time);    //windows
-#else
-    localtime_r(&time, &tm);    //linux
-#endif
+    return count;
+}
 
-    // 格式化前缀：[2024-01-14 10:30:45] [INFO] [sensor_gateway]
-    std::ostringstream prefix;
-    prefix << std::put_time(&tm, "%Y-%m-%d %H:%M:%S")
-           << " [" << levelToString(level) << "]"
-           << " [" << component << "] ";
+// 调用方持有 drainMutex_
+void Logger::reportDrops()
+{
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped == droppedReported_)
+    {
+        return;
+    }
 
+    Record notice;
+    notice.level = LogLevel::Warn;
+    notice.time = std::chrono::system_clock::now();
+    std::strcpy(notice.component, "logger");
+    notice.message = "Dropped " + std::to_string(dropped - droppedReported_) + " log messages (queue full)";
+    append(notice);
 
-    if (consoleEnabled_) //输出到控制台
-    {  
-        std::cout << prefix.str() << message << std::endl;
+    if (binaryFile_.isOpen())
+    {
+        binaryBatch_.push_back(static_cast<char>(binlog::kDropRecord));
+        int64_t ts = std::chrono::duration_cast<std::chrono::nanoseconds>(notice.time.time_since_epoch()).count();
+        uint64_t count = dropped - droppedReported_;
+        binaryBatch_.append(reinterpret_cast<const char*>(&ts), sizeof(ts));
+        binaryBatch_.append(reinterpret_cast<const char*>(&count), sizeof(count));
     }
-    if (fileEnabled_) //输出到文件
-    { 
-        fileStream_ << prefix.str() << message << std::endl;
+    droppedReported_ = dropped;
+}
+
+uint32_t Logger::registerSite(LogSite& slot, LogLevel level, std::string_view component,
+                              const char* file, int line, std::vector<binlog::SiteArg> args)
+{
+    std::lock_guard<std::mutex> lk(sitesMutex_);
+    if (uint32_t id = slot.id.load(std::memory_order_acquire); id != 0)
+    {
+        return id;  // 其他线程已经登记过
     }
+
+    binlog::Site site;
+    site.id = static_cast<uint32_t>(sites_.size() + 1);
+    site.level = static_cast<uint8_t>(level);
+    site.component.assign(component);
+    site.file = file;
+    site.line = static_cast<uint32_t>(line);
+    site.args = std::move(args);
+    sites_.push_back(std::move(site));
+
+    slot.id.store(sites_.back().id, std::memory_order_release);
+    return sites_.back().id;
+}
+
+binlog::ThreadRing* Logger::threadRing()
+{
+    // 线程退出时只标记为 retired，由后台线程排空后回收
+    struct Holder {
+        std::shared_ptr<binlog::ThreadRing> ring;
+        ~Holder()
+        {
+            if (ring)
+            {
+                ring->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+
+    if (!holder.ring)
+    {
+        std::lock_guard<std::mutex> lk(ringsMutex_);
+        holder.ring = std::make_shared<binlog::ThreadRing>(threadBufferBytes_, nextRingIndex_++);
+        rings_.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+// 调用方持有 drainMutex_
+void Logger::drainBinary()
+{
+    std::vector<std::shared_ptr<binlog::ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lk(ringsMutex_);
+        rings = rings_;
+    }
+    if (rings.empty())
+    {
+        return;
+    }
+
+    // 持有 sitesMutex_：取出的消息所属站点一定已经登记，先写站点定义再写消息
+    std::lock_guard<std::mutex> sitesLock(sitesMutex_);
+    std::string messages;
+    for (const auto& ring : rings)
+    {
+        ring->consume([&](const char* data, uint32_t size) {
+            uint32_t id = 0;
+            int64_t ts = 0;
+            std::memcpy(&id, data, sizeof(id));
+            std::memcpy(&ts, data + sizeof(id), sizeof(ts));
+            const char* payload = data + sizeof(id) + sizeof(ts);
+            uint32_t payloadSize = size - static_cast<uint32_t>(sizeof(id) + sizeof(ts));
+
+            if (binaryFile_.isOpen())
+            {
+                uint32_t thread = ring->index();
+                messages.push_back(static_cast<char>(binlog::kMessageRecord));
+                messages.append(reinterpret_cast<const char*>(&id), sizeof(id));
+                messages.append(reinterpret_cast<const char*>(&ts), sizeof(ts));
+                messages.append(reinterpret_cast<const char*>(&thread), sizeof(thread));
+                messages.append(reinterpret_cast<const char*>(&payloadSize), sizeof(payloadSize));
+                messages.append(payload, payloadSize);
+            }
+
+            // 告警及以上级别在后台线程格式化后回显到控制台
+            const auto& site = sites_[id - 1];
+            if (consoleEnabled_ && site.level >= static_cast<uint8_t>(LogLevel::Warn))
+            {
+                batch_.append(binlog::formatLine(site.level, ts, site.component,
+                                                 binlog::formatMessage(site, payload, payloadSize)));
+            }
+        });
+    }
+
+    if (binaryFile_.isOpen())
+    {
+        for (; sitesWritten_ < sites_.size(); ++sitesWritten_)
+        {
+            binlog::appendSiteRecord(binaryBatch_, sites_[sitesWritten_]);
+        }
+        binaryBatch_.append(messages);
+    }
+
+    // 回收已退出线程的缓冲区
+    std::lock_guard<std::mutex> lk(ringsMutex_);
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const auto& ring) {
+                     return ring->retired.load(std::memory_order_acquire) && ring->empty();
+                 }),
+                 rings_.end());
+}
+
+// 格式化一条日志：2024-01-14 10:30:45 [INFO] [sensor_gateway] message
+void Logger::append(const Record& record)
+{
+    // 时间戳按秒缓存，同一秒内的日志只调用一次 localtime_r/strftime
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(record.time.time_since_epoch()).count();
+    if (seconds != cachedSecond_)
+    {
+        std::time_t time = static_cast<std::time_t>(seconds);
+        std::tm tm{};
+        localtime_r(&time, &tm);    //linux
+        std::strftime(cachedStamp_, sizeof(cachedStamp_), "%Y-%m-%d %H:%M:%S", &tm);
+        cachedSecond_ = seconds;
+    }
+
+    batch_.append(cachedStamp_);
+    batch_.append(" [");
+    batch_.append(levelToString(record.level));
+    batch_.append("] [");
+    batch_.append(record.component);
+    batch_.append("] ");
+    batch_.append(record.message);
+    batch_.push_back('\n');
+}
+
+// 调用方持有 drainMutex_
+void Logger::writeOut()
+{
+    if (!batch_.empty())
+    {
+        if (consoleEnabled_) //输出到控制台
+        {
+            writeAll(STDOUT_FILENO, batch_.data(), batch_.size());
+        }
+        textFile_.write(batch_.data(), batch_.size()); //输出到文件（未打开时忽略）
+        batch_.clear();
+    }
+
+    binaryFile_.write(binaryBatch_.data(), binaryBatch_.size());
+    binaryBatch_.clear();
+}
+
+// 调用方持有 drainMutex_，批量缓冲区已经写出
+// 改名和重新打开都在后台线程里完成，其他线程只往队列里投递，所以不会丢行
+void Logger::rotateIfDue()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (textFile_.rotationDue(now))
+    {
+        textFile_.rotate();
+    }
+    if (binaryFile_.rotationDue(now) && binaryFile_.rotate())
+    {
+        startBinaryFile();
+    }
+}
+
+// 调用方持有 drainMutex_
+void Logger::startBinaryFile()
+{
+    if (binaryFile_.size() == 0)
+    {
+        char header[16]{};
+        std::memcpy(header, binlog::kMagic, sizeof(binlog::kMagic));
+        std::memcpy(header + sizeof(binlog::kMagic), &binlog::kVersion, sizeof(binlog::kVersion));
+        binaryFile_.write(header, sizeof(header));
+    }
+    sitesWritten_ = 0;  // 每个文件都能独立解码
+}
+
+// 致命信号：尽力把队列中的日志写出，然后按默认行为终止
+// 注意：这里调用的函数并非都是异步信号安全的，只作为崩溃前的最后一搏
+void Logger::crashHandler(int signal)
+{
+    Logger& logger = instance();
+    if (logger.drainMutex_.try_lock())
+    {
+        logger.drain();
+        logger.drainBinary();
+        logger.writeOut();
+        logger.drainMutex_.unlock();
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+void Logger::installCrashHandlers()
+{
+    for (int sig : {SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL})
+    {
+        struct sigaction action{};
+        action.sa_handler = &Logger::crashHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND;
+        sigaction(sig, &action, nullptr);
+    }
+
+    // 未捕获的异常：先同步刷新，再走默认的 abort
+    std::set_terminate([]() {
+        instance().flush();
+        std::abort();
+    });
 }
 
 } // namespace core
@@ -1,13 +1,23 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <fstream>
-#include <iomanip>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/binary_log.hpp"
+#include "core/log_file.hpp"
+#include "core/mpmc_queue.hpp"
 
 namespace core {
 
@@ -20,29 +30,138 @@ enum class LogLevel {
     Critical
 };
 
+// 字符串 -> 日志级别（"debug"、"INFO" 等，无法识别时返回空）
+std::optional<LogLevel> tryParseLogLevel(std::string_view text);
+
+// 同上，无法识别时返回 fallback
+LogLevel parseLogLevel(std::string_view text, LogLevel fallback = LogLevel::Info);
+
+// 异步日志参数
+struct LoggerOptions {
+    LogLevel level{LogLevel::Info};
+    std::string filePath;   // 为空则不写文件
+    LogRotation rotation;   // 日志文件（文本、二进制）的轮转参数
+    bool useConsole{true};
+    std::size_t queueCapacity{8192};    // 队列容量（条），满了直接丢弃并计数
+    std::chrono::milliseconds flushInterval{200};   // 后台线程的最长攒批时间
+    bool binary{false};         // LOG_* 宏改为写二进制日志（延迟格式化）
+    std::string binaryPath;     // 二进制日志文件路径
+    std::size_t threadBufferBytes{64 * 1024};   // 二进制模式下每个线程的环形缓冲区大小
+    std::vector<std::pair<std::string, LogLevel>> componentLevels;  // 按组件覆盖的最低级别
+};
+
+// 每个 LOG_* 调用点一个静态变量（常量初始化）
+struct LogSite {
+    std::atomic<uint32_t> id{0};            // 二进制模式的站点 ID（0 表示尚未登记）
+    std::atomic<uint16_t> component{0};     // 组件级别表下标 + 1（0 表示尚未解析）
+};
 
 // Logger 类（单例模式）
+// 调用线程只负责格式化消息并投递到无锁队列；时间戳格式化和磁盘/控制台 I/O 都在后台线程完成，
+// 后台线程攒批后用一次 write() 写出
 class Logger {
 public:
     // 获取全局唯一的 Logger 实例
     static Logger& instance();
 
     // 配置日志（启动时调用一次）
+    // 队列容量以第一次配置为准；再次调用会先排空队列再重新打开文件
+    void configure(const LoggerOptions& options);
+
     // level: 最低日志级别
     // filePath: 日志文件路径
     // useConsole: 是否同时输出到控制台
     void configure(LogLevel level, const std::string& filePath = "", bool useConsole = true);
 
-    // 可变参数模板日志函数
+    // 同步刷新：阻塞到调用前投递的日志都已写出
+    void flush();
+
+    // 停止后台线程并把剩余日志同步写出（进程退出前调用）
+    void shutdown();
+
+    // 因队列满被丢弃的日志条数
+    uint64_t droppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // 全局最低级别（运行时可改）
+    LogLevel level() const { return minLevel_.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel level) { minLevel_.store(level, std::memory_order_relaxed); }
+
+    // 设置某个组件的最低级别，level 为空表示恢复为跟随全局级别
+    // 组件表已满时返回 false
+    bool setComponentLevel(std::string_view component, std::optional<LogLevel> level);
+
+    // 当前所有按组件覆盖的级别
+    std::vector<std::pair<std::string, LogLevel>> componentLevels() const;
+
+    // 组件是否已在级别表中（打过日志或配置过级别），只查不登记
+    bool hasComponent(std::string_view component) const;
+
+    // LOG_* 宏在求值参数之前调用：按组件级别（未设置时按全局级别）判断是否输出
+    // 组件在表中的位置缓存在调用点的 LogSite 里，之后每次只是两次原子读
+    bool enabled(LogSite& site, LogLevel level, std::string_view component) {
+        uint16_t slot = site.component.load(std::memory_order_relaxed);
+        if (slot == 0) {
+            slot = resolveComponent(component);
+            site.component.store(slot, std::memory_order_relaxed);
+        }
+        uint8_t threshold = kInheritLevel;
+        if (slot <= kMaxComponents) {
+            threshold = components_[slot - 1].level.load(std::memory_order_relaxed);
+        }
+        if (threshold == kInheritLevel) {
+            threshold = static_cast<uint8_t>(minLevel_.load(std::memory_order_relaxed));
+        }
+        return static_cast<uint8_t>(level) >= threshold;
+    }
+
+    // 可变参数模板日志函数（只按全局级别过滤；LOG_* 宏走 logAt）
     // 支持任意数量的参数，比如：
-    // LOG_INFO("component", "msg1", 100, "msg3");
+    // core::Logger::instance().log(LogLevel::Info, "component", "msg1", 100, "msg3");
     template <typename... Args>
     void log(LogLevel level, std::string_view component, Args&&... args) {
         // 检查日志级别（优化：不符合级别就直接返回）
-        if (level < minLevel_.load()) {
+        if (level < minLevel_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        logText(level, component, std::forward<Args>(args)...);
+    }
+
+    // LOG_* 宏的入口（调用方已经用 enabled() 过滤过级别）：
+    // 二进制模式下只拷贝原始参数字节，否则走文本格式
+    template <typename... Args>
+    void logAt(LogSite& site, LogLevel level, std::string_view component,
+               const char* file, int line, Args&&... args) {
+        if (!binary_.load(std::memory_order_relaxed)) {
+            logText(level, component, std::forward<Args>(args)...);
             return;
         }
+        logBinary(site, level, component, file, line, binlog::normalize(std::forward<Args>(args))...);
+    }
+
+private:
+    Logger() = default;
+    ~Logger();
+
+    // 队列中的一条日志
+    struct Record {
+        LogLevel level{LogLevel::Info};
+        std::chrono::system_clock::time_point time{};
+        char component[32]{};   // 组件名（定长，避免再分配一次）
+        std::string message;
+    };
+
+    static constexpr std::size_t kMaxComponents = 64;    // 组件级别表容量
+    static constexpr uint16_t kNoComponent = 0xFFFF;     // 表已满：该调用点始终跟随全局级别
+    static constexpr uint8_t kInheritLevel = 0xFF;       // 组件未单独设置级别
+
+    // 组件级别表的一项：名字写入后不再修改，级别可随时原子更新
+    struct ComponentEntry {
+        char name[32]{};
+        std::atomic<uint8_t> level{kInheritLevel};
+    };
 
+    template <typename... Args>
+    void logText(LogLevel level, std::string_view component, Args&&... args) {
         // 用 ostringstream 收集所有参数
         std::ostringstream oss;
 
@@ -50,37 +169,154 @@ public:
         // 展开为：oss << arg1 << arg2 << arg3 << ... << argN
         (oss << ... << std::forward<Args>(args));
 
-        // 委托给 write() 实际写入
+        // 委托给 write() 投递到队列
         write(level, component, oss.str());
     }
 
-private:
-    Logger() = default;
-    ~Logger() = default;
+    // 投递一条日志到队列（后台线程未启动时同步输出）
+    void write(LogLevel level, std::string_view component, std::string message);
 
-    // 实际的日志写入逻辑
-    void write(LogLevel level, std::string_view component, const std::string& message);
+    // 查找组件在级别表中的位置（不存在则登记），返回下标 + 1，表满返回 kNoComponent
+    uint16_t resolveComponent(std::string_view component);
 
-    // 将日志级别（枚举）转换为字符串
-    std::string levelToString(LogLevel level) const;
+    // 二进制模式：站点 ID + 时间戳 + 参数原始字节写入当前线程的环形缓冲区
+    template <typename... Args>
+    void logBinary(LogSite& site, LogLevel level, std::string_view component,
+                   const char* file, int line, Args&&... args) {
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = registerSite(site, level, component, file, line, {binlog::describe(args)...});
+        }
+
+        const std::size_t size = sizeof(uint32_t) + sizeof(int64_t) + (std::size_t{0} + ... + binlog::encodedSize(args));
+        binlog::ThreadRing* ring = threadRing();
+        char* out = ring ? ring->reserve(static_cast<uint32_t>(size)) : nullptr;
+        if (out == nullptr) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        out = binlog::put(out, id);
+        out = binlog::put(out, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count()));
+        ((out = binlog::encode(out, args)), ...);
+        ring->commit();
+
+        if (level >= LogLevel::Critical) {
+            flush();
+        }
+    }
+
+    // 登记一个调用点（每个调用点只执行一次），返回站点 ID
+    uint32_t registerSite(LogSite& site, LogLevel level, std::string_view component,
+                          const char* file, int line, std::vector<binlog::SiteArg> args);
+
+    // 当前线程的环形缓冲区（第一次调用时创建并登记）
+    binlog::ThreadRing* threadRing();
+
+    // 排空所有线程的环形缓冲区，写入二进制文件
+    void drainBinary();
+
+    // 报告因队列/缓冲区满丢弃的日志
+    void reportDrops();
 
-    // 成员变量
-    std::mutex mutex_;  // 互斥锁（线程安全）
+    // 后台写线程主循环
+    void writerLoop();
+
+    // 从队列取出日志写出，返回处理的条数
+    std::size_t drain();
+
+    // 把一条日志格式化后追加到批量缓冲区
+    void append(const Record& record);
+
+    // 把批量缓冲区写到控制台和文件
+    void writeOut();
+
+    // 到达大小/时间阈值时轮转日志文件（只在后台线程两轮写出之间调用）
+    void rotateIfDue();
+
+    // 新的二进制日志文件：写文件头，之后重新写出全部站点定义
+    void startBinaryFile();
+
+    // 进程崩溃时尽力把队列里的日志写出
+    static void crashHandler(int signal);
+    static void installCrashHandlers();
+
+    // 将日志级别（枚举）转换为字符串
+    static const char* levelToString(LogLevel level);
 
     // atomic：对 minLevel_ 这个变量的读写操作必须是原子性的
     // 大括号 {} 是 C++11 引入的列表初始化语法
     std::atomic<LogLevel> minLevel_{LogLevel::Info};    // 最低日志级别
-    std::ofstream fileStream_;  // 文件流
-    bool consoleEnabled_{true}; // 是否输出到控制台
-    bool fileEnabled_{false};   // 是否输出到文件
+
+    // 按组件的级别表：读路径无锁，登记新组件时持有 componentsMutex_
+    std::array<ComponentEntry, kMaxComponents> components_;
+    std::atomic<uint16_t> componentCount_{0};   // 已发布的表项数
+    mutable std::mutex componentsMutex_;
+
+    std::unique_ptr<BoundedMpmcQueue<Record>> queue_;   // 日志队列（第一次 configure 时创建）
+    std::atomic<uint64_t> dropped_{0};      // 被丢弃的日志条数
+    std::atomic<uint64_t> cycles_{0};       // 后台线程完成的写出轮数（flush 用来判断是否写完）
+
+    // 二进制模式
+    std::atomic<bool> binary_{false};
+    std::size_t threadBufferBytes_{64 * 1024};
+    std::mutex sitesMutex_;
+    std::vector<binlog::Site> sites_;       // 已登记的站点（下标 = id - 1）
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<binlog::ThreadRing>> rings_;   // 各线程的环形缓冲区
+    uint32_t nextRingIndex_{0};
+
+    std::mutex lifecycleMutex_;     // 保护 configure/shutdown
+    std::mutex drainMutex_;         // 同一时刻只允许一个线程排空队列（后台线程或崩溃处理）
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;    // 唤醒后台线程
+    std::condition_variable flushedCv_; // 通知 flush() 调用者
+    std::thread writer_;
+    std::atomic<bool> running_{false};
+    bool flushRequested_{false};        // 有线程在等 flush（受 wakeMutex_ 保护）
+    std::chrono::milliseconds flushInterval_{200};
+
+    // 以下只在持有 drainMutex_ 时访问
+    std::string batch_;                 // 批量写缓冲区
+    LogFile textFile_;                  // 文本日志文件
+    bool consoleEnabled_{true};         // 是否输出到控制台
+    int64_t cachedSecond_{-1};          // 缓存的时间戳（秒），同一秒内复用格式化结果
+    char cachedStamp_[32]{};
+    uint64_t droppedReported_{0};       // 已经在日志中报告过的丢弃条数
+    LogFile binaryFile_;                // 二进制日志文件
+    std::string binaryBatch_;           // 二进制批量写缓冲区
+    std::size_t sitesWritten_{0};       // 已写入二进制文件的站点数
 };
 
 } // namespace core
 
+// 编译期最低级别（0=Trace ... 5=Critical），低于它的 LOG_* 整条语句在编译期被剔除
+// Release 构建（定义了 NDEBUG）默认去掉 Trace/Debug，可用 -DAQUA_LOG_COMPILE_MIN_LEVEL=0 保留
+#ifndef AQUA_LOG_COMPILE_MIN_LEVEL
+#ifdef NDEBUG
+#define AQUA_LOG_COMPILE_MIN_LEVEL 2
+#else
+#define AQUA_LOG_COMPILE_MIN_LEVEL 0
+#endif
+#endif
+
+// 每个调用点展开出一个静态站点（常量初始化，没有额外的初始化开销）
+// 先判断级别再求值参数：被过滤掉的日志不会执行 std::to_string、字符串拼接等开销
 //__VA_ARGS__会原封不动地将...中的参数替换过来
-#define LOG_TRACE(component, ...) ::core::Logger::instance().log(::core::LogLevel::Trace, component, __VA_ARGS__)
-#define LOG_DEBUG(component, ...) ::core::Logger::instance().log(::core::LogLevel::Debug, component, __VA_ARGS__)
-#define LOG_INFO(component, ...)  ::core::Logger::instance().log(::core::LogLevel::Info, component, __VA_ARGS__)
-#define LOG_WARN(component, ...)  ::core::Logger::instance().log(::core::LogLevel::Warn, component, __VA_ARGS__)
-#define LOG_ERROR(component, ...) ::core::Logger::instance().log(::core::LogLevel::Error, component, __VA_ARGS__)
-#define LOG_CRITICAL(component, ...) ::core::Logger::instance().log(::core::LogLevel::Critical, component, __VA_ARGS__)
+#define AQUA_LOG_AT(level, component, ...)                                                               \
+    do {                                                                                                 \
+        if constexpr (static_cast<int>(level) >= AQUA_LOG_COMPILE_MIN_LEVEL) {                           \
+            static ::core::LogSite aquaLogSite_;                                                         \
+            auto& aquaLogger_ = ::core::Logger::instance();                                              \
+            if (aquaLogger_.enabled(aquaLogSite_, level, component)) {                                   \
+                aquaLogger_.logAt(aquaLogSite_, level, component, __FILE__, __LINE__, __VA_ARGS__);      \
+            }                                                                                            \
+        }                                                                                                \
+    } while (0)
+
+#define LOG_TRACE(component, ...) AQUA_LOG_AT(::core::LogLevel::Trace, component, __VA_ARGS__)
+#define LOG_DEBUG(component, ...) AQUA_LOG_AT(::core::LogLevel::Debug, component, __VA_ARGS__)
+#define LOG_INFO(component, ...)  AQUA_LOG_AT(::core::LogLevel::Info, component, __VA_ARGS__)
+#define LOG_WARN(component, ...)  AQUA_LOG_AT(::core::LogLevel::Warn, component, __VA_ARGS__)
+#define LOG_ERROR(component, ...) AQUA_LOG_AT(::core::LogLevel::Error, component, __VA_ARGS__)
+#define LOG_CRITICAL(component, ...) AQUA_LOG_AT(::core::LogLevel::Critical, component, __VA_ARGS__)
@@ -0,0 +1,106 @@
+// 有界无锁队列（Dmitry Vyukov 的 bounded MPMC 算法）
+// 多个生产者 / 多个消费者，push/pop 都只有一次 CAS，不分配内存
+// 队列满时 tryPush 返回 false，由调用方决定丢弃策略（计数、丢最旧等）
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace core {
+
+template <typename T>
+class BoundedMpmcQueue {
+public:
+    // capacity 会向上取整为 2 的幂
+    explicit BoundedMpmcQueue(std::size_t capacity)
+        : mask_(roundUp(capacity) - 1)
+        , slots_(new Slot[mask_ + 1]) {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue&) = delete;
+    BoundedMpmcQueue& operator=(const BoundedMpmcQueue&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // 近似长度（并发时只作参考）
+    std::size_t sizeApprox() const {
+        auto tail = dequeuePos_.load(std::memory_order_relaxed);
+        auto head = enqueuePos_.load(std::memory_order_relaxed);
+        return head >= tail ? head - tail : 0;
+    }
+
+    template <typename U>
+    bool tryPush(U&& value) {
+        Slot* slot;
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            slot = &slots_[pos & mask_];
+            std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;   // 队列已满
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::forward<U>(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& out) {
+        Slot* slot;
+        std::size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        for (;;) {
+            slot = &slots_[pos & mask_];
+            std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;   // 队列为空
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(slot->value);
+        slot->value = T{};  // 及时释放元素持有的资源
+        slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    static std::size_t roundUp(std::size_t n) {
+        std::size_t cap = 2;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    static constexpr std::size_t kCacheLine = 64;
+
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(kCacheLine) std::atomic<std::size_t> enqueuePos_{0};   // 生产者和消费者的位置分属不同缓存行，避免伪共享
+    alignas(kCacheLine) std::atomic<std::size_t> dequeuePos_{0};
+};
+
+} // namespace core
@@ -0,0 +1,176 @@
+// 池化的引用计数数据包缓冲区
+// 缓冲区按大小分档（2K/8K/32K/128K/512K），每档一个无锁空闲链（BoundedMpmcQueue），头部和数据区一次分配；
+// PacketRef 是侵入式引用计数句柄：拷贝只加一次原子计数，最后一个引用释放时缓冲区回到所属档位的空闲链
+// 超过最大档位的包直接分配、直接释放；空闲链满了也直接释放
+//
+// 注意：PacketPool 必须比它分配出去的所有 PacketRef 活得久
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "core/mpmc_queue.hpp"
+
+namespace core {
+
+class PacketPool;
+
+// 缓冲区头部，数据区紧跟在后面
+struct alignas(16) PacketBlock {
+    std::atomic<uint32_t> refs{1};
+    uint32_t capacity{0};
+    uint32_t size{0};
+    uint8_t sizeClass{0};
+    PacketPool* pool{nullptr};
+
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(this + 1); }
+};
+
+// 数据包引用（可拷贝，拷贝即共享同一块缓冲区）
+class PacketRef {
+public:
+    PacketRef() = default;
+
+    PacketRef(const PacketRef& other)
+        : block_(other.block_) {
+        if (block_ != nullptr) {
+            block_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    PacketRef(PacketRef&& other) noexcept
+        : block_(other.block_) {
+        other.block_ = nullptr;
+    }
+
+    PacketRef& operator=(PacketRef other) noexcept {
+        std::swap(block_, other.block_);
+        return *this;
+    }
+
+    ~PacketRef() { reset(); }
+
+    void reset();
+
+    explicit operator bool() const { return block_ != nullptr; }
+
+    const uint8_t* data() const { return block_ != nullptr ? block_->bytes() : nullptr; }
+    uint8_t* data() { return block_ != nullptr ? block_->bytes() : nullptr; }
+    std::size_t size() const { return block_ != nullptr ? block_->size : 0; }
+    std::size_t capacity() const { return block_ != nullptr ? block_->capacity : 0; }
+
+    // 调整有效长度（不超过容量）；只应在共享给其他线程之前调用
+    void resize(std::size_t size) {
+        if (block_ != nullptr) {
+            block_->size = static_cast<uint32_t>(size < block_->capacity ? size : block_->capacity);
+        }
+    }
+
+    uint32_t useCount() const { return block_ != nullptr ? block_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    friend class PacketPool;
+    explicit PacketRef(PacketBlock* block)
+        : block_(block) {}
+
+    PacketBlock* block_{nullptr};
+};
+
+class PacketPool {
+public:
+    static constexpr std::array<std::size_t, 5> kClassSizes{
+        2 * 1024, 8 * 1024, 32 * 1024, 128 * 1024, 512 * 1024};
+    static constexpr uint8_t kUnpooled = 0xFF;
+
+    // buffersPerClass：每档最多缓存的空闲缓冲区个数
+    explicit PacketPool(std::size_t buffersPerClass = 256) {
+        for (auto& list : free_) {
+            list = std::make_unique<BoundedMpmcQueue<PacketBlock*>>(buffersPerClass);
+        }
+    }
+
+    ~PacketPool() {
+        PacketBlock* block = nullptr;
+        for (auto& list : free_) {
+            while (list->tryPop(block)) {
+                destroy(block);
+            }
+        }
+    }
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    // 取一块至少 size 字节的缓冲区（有效长度为 size）
+    PacketRef allocate(std::size_t size) {
+        const uint8_t sizeClass = classFor(size);
+        PacketBlock* block = nullptr;
+        if (sizeClass != kUnpooled && free_[sizeClass]->tryPop(block)) {
+            reused_.fetch_add(1, std::memory_order_relaxed);
+            block->refs.store(1, std::memory_order_relaxed);
+        } else {
+            const std::size_t capacity = sizeClass != kUnpooled ? kClassSizes[sizeClass] : size;
+            void* memory = ::operator new(sizeof(PacketBlock) + capacity);
+            block = new (memory) PacketBlock();
+            block->capacity = static_cast<uint32_t>(capacity);
+            block->sizeClass = sizeClass;
+            block->pool = this;
+            allocated_.fetch_add(1, std::memory_order_relaxed);
+        }
+        block->size = static_cast<uint32_t>(size);
+        return PacketRef(block);
+    }
+
+    // 取缓冲区并拷入数据（接收回调里唯一的一次拷贝）
+    PacketRef copyFrom(const void* data, std::size_t size) {
+        PacketRef packet = allocate(size);
+        std::memcpy(packet.data(), data, size);
+        return packet;
+    }
+
+    // 统计：新分配的缓冲区个数 / 从空闲链复用的次数
+    uint64_t allocated() const { return allocated_.load(std::memory_order_relaxed); }
+    uint64_t reused() const { return reused_.load(std::memory_order_relaxed); }
+
+private:
+    friend class PacketRef;
+
+    static uint8_t classFor(std::size_t size) {
+        for (std::size_t i = 0; i < kClassSizes.size(); ++i) {
+            if (size <= kClassSizes[i]) {
+                return static_cast<uint8_t>(i);
+            }
+        }
+        return kUnpooled;
+    }
+
+    void release(PacketBlock* block) {
+        if (block->sizeClass == kUnpooled || !free_[block->sizeClass]->tryPush(block)) {
+            destroy(block);
+        }
+    }
+
+    static void destroy(PacketBlock* block) {
+        block->~PacketBlock();
+        ::operator delete(static_cast<void*>(block));
+    }
+
+    std::array<std::unique_ptr<BoundedMpmcQueue<PacketBlock*>>, kClassSizes.size()> free_;
+    std::atomic<uint64_t> allocated_{0};
+    std::atomic<uint64_t> reused_{0};
+};
+
+inline void PacketRef::reset() {
+    if (block_ != nullptr && block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block_->pool->release(block_);
+    }
+    block_ = nullptr;
+}
+
+} // namespace core
@@ -0,0 +1,338 @@
+// 压缩的内存遥测历史缓存（Gorilla 编码）
+// 与 TelemetryCache 接口一致（store / snapshot / snapshotAll），额外提供 range 按时间段查询
+// 每个通道按固定时间窗口（默认 2 小时，对齐到整点窗口）切块，块内每个字段单独一条位流：
+//   时间戳：delta-of-delta；六个数值字段：XOR 浮点编码
+// 块边界按时间对齐，range 查询可直接定位到块，只解码相关的块
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/logger.hpp"
+#include "domain/telemetry_models.hpp"
+#include "infrastructure/cache/gorilla_codec.hpp"
+#include "monitoring/metrics.hpp"
+
+namespace infrastructure::cache {
+
+namespace detail {
+
+// 公历日期 -> 距 1970-01-01 的天数（Howard Hinnant 算法）
+inline int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// 距 1970-01-01 的天数 -> 公历日期
+inline void civilFromDays(int64_t z, int& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int>(static_cast<int64_t>(yoe) + era * 400 + (m <= 2));
+}
+
+// "2024-01-14 10:30:45" -> 秒数（按字面时间换算，不做时区转换，保证原样还原）
+inline bool parseTimestamp(const std::string& text, int64_t& seconds) {
+    int y = 0;
+    unsigned mo = 0, d = 0, h = 0, mi = 0, s = 0;
+    if (std::sscanf(text.c_str(), "%d-%u-%u %u:%u:%u", &y, &mo, &d, &h, &mi, &s) != 6) {
+        return false;
+    }
+    if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 60) {
+        return false;
+    }
+    seconds = daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+    return true;
+}
+
+// 秒数 -> "2024-01-14 10:30:45"
+inline std::string formatTimestamp(int64_t seconds) {
+    int64_t days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    int64_t rem = seconds - days * 86400;
+    int y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02u:%02u:%02u", y, m, d,
+                  static_cast<unsigned>(rem / 3600), static_cast<unsigned>((rem / 60) % 60),
+                  static_cast<unsigned>(rem % 60));
+    return buf;
+}
+
+} // namespace detail
+
+class CompressedTelemetryCache {
+public:
+    static constexpr int64_t kBlockSeconds = 2 * 3600; // 块时间窗口（对齐到 2 小时）
+    static constexpr std::size_t kFieldCount = 6;       // 温湿光土气雨
+
+    // capacityPerChannel：snapshot 返回的最近条数（与 TelemetryCache 一致）
+    // retention：每个通道在内存中保留的历史时长
+    CompressedTelemetryCache(std::size_t capacityPerChannel, std::chrono::seconds retention)
+        : capacity_(capacityPerChannel)
+        , retentionSeconds_(retention.count()) {}
+
+    // 存储一条读数到特定通道（块内时间戳必须单调不减）
+    // 历史通道会周期性重复加载同一批数据库记录，时间戳不晚于该通道最新点的读数跳过（计数）
+    // 实时通道的读数早于最新点说明本机时钟回拨了（NTP 校时、夏令时结束）：按最新点的时间记录并计数，
+    // 不能丢掉，否则时钟追上之前历史一直停着
+    void store(domain::TelemetryChannel channel, const domain::TelemetryReading& reading) {
+        int64_t ts = 0;
+        if (!detail::parseTimestamp(reading.timestamp, ts)) {
+            return; // 无法解析时间（如 "N/A"）的读数不进入历史
+        }
+
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto& series = series_[channel];
+        if (!series.blocks.empty() && ts <= series.lastTimestamp) {
+            if (channel != domain::TelemetryChannel::Realtime) {
+                reloaded_.inc();
+                return;
+            }
+            if (ts < series.lastTimestamp) {
+                if (series.clamped == 0) {
+                    LOG_WARN("telemetry_cache", "Realtime timestamp ", reading.timestamp, " is ",
+                             series.lastTimestamp - ts, "s behind the latest reading (clock stepped back), recording at ",
+                             detail::formatTimestamp(series.lastTimestamp));
+                }
+                ++series.clamped;
+                clamped_.inc();
+            }
+            ts = series.lastTimestamp;
+        } else if (series.clamped != 0) {
+            LOG_INFO("telemetry_cache", "Realtime clock caught up after ", series.clamped, " clamped readings");
+            series.clamped = 0;
+        }
+        series.label = reading.label;
+
+        int64_t window = alignDown(ts);
+        if (series.blocks.empty() || series.blocks.back().windowStart != window) {
+            if (!series.blocks.empty()) {
+                seal(series.blocks.back());
+            }
+            series.blocks.emplace_back();
+            auto& block = series.blocks.back();
+            block.windowStart = window;
+            block.firstTimestamp = ts;
+            block.tsEncoder.begin(ts);
+        } else {
+            auto& block = series.blocks.back();
+            block.tsEncoder.append(block.timestamps, ts);
+        }
+
+        auto& block = series.blocks.back();
+        auto values = fieldsOf(reading);
+        for (std::size_t i = 0; i < kFieldCount; ++i) {
+            block.encoders[i].append(block.fields[i], values[i]);
+        }
+        ++block.count;
+        series.lastTimestamp = ts;
+
+        // 淘汰超出保留时长的整块
+        while (series.blocks.size() > 1 &&
+               series.blocks.front().windowStart + kBlockSeconds <= ts - retentionSeconds_) {
+            series.blocks.pop_front();
+        }
+    }
+
+    // 获取特定通道最近 capacity 条数据（时间从早到晚）
+    std::vector<domain::TelemetryReading> snapshot(domain::TelemetryChannel channel) const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        std::vector<domain::TelemetryReading> result;
+        auto it = series_.find(channel);
+        if (it == series_.end()) {
+            return result;
+        }
+
+        // 从最新的块往前解码，直到凑够 capacity 条
+        const auto& series = it->second;
+        std::size_t first = series.blocks.size();
+        std::size_t total = 0;
+        while (first > 0 && total < capacity_) {
+            --first;
+            total += series.blocks[first].count;
+        }
+        for (std::size_t i = first; i < series.blocks.size(); ++i) {
+            decodeBlock(series, series.blocks[i], INT64_MIN, INT64_MAX, result);
+        }
+        if (result.size() > capacity_) {
+            result.erase(result.begin(), result.end() - static_cast<std::ptrdiff_t>(capacity_));
+        }
+        return result;
+    }
+
+    // 获取所有通道的最近数据
+    std::vector<domain::TelemetryReading> snapshotAll() const {
+        std::vector<domain::TelemetryReading> all;
+        for (auto channel : {domain::TelemetryChannel::Realtime,
+                             domain::TelemetryChannel::HistoricalEnvironment,
+                             domain::TelemetryChannel::HistoricalSoil}) {
+            auto readings = snapshot(channel);
+            all.insert(all.end(), readings.begin(), readings.end());
+        }
+        return all;
+    }
+
+    // 按时间段查询 [from, to]（时间格式同 TelemetryReading::timestamp）
+    std::vector<domain::TelemetryReading> range(domain::TelemetryChannel channel,
+                                                const std::string& from,
+                                                const std::string& to) const {
+        int64_t begin = 0, end = 0;
+        if (!detail::parseTimestamp(from, begin) || !detail::parseTimestamp(to, end) || begin > end) {
+            return {};
+        }
+
+        std::lock_guard<std::mutex> lk(mutex_);
+        std::vector<domain::TelemetryReading> result;
+        auto it = series_.find(channel);
+        if (it == series_.end()) {
+            return result;
+        }
+
+        // 块按窗口起点有序，二分定位第一个可能命中的块
+        const auto& blocks = it->second.blocks;
+        auto first = std::lower_bound(blocks.begin(), blocks.end(), alignDown(begin),
+                                      [](const Block& block, int64_t window) { return block.windowStart < window; });
+        for (auto b = first; b != blocks.end() && b->windowStart <= end; ++b) {
+            decodeBlock(it->second, *b, begin, end, result);
+        }
+        return result;
+    }
+
+    // 压缩数据占用的字节数（用于诊断）
+    std::size_t memoryBytes() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        std::size_t bytes = 0;
+        for (const auto& [_, series] : series_) {
+            for (const auto& block : series.blocks) {
+                bytes += sizeof(Block) + block.timestamps.capacityBytes();
+                for (const auto& field : block.fields) {
+                    bytes += field.capacityBytes();
+                }
+            }
+        }
+        return bytes;
+    }
+
+private:
+    // 一个时间窗口内的压缩数据
+    struct Block {
+        int64_t windowStart{0};     // 对齐后的窗口起点（秒）
+        int64_t firstTimestamp{0};  // 块内第一个点的时间戳
+        uint32_t count{0};          // 块内点数
+        gorilla::BitWriter timestamps;
+        std::array<gorilla::BitWriter, kFieldCount> fields;
+
+        // 编码状态（只有最新的块会继续写入）
+        gorilla::TimestampEncoder tsEncoder;
+        std::array<gorilla::XorEncoder, kFieldCount> encoders;
+    };
+
+    // 单个通道的全部块
+    struct Series {
+        std::string label;  // 通道标签（同一通道的读数标签相同）
+        int64_t lastTimestamp{0};
+        uint64_t clamped{0};    // 时钟回拨后连续按 lastTimestamp 记录的条数
+        std::deque<Block> blocks;
+    };
+
+    static int64_t alignDown(int64_t ts) {
+        int64_t r = ts % kBlockSeconds;
+        return r < 0 ? ts - r - kBlockSeconds : ts - r;
+    }
+
+    static std::array<double, kFieldCount> fieldsOf(const domain::TelemetryReading& reading) {
+        return {reading.temperature, reading.humidity, reading.light,
+                reading.soil, reading.gas, reading.raindrop};
+    }
+
+    // 块写满（进入下一个时间窗口）后释放位流的多余容量
+    static void seal(Block& block) {
+        block.timestamps.shrink();
+        for (auto& field : block.fields) {
+            field.shrink();
+        }
+    }
+
+    // 解码一个块中时间落在 [begin, end] 的读数，追加到 out
+    static void decodeBlock(const Series& series, const Block& block, int64_t begin, int64_t end,
+                            std::vector<domain::TelemetryReading>& out) {
+        gorilla::BitReader tsReader(block.timestamps.bytes());
+        gorilla::TimestampDecoder tsDecoder(block.firstTimestamp);
+
+        std::vector<gorilla::BitReader> readers;
+        readers.reserve(kFieldCount);
+        for (const auto& field : block.fields) {
+            readers.emplace_back(field.bytes());
+        }
+        std::array<gorilla::XorDecoder, kFieldCount> decoders;
+
+        for (uint32_t n = 0; n < block.count; ++n) {
+            int64_t ts = n == 0 ? block.firstTimestamp : tsDecoder.next(tsReader);
+            std::array<double, kFieldCount> v{};
+            for (std::size_t i = 0; i < kFieldCount; ++i) {
+                v[i] = decoders[i].next(readers[i]);
+            }
+            if (ts < begin || ts > end) {
+                continue;
+            }
+
+            domain::TelemetryReading reading;
+            reading.label = series.label;
+            reading.timestamp = detail::formatTimestamp(ts);
+            reading.temperature = v[0];
+            reading.humidity = v[1];
+            reading.light = v[2];
+            reading.soil = v[3];
+            reading.gas = v[4];
+            reading.raindrop = v[5];
+            out.push_back(std::move(reading));
+        }
+    }
+
+    std::size_t capacity_;          // snapshot 返回的条数
+    int64_t retentionSeconds_;      // 历史保留时长（秒）
+    mutable std::mutex mutex_;
+    std::unordered_map<domain::TelemetryChannel, Series, domain::TelemetryChannelHash> series_;
+
+    monitoring::Counter& reloaded_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_telemetry_cache_reloaded_total", "Historical readings skipped because the channel already holds that time");
+    monitoring::Counter& clamped_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_telemetry_cache_clamped_total", "Realtime readings older than the latest point, recorded at the latest time after a clock step");
+};
+
+} // namespace infrastructure::cache
+
+// 数据结构说明
+// CompressedTelemetryCache:
+//
+// series_ (unordered_map)
+//   │
+//   ├─ Realtime → deque<Block>
+//   │               ├─ [08:00, 10:00) 已封存：ts 位流 + 6 条字段位流
+//   │               ├─ [10:00, 12:00) 已封存
+//   │               └─ [12:00, 14:00) 正在写入（保留编码器状态）
+//   │
+//   ├─ HistoricalEnvironment → deque<Block>
+//   └─ HistoricalSoil → deque<Block>
+//
+// 5 秒采样时一个块 1440 个点：时间戳基本每点 1 bit，数值不变时每字段每点 1 bit，
+// 一周六个字段约为几 MB（原 deque 方式每条读数都带两个 std::string）
@@ -0,0 +1,264 @@
+// Gorilla 风格的时序压缩编码（参考 Facebook Gorilla 论文）
+// 时间戳：delta-of-delta 编码（采样周期稳定时每个点只占 1 bit）
+// 数值：与前一个值做 XOR，只保存有效位（数值变化缓慢时每个点只占 1~十几 bit）
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace infrastructure::cache::gorilla {
+
+// 按位写入的字节流（高位在前）
+class BitWriter {
+public:
+    // 写入 value 的低 nbits 位
+    void write(uint64_t value, int nbits) {
+        while (nbits > 0) {
+            if (bitPos_ == 0) {
+                bytes_.push_back(0);
+            }
+            int room = 8 - bitPos_;                 // 当前字节剩余可写位数
+            int take = nbits < room ? nbits : room; // 本次写入的位数
+            uint8_t chunk = static_cast<uint8_t>((value >> (nbits - take)) & ((1u << take) - 1));
+            bytes_.back() |= static_cast<uint8_t>(chunk << (room - take));
+            bitPos_ = (bitPos_ + take) & 7;
+            nbits -= take;
+        }
+    }
+
+    void writeBit(bool bit) { write(bit ? 1 : 0, 1); }
+
+    const std::vector<uint8_t>& bytes() const { return bytes_; }
+    std::size_t capacityBytes() const { return bytes_.capacity(); }
+
+    // 块封存后释放多余容量
+    void shrink() { bytes_.shrink_to_fit(); }
+
+private:
+    std::vector<uint8_t> bytes_;
+    int bitPos_{0}; // 最后一个字节已写入的位数（0 表示需要新字节）
+};
+
+// 按位读取（与 BitWriter 对应）
+class BitReader {
+public:
+    explicit BitReader(const std::vector<uint8_t>& bytes)
+        : data_(bytes.data())
+        , size_(bytes.size()) {}
+
+    uint64_t read(int nbits) {
+        uint64_t value = 0;
+        while (nbits > 0) {
+            if (byte_ >= size_) {
+                return value << nbits;  // 数据不足（不应发生），补 0
+            }
+            int room = 8 - bitPos_;
+            int take = nbits < room ? nbits : room;
+            uint8_t chunk = static_cast<uint8_t>((data_[byte_] >> (room - take)) & ((1u << take) - 1));
+            value = (value << take) | chunk;
+            bitPos_ += take;
+            if (bitPos_ == 8) {
+                bitPos_ = 0;
+                ++byte_;
+            }
+            nbits -= take;
+        }
+        return value;
+    }
+
+    bool readBit() { return read(1) != 0; }
+
+private:
+    const uint8_t* data_;
+    std::size_t size_;
+    std::size_t byte_{0};
+    int bitPos_{0};
+};
+
+// 有符号数截取到 nbits 位（补码）
+inline uint64_t toBits(int64_t value, int nbits) {
+    return static_cast<uint64_t>(value) & ((nbits == 64) ? ~0ull : ((1ull << nbits) - 1));
+}
+
+// nbits 位补码还原为有符号数
+inline int64_t fromBits(uint64_t bits, int nbits) {
+    if (nbits < 64 && (bits & (1ull << (nbits - 1)))) {
+        bits |= ~((1ull << nbits) - 1);
+    }
+    return static_cast<int64_t>(bits);
+}
+
+// 时间戳编码器（delta-of-delta）
+// 块的首个时间戳保存在块头里，流里只写后续点的 dod：
+//   dod == 0              -> '0'
+//   dod in [-64, 63]      -> '10'   + 7 bit
+//   dod in [-256, 255]    -> '110'  + 9 bit
+//   dod in [-2048, 2047]  -> '1110' + 12 bit
+//   其他                  -> '1111' + 32 bit（块内时间戳跨度只有 2 小时，秒级 dod 不会超出 32 位）
+// 区间必须是 n 位补码能表示的范围，否则 +64 之类的值解码时符号扩展成 -64，后面的时间戳全部错位
+class TimestampEncoder {
+public:
+    void begin(int64_t first) {
+        prev_ = first;
+        prevDelta_ = 0;
+    }
+
+    void append(BitWriter& out, int64_t ts) {
+        int64_t delta = ts - prev_;
+        int64_t dod = delta - prevDelta_;
+        if (dod == 0) {
+            out.writeBit(false);
+        } else if (dod >= -64 && dod <= 63) {
+            out.write(0b10, 2);
+            out.write(toBits(dod, 7), 7);
+        } else if (dod >= -256 && dod <= 255) {
+            out.write(0b110, 3);
+            out.write(toBits(dod, 9), 9);
+        } else if (dod >= -2048 && dod <= 2047) {
+            out.write(0b1110, 4);
+            out.write(toBits(dod, 12), 12);
+        } else {
+            out.write(0b1111, 4);
+            out.write(toBits(dod, 32), 32);
+        }
+        prevDelta_ = delta;
+        prev_ = ts;
+    }
+
+private:
+    int64_t prev_{0};
+    int64_t prevDelta_{0};
+};
+
+class TimestampDecoder {
+public:
+    explicit TimestampDecoder(int64_t first)
+        : prev_(first) {}
+
+    int64_t next(BitReader& in) {
+        int64_t dod = 0;
+        if (!in.readBit()) {
+            dod = 0;
+        } else if (!in.readBit()) {
+            dod = fromBits(in.read(7), 7);
+        } else if (!in.readBit()) {
+            dod = fromBits(in.read(9), 9);
+        } else if (!in.readBit()) {
+            dod = fromBits(in.read(12), 12);
+        } else {
+            dod = fromBits(in.read(32), 32);
+        }
+        prevDelta_ += dod;
+        prev_ += prevDelta_;
+        return prev_;
+    }
+
+private:
+    int64_t prev_;
+    int64_t prevDelta_{0};
+};
+
+inline uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double bitsDouble(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline int leadingZeros(uint64_t v) { return v == 0 ? 64 : __builtin_clzll(v); }
+inline int trailingZeros(uint64_t v) { return v == 0 ? 64 : __builtin_ctzll(v); }
+
+// 浮点数 XOR 编码器
+//   xor == 0                       -> '0'
+//   有效位落在上一次的窗口内       -> '10' + 窗口内的有效位
+//   否则                           -> '11' + 5 bit 前导零 + 6 bit 有效位长度 + 有效位
+class XorEncoder {
+public:
+    void append(BitWriter& out, double value) {
+        uint64_t bits = doubleBits(value);
+        if (first_) {
+            out.write(bits, 64);
+            prev_ = bits;
+            first_ = false;
+            return;
+        }
+
+        uint64_t x = bits ^ prev_;
+        prev_ = bits;
+        if (x == 0) {
+            out.writeBit(false);
+            return;
+        }
+        out.writeBit(true);
+
+        int leading = leadingZeros(x);
+        int trailing = trailingZeros(x);
+        if (leading > 31) {
+            leading = 31;   // 5 bit 最多表示 31
+        }
+
+        if (prevLeading_ >= 0 && leading >= prevLeading_ && trailing >= prevTrailing_) {
+            out.writeBit(false);
+            int meaningful = 64 - prevLeading_ - prevTrailing_;
+            out.write(x >> prevTrailing_, meaningful);
+            return;
+        }
+
+        int meaningful = 64 - leading - trailing;
+        out.writeBit(true);
+        out.write(static_cast<uint64_t>(leading), 5);
+        out.write(static_cast<uint64_t>(meaningful & 63), 6);  // 64 记作 0
+        out.write(x >> trailing, meaningful);
+        prevLeading_ = leading;
+        prevTrailing_ = trailing;
+    }
+
+private:
+    bool first_{true};
+    uint64_t prev_{0};
+    int prevLeading_{-1};
+    int prevTrailing_{0};
+};
+
+class XorDecoder {
+public:
+    double next(BitReader& in) {
+        if (first_) {
+            prev_ = in.read(64);
+            first_ = false;
+            return bitsDouble(prev_);
+        }
+
+        if (!in.readBit()) {
+            return bitsDouble(prev_);
+        }
+
+        if (in.readBit()) {
+            leading_ = static_cast<int>(in.read(5));
+            int meaningful = static_cast<int>(in.read(6));
+            if (meaningful == 0) {
+                meaningful = 64;
+            }
+            trailing_ = 64 - leading_ - meaningful;
+        }
+        int meaningful = 64 - leading_ - trailing_;
+        uint64_t x = in.read(meaningful) << trailing_;
+        prev_ ^= x;
+        return bitsDouble(prev_);
+    }
+
+private:
+    bool first_{true};
+    uint64_t prev_{0};
+    int leading_{0};
+    int trailing_{0};
+};
+
+} // namespace infrastructure::cache::gorilla
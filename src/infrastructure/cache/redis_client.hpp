@@ -15,6 +15,7 @@
 #include "core/configuration.hpp"
 #include "core/logger.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/metrics.hpp"
 
 namespace infrastructure::cache {
 
@@ -22,7 +23,7 @@ class RedisClient {
 public:
     RedisClient(const core::RedisConfig& config, monitoring::HealthMonitor& monitor)
         : config_(config)
-        , monitor_(monitor) {
+        , health_(monitor.registerComponent("redis_client")) {
     }
 
     ~RedisClient() {
@@ -48,12 +49,13 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(setLatency_);
             if (ttl.count() > 0) {
                 redis_->setex(key, ttl.count(), value);
             } else {
                 redis_->set(key, value);
             }
-            monitor_.update("redis_client", true, "SET operation successful");
+            health_.update(true, "SET operation successful");
             return true;
         } catch (const sw::redis::Error& ex) {
             handleFailure(std::string("SET failed: ") + ex.what());
@@ -69,9 +71,10 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(getLatency_);
             auto val = redis_->get(key);
             if (val) {
-                monitor_.update("redis_client", true, "GET operation successful");
+                health_.update(true, "GET operation successful");
                 return *val;
             }
             return std::nullopt;
@@ -89,8 +92,9 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(lpushLatency_);
             redis_->lpush(key, value);
-            monitor_.update("redis_client", true, "LPUSH operation successful");
+            health_.update(true, "LPUSH operation successful");
             return true;
         } catch (const sw::redis::Error& ex) {
             handleFailure(std::string("LPUSH failed: ") + ex.what());
@@ -106,6 +110,7 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(ltrimLatency_);
             redis_->ltrim(key, start, stop);
             return true;
         } catch (const sw::redis::Error& ex) {
@@ -122,9 +127,10 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(lrangeLatency_);
             std::vector<std::string> result;
             redis_->lrange(key, start, stop, std::back_inserter(result));
-            monitor_.update("redis_client", true, "LRANGE operation successful");
+            health_.update(true, "LRANGE operation successful");
             return result;
         } catch (const sw::redis::Error& ex) {
             handleFailure(std::string("LRANGE failed: ") + ex.what());
@@ -140,6 +146,7 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(expireLatency_);
             redis_->expire(key, ttl.count());
             return true;
         } catch (const sw::redis::Error& ex) {
@@ -156,8 +163,9 @@ public:
         }
 
         try {
+            monitoring::ScopedLatency latency(publishLatency_);
             redis_->publish(channel, message);
-            monitor_.update("redis_client", true, "PUBLISH operation successful");
+            health_.update(true, "PUBLISH operation successful");
             return true;
         } catch (const sw::redis::Error& ex) {
             handleFailure(std::string("PUBLISH failed: ") + ex.what());
@@ -213,7 +221,7 @@ private:
             // 测试连接
             redis_->ping();
 
-            monitor_.update("redis_client", true, "Redis connected");
+            health_.update(true, "Redis connected");
             LOG_INFO("redis_client", "Connected to Redis at ", config_.host, ":", config_.port);
             return true;
         } catch (const sw::redis::Error& ex) {
@@ -231,15 +239,31 @@ private:
 
     // 处理故障
     void handleFailure(const std::string& reason) {
+        errors_.inc();
         LOG_WARN("redis_client", reason);
-        monitor_.update("redis_client", false, reason);
+        health_.update(false, reason);
     }
 
     core::RedisConfig config_;
-    monitoring::HealthMonitor& monitor_;
+    monitoring::HealthMonitor::Handle health_;  // 健康状态句柄（构造时登记一次）
     std::unique_ptr<sw::redis::Redis> redis_;
     mutable std::mutex mutex_;
     std::chrono::steady_clock::time_point lastAttempt_{};
+
+    // 各命令的耗时（不含 ensureConnection）
+    static monitoring::Histogram& opLatency(const char* op) {
+        return monitoring::MetricsRegistry::instance().histogram(
+            "aqua_redis_op_seconds", "Redis command latency", std::string("op=\"") + op + "\"");
+    }
+    monitoring::Histogram& setLatency_ = opLatency("set");
+    monitoring::Histogram& getLatency_ = opLatency("get");
+    monitoring::Histogram& lpushLatency_ = opLatency("lpush");
+    monitoring::Histogram& ltrimLatency_ = opLatency("ltrim");
+    monitoring::Histogram& lrangeLatency_ = opLatency("lrange");
+    monitoring::Histogram& expireLatency_ = opLatency("expire");
+    monitoring::Histogram& publishLatency_ = opLatency("publish");
+    monitoring::Counter& errors_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_redis_errors_total", "Failed Redis commands and connection attempts");
 };
 
 } // namespace infrastructure::cache
@@ -36,6 +36,8 @@ std::vector<domain::TelemetryReading> TelemetryRepository::loadEnvironmental(std
     // 刷新连接（如果中断）
     refreshConnection();
 
+    monitoring::ScopedLatency latency(environmentalLatency_);
+
     //构造sql查询
     std::ostringstream oss;
     oss << "SELECT time, temperature, humidity, light "
@@ -44,12 +46,14 @@ std::vector<domain::TelemetryReading> TelemetryRepository::loadEnvironmental(std
 
     //执行查询
     if (!client_.execute(oss.str())) {
+        errors_.inc();
         return {};  // 查询失败，返回空数组
     }
 
     // 获取结果集
     MYSQL_RES* res = client_.storeResult();
     if (res == nullptr) {
+        errors_.inc();
         LOG_ERROR("telemetry_repo", "mysql_store_result() returned null");
         return {};
     }
@@ -73,17 +77,20 @@ std::vector<domain::TelemetryReading> TelemetryRepository::loadEnvironmental(std
 std::vector<domain::TelemetryReading> TelemetryRepository::loadSoilAndAir(std::size_t limit) {
     refreshConnection();
 
+    monitoring::ScopedLatency latency(soilAndAirLatency_);
     std::ostringstream oss;
     oss << "SELECT time, soil, gas, raindrop "
         << "FROM soil_and_air_quality "
         << "ORDER BY time DESC LIMIT " << limit;
 
     if (!client_.execute(oss.str())) {
+        errors_.inc();
         return {};
     }
 
     MYSQL_RES* res = client_.storeResult();
     if (res == nullptr) {
+        errors_.inc();
         LOG_ERROR("telemetry_repo", "mysql_store_result() returned null");
         return {};
     }
@@ -7,6 +7,7 @@
 #include "core/configuration.hpp"
 #include "domain/telemetry_models.hpp"
 #include "infrastructure/database/mariadb_client.hpp"
+#include "monitoring/metrics.hpp"
 
 namespace infrastructure::database {
 
@@ -34,6 +35,14 @@ private:
 
     core::DatabaseConfig config_;   // 保存配置
     MariaDbClient client_;  // 数据库连接对象
+
+    // 查询耗时（执行 + 取结果集 + 转换）
+    monitoring::Histogram& environmentalLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_db_query_seconds", "MariaDB query latency", "query=\"environmental\"");
+    monitoring::Histogram& soilAndAirLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_db_query_seconds", "MariaDB query latency", "query=\"soil_and_air\"");
+    monitoring::Counter& errors_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_db_errors_total", "Failed MariaDB queries");
 };
 
 } // namespace infrastructure::database
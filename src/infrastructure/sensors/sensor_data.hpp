@@ -21,6 +21,8 @@
 #include "domain/telemetry_models.hpp"
 #include "modbus_tcp.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/metrics.hpp"
+#include "monitoring/tracing.hpp"
 
 //传感器（modbus设备数据）
 class SensorGateway {
@@ -28,7 +30,7 @@ public:
     // 传入配置和健康监控器
     SensorGateway(core::SensorConfig config, monitoring::HealthMonitor& monitor)
         : config_(std::move(config))
-        , monitor_(monitor) {
+        , health_(monitor.registerComponent("sensor_gateway")) {
     }
 
     ~SensorGateway() {
@@ -49,6 +51,8 @@ public:
         std::vector<uint16_t> registers(config_.registers, 0);
         try 
         {
+            monitoring::ScopedLatency latency(readLatency_);
+            monitoring::TraceSpan span("modbus_read");  // Modbus 请求发出到响应返回
             // 从地址 0 开始，读取 config_.registers 个寄存器
             modbus_->readRegisters(0, config_.registers, registers.data());
         } 
@@ -60,6 +64,7 @@ public:
         }
 
         // 创建 TelemetryReading 对象
+        monitoring::TraceSpan decodeSpan("decode");
         domain::TelemetryReading reading;
         reading.label = "Realtime";
         reading.timestamp = currentTimestamp();
@@ -81,7 +86,7 @@ public:
         }
 
         // 更新健康状态（成功）
-        monitor_.update("sensor_gateway", true, "Realtime sample collected");
+        health_.update(true, "Realtime sample collected");
         return reading;
     }
 
@@ -97,8 +102,9 @@ public:
         }
         try 
         {
+            monitoring::ScopedLatency latency(writeLatency_);
             modbus_->writeRegister(address, value); 
-            monitor_.update("sensor_gateway", true, "Register write successful");
+            health_.update(true, "Register write successful");
         } 
         catch (const std::exception& ex) 
         {
@@ -132,7 +138,7 @@ private:
             //建立连接
             modbus_->connect();
             //更新健康检查
-            monitor_.update("sensor_gateway", true, "Modbus connected");
+            health_.update(true, "Modbus connected");
             LOG_INFO("sensor_gateway", "Connected to Modbus sensor at ", config_.endpoint, ":", config_.port);
             return true;
         } 
@@ -154,8 +160,9 @@ private:
     // 处理故障（记录日志和更新健康状态）
     void handleFailure(const std::string& reason) 
     {
+        errors_.inc();
         LOG_WARN("sensor_gateway", reason);
-        monitor_.update("sensor_gateway", false, reason);
+        health_.update(false, reason);
     }
 
     // 获取当前时间的字符串表示
@@ -175,8 +182,14 @@ private:
     }
 
     core::SensorConfig config_; // Modbus 配置
-    monitoring::HealthMonitor& monitor_;    // 健康监控器引用
+    monitoring::HealthMonitor::Handle health_;    // 健康监控器引用
     std::unique_ptr<ModbusTCP> modbus_; // Modbus 连接（智能指针自动管理）
+    monitoring::Histogram& readLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_modbus_read_seconds", "Modbus realtime register read round trip");
+    monitoring::Histogram& writeLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_modbus_write_seconds", "Modbus register write round trip");
+    monitoring::Counter& errors_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_modbus_errors_total", "Failed Modbus operations and connection attempts");
     std::mutex mutex_;
     std::chrono::steady_clock::time_point lastAttempt_{};   // 上次尝试连接的时间
 };
@@ -9,6 +9,8 @@
 #include "core/logger.hpp"
 #include "services/data_manager_redis.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/metrics_server.hpp"
+#include "monitoring/tracing.hpp"
 #include "infrastructure/sensors/sensor_data.hpp"
 #include "transport/sensor_data_settings.hpp"
 #include "transport/tcp_data_sender.hpp"
@@ -30,20 +32,53 @@ void handleSignal(int)
 }
 
 int main() {
-    // 设置最低日志级别、打印到哪个文件、是否要输出到控制台
-    core::Logger::instance().configure(core::LogLevel::Info, "logs/aqua_regulator.log");
-
-    //加载配置
+    //加载配置（此时日志还未配置，加载过程中的告警同步输出到控制台）
     core::ConfigurationManager configManager("config/app_config.json");
     const auto& config = configManager.get();   //拿到配置，存在config里
 
+    // 设置最低日志级别、打印到哪个文件、是否要输出到控制台，并启动异步写线程
+    core::LoggerOptions logOptions;
+    logOptions.level = core::parseLogLevel(config.logging.level);
+    logOptions.useConsole = config.logging.console;
+    logOptions.queueCapacity = config.logging.queueCapacity;
+    logOptions.flushInterval = std::chrono::milliseconds(config.logging.flushIntervalMs);
+    logOptions.rotation.maxBytes = static_cast<uint64_t>(config.logging.maxFileMb) * 1024 * 1024;
+    logOptions.rotation.maxAge = std::chrono::hours(config.logging.maxFileAgeHours);
+    logOptions.rotation.keepFiles = config.logging.keepFiles;
+    logOptions.rotation.preallocate = config.logging.preallocate;
+    for (const auto& [component, level] : config.logging.components) {
+        logOptions.componentLevels.emplace_back(component, core::parseLogLevel(level, logOptions.level));
+    }
+    if (config.logging.format == "binary") {
+        // 二进制模式：LOG_* 只拷贝原始参数，控制台仅回显告警及以上级别
+        logOptions.binary = true;
+        logOptions.binaryPath = config.logging.binaryFile;
+        logOptions.threadBufferBytes = static_cast<std::size_t>(config.logging.threadBufferKb) * 1024;
+    } else {
+        logOptions.filePath = config.logging.file;
+    }
+    core::Logger::instance().configure(logOptions);
+
+    // 帧延迟追踪（关闭时也分配环形缓冲区，运行时可用 trace 命令打开）
+    monitoring::Tracer::instance().configure(config.tracing.enabled, config.tracing.sampleEvery,
+                                             config.tracing.slowFrameMs, config.tracing.ringCapacity);
+
     //创建健康监控，传入写健康状态的文件路径和检查间隔
     monitoring::HealthMonitor healthMonitor(config.health.statusFile,
-                                            std::chrono::seconds(config.health.intervalSeconds));
+                                            std::chrono::seconds(config.health.intervalSeconds),
+                                            std::chrono::seconds(config.health.heartbeatSeconds),
+                                            config.health.statusBlock);
     
     //后台专门有一个线程，定期将monitor中的states（各个模块的健康状态）写入文件中
     healthMonitor.start();
 
+    // 可选的本地观测端口：/metrics（Prometheus）和 /health
+    monitoring::MetricsServer metricsServer(monitoring::MetricsRegistry::instance(), healthMonitor);
+    if (config.metrics.enabled && !metricsServer.start(config.metrics.bindAddress, config.metrics.port)) {
+        // 观测端口不是核心功能，失败了继续运行
+        LOG_WARN("bootstrap", "Metrics endpoint failed to start");
+    }
+
     //初始化数据库（数据通过TelemetryReading类型传输）
     infrastructure::database::TelemetryRepository repository;
     if (!repository.initialize(config.database)) {  // 初始化数据库配置
@@ -57,6 +92,7 @@ int main() {
 
     
     TelemetryPublisher* publisherPtr = nullptr; // 保存指针用于诊断
+    VideoManager* videoPtr = nullptr;
 
     // 处理来自客户端的各种命令（JSON 格式），执行相应的动作（写入寄存器，更新健康检查），并返回响应
     DeviceCommandRouter router(
@@ -64,9 +100,40 @@ int main() {
         healthMonitor,
         [&]() { // 诊断信息提供者
             nlohmann::json json;
-            json["telemetry"]["subscribers"] = publisherPtr ? publisherPtr->hasSubscribers() : false;   //返回是否有订阅者（客户端连接）
+            json["telemetry"]["subscribers"] = publisherPtr ? publisherPtr->hasSubscribers() : false;   //返回是否有订阅者（客户端连接或环的读端）
+            json["telemetry"]["tcpClients"] = publisherPtr ? publisherPtr->clientCount() : 0;          // 已连接的 TCP 客户端数
+            json["telemetry"]["ringReaders"] = publisherPtr ? publisherPtr->ringHasReaders() : false;  // 共享内存环上有没有读端
             json["pipeline"]["realtimeSeconds"] = config.pipeline.realtimeIntervalSeconds;  // 拿到modbus实时数据的采集间隔（5s）
             json["pipeline"]["historicalSeconds"] = config.pipeline.historicalIntervalSeconds;  // 拿到modbus历史数据的采集间隔（30s）
+            json["video"]["subscribers"] = nlohmann::json::array();
+            if (videoPtr) {
+                // 每个订阅端的队列深度、待发字节和丢包数
+                for (const auto& stats : videoPtr->subscriberStats()) {
+                    json["video"]["subscribers"].push_back({{"id", stats.id},
+                                                            {"queued", stats.queued},
+                                                            {"pendingBytes", stats.pendingBytes},
+                                                            {"sentPackets", stats.sentPackets},
+                                                            {"sentBytes", stats.sentBytes},
+                                                            {"dropped", stats.dropped},
+                                                            {"framed", stats.framedOutput},
+                                                            {"waitingKeyframe", stats.waitingKeyframe}});
+                }
+                // 各路流的推流端、订阅端个数、所属转发线程和转发计数
+                json["video"]["streams"] = nlohmann::json::array();
+                for (const auto& stream : videoPtr->streamStats()) {
+                    json["video"]["streams"].push_back({{"name", stream.name},
+                                                        {"number", stream.number},
+                                                        {"publisher", stream.publisher},
+                                                        {"subscribers", stream.subscribers},
+                                                        {"worker", stream.worker},
+                                                        {"gopFrames", stream.gopFrames},
+                                                        {"packetsIn", stream.packetsIn},
+                                                        {"bytesIn", stream.bytesIn},
+                                                        {"bytesOut", stream.bytesOut},
+                                                        {"packetsPerSecond", stream.packetRate},
+                                                        {"lastPacketAgeMs", stream.lastPacketAgeMs}});
+                }
+            }
             return json;
         },
         [&]() { // 配置重载回调（将配置重新加载设置为true）
@@ -90,7 +157,8 @@ int main() {
     telemetryService.start();
 
     // 启动视频管理器
-    VideoManager videoManager(&healthMonitor);
+    VideoManager videoManager(config.video, &healthMonitor);
+    videoPtr = &videoManager;
     if (!videoManager.start(config.video.port)) {
         // 视频不是核心功能，失败了继续运行
         LOG_WARN("bootstrap", "Video manager failed to start");
@@ -126,7 +194,11 @@ int main() {
     videoManager.stop();
     telemetryService.stop();
     publisher.stop();
+    metricsServer.stop();
     healthMonitor.stop();
 
+    // 停止日志后台线程，把剩余日志同步写出
+    core::Logger::instance().shutdown();
+
     return EXIT_SUCCESS;
 }
@@ -1,18 +1,48 @@
 // 定期收集各个模块的健康状态，写入 JSON 文件（本地文件），供外部监控系统（如 Prometheus、Kubernetes）读取
+// 只在状态变化或心跳到期时写文件（边缘设备的 SD 卡按写入次数磨损），写临时文件后 rename 替换
 
 #include "monitoring/health_monitor.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
-#include <fstream>
 #include <nlohmann/json.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "core/logger.hpp"
 
 namespace monitoring {
 
-HealthMonitor::HealthMonitor(std::string path, std::chrono::seconds interval)
+namespace {
+
+// 粗粒度的当前时间（秒）：CLOCK_REALTIME_COARSE 只读 vDSO 里的缓存值，比 system_clock::now() 便宜
+int64_t coarseNow() {
+#if defined(CLOCK_REALTIME_COARSE)
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec);
+#else
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+#endif
+}
+
+} // namespace
+
+static_assert(status_block::kDetailBytes == HealthMonitor::kDetailBytes, "status block detail size mismatch");
+
+HealthMonitor::HealthMonitor(std::string path,
+                             std::chrono::seconds interval,
+                             std::chrono::seconds heartbeat,
+                             std::string statusBlockPath)
     : filePath_(std::move(path))
-    , interval_(interval) {
+    , interval_(interval)
+    , heartbeat_(heartbeat)
+    , blockPath_(std::move(statusBlockPath)) {
 }
 
 HealthMonitor::~HealthMonitor() {
@@ -28,6 +58,7 @@ void HealthMonitor::start() {
     // 启动后台工作线程
     // 非静态成员函数其实都有一个隐藏的第一个参数，那就是 this 指针
     // 当你调用 HealthMonitor::writerLoop 时，它是一个成员函数。成员函数必须绑定到一个具体的对象实例上才能运行
+    openStatusBlock();
     worker_ = std::thread(&HealthMonitor::writerLoop, this);
 }
 
@@ -38,40 +69,166 @@ void HealthMonitor::stop() {
     if (worker_.joinable()) {
         worker_.join(); // 等待工作线程完成
     }
+    closeStatusBlock();
+}
+
+HealthMonitor::Handle HealthMonitor::registerComponent(std::string_view component) {
+    if (Slot* slot = find(component)) {
+        return Handle(slot);
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (Slot* slot = find(component)) {
+        return Handle(slot);    // 其他线程刚登记过
+    }
+    const std::size_t index = count_.load(std::memory_order_relaxed);
+    if (index >= kMaxComponents) {
+        LOG_ERROR("health_monitor", "Too many components, ignoring ", component);
+        return Handle();
+    }
+    slots_[index].name.assign(component);
+    count_.store(index + 1, std::memory_order_release);
+    return Handle(&slots_[index]);
+}
+
+std::size_t HealthMonitor::addProbe(std::string_view component, Probe probe) {
+    Handle handle = registerComponent(component);
+    std::lock_guard<std::mutex> lk(probesMutex_);
+    const std::size_t id = nextProbeId_++;
+    probes_.push_back(ProbeEntry{id, handle, std::move(probe)});
+    return id;
+}
+
+void HealthMonitor::removeProbe(std::size_t id) {
+    std::lock_guard<std::mutex> lk(probesMutex_);
+    probes_.erase(std::remove_if(probes_.begin(), probes_.end(), [id](const ProbeEntry& entry) { return entry.id == id; }),
+                  probes_.end());
+}
+
+void HealthMonitor::runProbes() {
+    std::lock_guard<std::mutex> lk(probesMutex_);
+    for (const auto& entry : probes_) {
+        entry.probe(entry.handle);
+    }
+}
+
+HealthMonitor::Slot* HealthMonitor::find(std::string_view component) const {
+    const std::size_t count = count_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (slots_[i].name == component) {
+            return const_cast<Slot*>(&slots_[i]);
+        }
+    }
+    return nullptr;
 }
 
 // 更新健康状态
 void HealthMonitor::update(const std::string& component, bool healthy, const std::string& detail) {
-    std::lock_guard<std::mutex> lk(mutex_);
-    states_[component] = HealthState{healthy, detail, std::chrono::system_clock::now()};
+    registerComponent(component).update(healthy, detail);
+}
+
+void HealthMonitor::Slot::update(bool healthy, std::string_view detail) {
+    const int64_t now = coarseNow();
+    for (std::size_t attempt = 0; attempt < kBuffers; ++attempt) {
+        // 只有一个线程能拿到这块缓冲区（偶数 -> 奇数），拿不到就换下一块
+        const uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        DetailBuffer& buffer = details[ticket % kBuffers];
+        uint32_t sequence = buffer.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1u) != 0 ||
+            !buffer.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            continue;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        buffer.ticket = ticket;
+        buffer.healthy = healthy;
+        buffer.updatedAt = now;
+        buffer.length = static_cast<uint32_t>(std::min(detail.size(), kDetailBytes));
+        std::memcpy(buffer.text, detail.data(), buffer.length);
+        buffer.sequence.store(sequence + 2, std::memory_order_release);
+        return;
+    }
+}
+
+bool HealthMonitor::Slot::read(HealthState& state) const {
+    // 每块按 seqlock 读：前后两次序号一致且为偶数，说明拷贝期间没有被改写；
+    // 在读到的几块里取 ticket 最新的（某块正在被改写时用其余的，不必等）
+    char text[kDetailBytes];
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        bool found = false;
+        uint32_t newest = 0;
+        for (const DetailBuffer& buffer : details) {
+            const uint32_t before = buffer.sequence.load(std::memory_order_acquire);
+            if (before & 1u) {
+                continue;
+            }
+            const uint32_t ticket = buffer.ticket;
+            const bool healthy = buffer.healthy;
+            const int64_t time = buffer.updatedAt;
+            const uint32_t length = std::min<uint32_t>(buffer.length, kDetailBytes);
+            std::memcpy(text, buffer.text, length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer.sequence.load(std::memory_order_relaxed) != before || time == 0) {
+                continue;
+            }
+            if (!found || static_cast<int32_t>(ticket - newest) > 0) {
+                found = true;
+                newest = ticket;
+                state.healthy = healthy;
+                state.updatedAt = std::chrono::system_clock::time_point(std::chrono::seconds(time));
+                state.detail.assign(text, length);
+            }
+        }
+        if (found) {
+            return true;
+        }
+        if (std::none_of(details.begin(), details.end(),
+                         [](const DetailBuffer& buffer) { return buffer.sequence.load(std::memory_order_relaxed) != 0; })) {
+            return false;   // 尚未更新过
+        }
+    }
+    return false;   // 几块一直在被改写（极少见）：这一轮不报告这个组件
+}
+
+std::map<std::string, HealthState> HealthMonitor::snapshot() const {
+    std::map<std::string, HealthState> result;
+    const std::size_t count = count_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i) {
+        HealthState state;
+        if (slots_[i].read(state)) {
+            result.emplace(slots_[i].name, std::move(state));
+        }
+    }
+    return result;
 }
 
 
 void HealthMonitor::writerLoop() {
     // 后台线程主循环
     while (running_) {
-        // 把状态写入文件
-        flushToDisk();
+        runProbes();
+        const auto states = snapshot();
+        publishStatusBlock(states);
+        persist(states, false);
 
         // 睡眠指定的间隔
         std::this_thread::sleep_for(interval_);
     }
 
     // 线程退出前最后写一次
-    flushToDisk();
+    runProbes();
+    const auto states = snapshot();
+    publishStatusBlock(states);
+    persist(states, true);
 }
 
-void HealthMonitor::flushToDisk() {
-    // 获取当前状态的快照
-    std::map<std::string, HealthState> snapshot;
-    {
-        std::lock_guard<std::mutex> lk(mutex_);
-        snapshot = states_;
-    }// 锁自动释放
+std::string HealthMonitor::renderJson() const {
+    // 获取当前状态的快照（逐个槽位无锁读取）
+    return renderJson(snapshot());
+}
 
-    // 转换为 JSON
-    nlohmann::json json;
-    for (const auto& [component, state] : snapshot) {
+std::string HealthMonitor::renderJson(const std::map<std::string, HealthState>& states) {
+    nlohmann::json json = nlohmann::json::object();
+    for (const auto& [component, state] : states) {
         // 把时间点转换为 Unix 时间戳
         auto time = std::chrono::system_clock::to_time_t(state.updatedAt);
         json[component] = {
@@ -80,17 +237,141 @@ void HealthMonitor::flushToDisk() {
             {"updatedAt", time}
         };
     }
+    return json.dump();     // 紧凑格式，文件更小
+}
 
+void HealthMonitor::persist(const std::map<std::string, HealthState>& states, bool force) {
+    // 签名只包含状态和详细信息：只有时间戳变化（组件定期上报同样的状态）不算变化，等心跳再写
+    std::string signature;
+    for (const auto& [component, state] : states) {
+        signature.append(component).push_back('\0');
+        signature.push_back(state.healthy ? '1' : '0');
+        signature.append(state.detail).push_back('\0');
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const bool changed = signature != lastSignature_;
+    const bool heartbeatDue = heartbeat_.count() > 0 && now - lastWrite_ >= heartbeat_;
+    if (!force && !changed && !heartbeatDue) {
+        return;
+    }
+
+    if (flushToDisk(renderJson(states))) {
+        lastSignature_ = std::move(signature);
+        lastWrite_ = now;
+    }
+}
+
+bool HealthMonitor::flushToDisk(const std::string& text) {
+    const std::string tempPath = filePath_ + ".tmp";
     try {
         // 确保目录存在
         std::filesystem::create_directories(std::filesystem::path(filePath_).parent_path());
-
-        // 写入文件（覆盖模式）
-        std::ofstream out(filePath_, std::ios::out | std::ios::trunc);
-        out << json.dump(4);    // 缩进 4 个空格
     } catch (const std::exception& ex) {
         LOG_ERROR("health_monitor", "Failed to persist health information: ", ex.what());
+        return false;
+    }
+
+    const int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("health_monitor", "Failed to open ", tempPath, ": ", std::strerror(errno));
+        return false;
+    }
+
+    std::size_t written = 0;
+    while (written < text.size()) {
+        const ssize_t n = ::write(fd, text.data() + written, text.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+
+    // 先落盘再 rename：掉电后要么是旧文件，要么是完整的新文件
+    const bool ok = written == text.size() && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tempPath.c_str(), filePath_.c_str()) != 0) {
+        LOG_ERROR("health_monitor", "Failed to persist health information: ", std::strerror(errno));
+        ::unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void HealthMonitor::openStatusBlock() {
+    if (blockPath_.empty() || block_ != nullptr) {
+        return;
+    }
+
+    const std::size_t size = status_block::blockSize(kMaxComponents);
+    const int fd = ::open(blockPath_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        LOG_ERROR("health_monitor", "Failed to create status block ", blockPath_, ": ", std::strerror(errno));
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+    void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("health_monitor", "Failed to map status block ", blockPath_, ": ", std::strerror(errno));
+        return;
+    }
+
+    block_ = static_cast<status_block::Header*>(mapped);
+    const uint64_t sequence = block_->sequence.load(std::memory_order_relaxed);
+    block_->sequence.store(sequence | 1u, std::memory_order_relaxed);     // 上次异常退出可能停在奇数
+    std::atomic_thread_fence(std::memory_order_release);
+    block_->magic = status_block::kMagic;
+    block_->version = status_block::kVersion;
+    block_->capacity = static_cast<uint32_t>(kMaxComponents);
+    block_->count = 0;
+    block_->publishedAt = 0;
+    block_->sequence.store((sequence | 1u) + 1, std::memory_order_release);
+    LOG_INFO("health_monitor", "Publishing status block at ", blockPath_);
+}
+
+void HealthMonitor::publishStatusBlock(const std::map<std::string, HealthState>& states) {
+    if (block_ == nullptr) {
+        return;
+    }
+
+    // seqlock 写：序号先变奇数，写完再变偶数
+    const uint64_t sequence = block_->sequence.load(std::memory_order_relaxed);
+    block_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    status_block::Entry* entries = status_block::entries(block_);
+    uint32_t count = 0;
+    for (const auto& [component, state] : states) {
+        if (count >= block_->capacity) {
+            break;
+        }
+        status_block::Entry& entry = entries[count++];
+        std::memset(&entry, 0, sizeof(entry));
+        std::memcpy(entry.name, component.data(), std::min(component.size(), status_block::kNameBytes - 1));
+        entry.status = state.healthy ? 1 : 2;
+        entry.updatedAt = std::chrono::duration_cast<std::chrono::seconds>(state.updatedAt.time_since_epoch()).count();
+        entry.detailLength = static_cast<uint32_t>(std::min(state.detail.size(), status_block::kDetailBytes));
+        std::memcpy(entry.detail, state.detail.data(), entry.detailLength);
+    }
+    block_->count = count;
+    block_->publishedAt = coarseNow();
+
+    block_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void HealthMonitor::closeStatusBlock() {
+    if (block_ == nullptr) {
+        return;
     }
+    // 文件保留：探针通过 publishedAt 不再更新判断进程已退出
+    ::munmap(block_, status_block::blockSize(kMaxComponents));
+    block_ = nullptr;
 }
 
 } // namespace monitoring
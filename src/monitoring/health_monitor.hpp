@@ -1,11 +1,18 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
+
+#include "monitoring/health_status_block.hpp"
 
 namespace monitoring {
 
@@ -17,11 +24,44 @@ struct HealthState {
 };
 
 class HealthMonitor {
+    struct Slot;
+
 public:
+    static constexpr std::size_t kMaxComponents = 64;   // 组件槽位个数
+    static constexpr std::size_t kDetailBytes = 120;    // 详细信息最大长度（超出截断）
+
+    // 组件句柄：registerComponent 一次，之后的 update 都是无锁、无分配的写入
+    // 默认构造的句柄为空，update 什么都不做
+    class Handle {
+    public:
+        Handle() = default;
+
+        // 更新健康状态（可在任意线程调用）
+        void update(bool healthy, std::string_view detail) const {
+            if (slot_ != nullptr) {
+                slot_->update(healthy, detail);
+            }
+        }
+
+        explicit operator bool() const { return slot_ != nullptr; }
+
+    private:
+        friend class HealthMonitor;
+        explicit Handle(Slot* slot)
+            : slot_(slot) {}
+
+        Slot* slot_{nullptr};
+    };
+
     // 构造函数
     // path: 健康状态输出文件路径
-    // interval: 检查间隔
-    HealthMonitor(std::string path, std::chrono::seconds interval);
+    // interval: 检查间隔（状态有变化才写文件）
+    // heartbeat: 状态没变化时重写文件的最长间隔（刷新 updatedAt；0 表示只在变化时写）
+    // statusBlockPath: 二进制状态块路径（为空不发布，建议放在 /dev/shm）
+    HealthMonitor(std::string path,
+                  std::chrono::seconds interval,
+                  std::chrono::seconds heartbeat = std::chrono::seconds(60),
+                  std::string statusBlockPath = {});
     ~HealthMonitor();
 
     // 启动监控线程
@@ -30,23 +70,96 @@ public:
     // 停止监控线程
     void stop();
 
-    // 更新某个组件的健康状态
+    // 登记组件并返回句柄（同名组件返回同一个槽位；槽位用完时返回空句柄）
+    Handle registerComponent(std::string_view component);
+
+    // 探针：监控线程每个周期调用一次，组件在探针里根据自己的原子计数器更新状态（热路径不必逐包更新健康状态）
+    using Probe = std::function<void(const Handle&)>;
+
+    // 登记探针，返回的 ID 交给 removeProbe；组件析构前必须移除（移除时会等正在执行的探针结束）
+    std::size_t addProbe(std::string_view component, Probe probe);
+    void removeProbe(std::size_t id);
+
+    // 更新某个组件的健康状态（兼容接口：每次按名字查找槽位，热路径请用 Handle）
     void update(const std::string& component, bool healthy, const std::string& detail);
 
+    // 所有已更新过的组件的一致快照
+    std::map<std::string, HealthState> snapshot() const;
+
+    // 快照渲染为紧凑 JSON（健康文件和 /health 共用）
+    std::string renderJson() const;
+    static std::string renderJson(const std::map<std::string, HealthState>& states);
+
 private:
+    // 一块状态缓冲区（每块一个 seqlock：奇数表示正在写）：健康状态、时间和详细信息一起写、一起读，
+    // 读到的 healthy 和 detail 一定出自同一次 update
+    struct DetailBuffer {
+        std::atomic<uint32_t> sequence{0};
+        uint32_t ticket{0};         // 写入时取的 next 值，读端按它挑最新的一块
+        bool healthy{false};
+        int64_t updatedAt{0};       // 粗粒度时间戳（秒），0 表示尚未更新
+        uint32_t length{0};
+        char text[kDetailBytes]{};
+    };
+
+    // 一个组件的槽位：每次更新轮流写入几块缓冲区中的一块
+    // 多个线程同时更新同一组件时各自抢一块空闲的，不等待；几块都被占着（同时更新的线程多于 kBuffers）时放弃这次更新
+    struct alignas(64) Slot {
+        static constexpr std::size_t kBuffers = 4;
+
+        void update(bool healthy, std::string_view detail);
+        bool read(HealthState& state) const;
+
+        std::string name;                           // 发布（count_ 的 release 写）之后只读
+        std::atomic<uint32_t> next{0};              // 下一次写入的缓冲区（取模）
+        std::array<DetailBuffer, kBuffers> details;
+    };
+
+    // 按名字查找已发布的槽位（无锁）
+    Slot* find(std::string_view component) const;
+
+    struct ProbeEntry {
+        std::size_t id;
+        Handle handle;
+        Probe probe;
+    };
+
     // 后台工作线程主函数
     void writerLoop();
 
-    // 把当前状态写入文件
-    void flushToDisk();
+    // 依次调用各探针（工作线程，每个周期一次）
+    void runProbes();
+
+    // 状态（不含时间戳）有变化或心跳到期时写文件；force 为 true 时总是写
+    void persist(const std::map<std::string, HealthState>& states, bool force);
+
+    // 写临时文件后 rename 替换，读者要么看到旧文件要么看到新文件
+    bool flushToDisk(const std::string& text);
+
+    // 二进制状态块：映射 / 发布 / 解除映射
+    void openStatusBlock();
+    void publishStatusBlock(const std::map<std::string, HealthState>& states);
+    void closeStatusBlock();
 
     std::string filePath_;  //写入健康检查的文件路径
     std::chrono::seconds interval_; // 检查间隔
+    std::chrono::seconds heartbeat_;    // 无变化时的最长重写间隔
+
+    std::string lastSignature_;     // 上次写入时各组件的状态和详细信息（不含时间戳）
+    std::chrono::steady_clock::time_point lastWrite_{};
+
+    std::string blockPath_;
+    status_block::Header* block_{nullptr};  // mmap 映射的状态块（只由工作线程写）
+
+    std::array<Slot, kMaxComponents> slots_;    // 各组件的健康状态（只追加，不删除）
+    std::atomic<std::size_t> count_{0};         // 已发布的槽位个数
+    std::mutex mutex_;                          // 只在登记新组件时使用
 
-    std::map<std::string, HealthState> states_; //存储健康检查信息
-    std::mutex mutex_;
+    std::mutex probesMutex_;                    // 保护 probes_，探针执行期间持有
+    std::vector<ProbeEntry> probes_;
+    std::size_t nextProbeId_{1};
 
-    std::thread worker_;    
+    std::thread worker_;
     std::atomic<bool> running_{false};  //线程是否循环
 };
 
@@ -0,0 +1,129 @@
+// 健康状态二进制块：HealthMonitor 把各组件状态按固定布局写进一个 mmap 共享文件（建议放在 /dev/shm），
+// 本机探针直接映射读取，不需要解析 JSON，也不会读到写了一半的内容（整块由一个 seqlock 保护）
+// 布局只追加字段并递增 kVersion，读端按版本判断
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace monitoring::status_block {
+
+inline constexpr uint32_t kMagic = 0x53485141;     // "AQHS"
+inline constexpr uint32_t kVersion = 1;
+inline constexpr std::size_t kNameBytes = 48;
+inline constexpr std::size_t kDetailBytes = 120;
+
+struct Entry {
+    char name[kNameBytes];
+    uint8_t status;             // 0：尚未更新，1：健康，2：异常
+    uint8_t reserved[3];
+    uint32_t detailLength;
+    int64_t updatedAt;          // Unix 时间戳（秒）
+    char detail[kDetailBytes];
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint64_t> sequence;     // 奇数表示正在写
+    uint32_t capacity;                  // entries 个数上限
+    uint32_t count;                     // 有效 entries 个数
+    int64_t publishedAt;                // 最近一次发布的 Unix 时间戳（秒），探针据此判断进程是否还活着
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "status block needs a lock-free 64-bit atomic");
+
+inline std::size_t blockSize(uint32_t capacity) {
+    return sizeof(Header) + sizeof(Entry) * capacity;
+}
+
+inline Entry* entries(Header* header) {
+    return reinterpret_cast<Entry*>(reinterpret_cast<char*>(header) + sizeof(Header));
+}
+
+inline const Entry* entries(const Header* header) {
+    return reinterpret_cast<const Entry*>(reinterpret_cast<const char*>(header) + sizeof(Header));
+}
+
+// 读到的一个组件
+struct Status {
+    std::string name;
+    uint8_t status{0};
+    int64_t updatedAt{0};
+    std::string detail;
+};
+
+// 读取状态块（探针使用）；成功返回 true，publishedAt 为最近一次发布时间
+inline bool read(const std::string& path, std::vector<Status>& result, int64_t& publishedAt, std::string& error) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        error = "status block too small";
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = "mmap failed";
+        return false;
+    }
+
+    const auto* header = static_cast<const Header*>(mapped);
+    bool ok = false;
+    if (header->magic != kMagic || header->version != kVersion) {
+        error = "unknown status block format";
+    } else if (blockSize(header->capacity) > size) {
+        error = "truncated status block";
+    } else {
+        // seqlock 读：写端正在发布时重试
+        for (int attempt = 0; attempt < 100 && !ok; ++attempt) {
+            const uint64_t before = header->sequence.load(std::memory_order_acquire);
+            if (before & 1u) {
+                ::usleep(100);
+                continue;
+            }
+            const uint32_t count = std::min(header->count, header->capacity);
+            std::vector<Entry> copy(entries(header), entries(header) + count);
+            const int64_t published = header->publishedAt;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) != before) {
+                continue;
+            }
+
+            result.clear();
+            for (const auto& entry : copy) {
+                Status status;
+                status.name.assign(entry.name, strnlen(entry.name, kNameBytes));
+                status.status = entry.status;
+                status.updatedAt = entry.updatedAt;
+                status.detail.assign(entry.detail, std::min<std::size_t>(entry.detailLength, kDetailBytes));
+                result.push_back(std::move(status));
+            }
+            publishedAt = published;
+            ok = true;
+        }
+        if (!ok) {
+            error = "status block is being rewritten continuously";
+        }
+    }
+    ::munmap(mapped, size);
+    return ok;
+}
+
+} // namespace monitoring::status_block
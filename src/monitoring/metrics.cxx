@@ -0,0 +1,124 @@
+#include "monitoring/metrics.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace monitoring {
+
+uint64_t Histogram::bucketLowerBound(std::size_t index) {
+    constexpr std::size_t kLinear = std::size_t{1} << kSubBucketBits;
+    if (index < kLinear) {
+        return index;
+    }
+    const std::size_t exponent = index >> kSubBucketBits;
+    const uint64_t sub = index & (kLinear - 1);
+    return (kLinear + sub) << (exponent - 1);
+}
+
+uint64_t Histogram::bucketUpperBound(std::size_t index) {
+    if (index + 1 >= kBuckets) {
+        return (1ull << kMaxExponent) - 1;
+    }
+    return bucketLowerBound(index + 1) - 1;
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot result;
+    result.buckets.assign(kBuckets, 0);
+    for (std::size_t s = 0; s < detail::kMetricShards; ++s) {
+        const Shard& shard = shards_[s];
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+        result.max = std::max(result.max, shard.max.load(std::memory_order_relaxed));
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    for (uint64_t n : result.buckets) {
+        result.count += n;
+    }
+    return result;
+}
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(Histogram::bucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+uint64_t HistogramSnapshot::countAtOrBelow(uint64_t limit) const {
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < buckets.size() && Histogram::bucketUpperBound(i) <= limit; ++i) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsRegistry::Entry& MetricsRegistry::findOrAdd(Type type, std::string_view name, std::string_view help,
+                                                   std::string_view labels) {
+    for (auto& entry : entries_) {
+        if (entry.name != name) {
+            continue;
+        }
+        // 同名不同标签的指标必须同类型（Prometheus 按名字声明 TYPE）
+        if (entry.type != type) {
+            throw std::logic_error("metric registered with a different type: " + std::string(name));
+        }
+        if (entry.labels == labels) {
+            return entry;
+        }
+    }
+
+    Entry entry;
+    entry.type = type;
+    entry.name.assign(name);
+    entry.labels.assign(labels);
+    entry.help.assign(help);
+    switch (type) {
+    case Type::Counter:
+        entry.counter = &counters_.emplace_back();
+        break;
+    case Type::Gauge:
+        entry.gauge = &gauges_.emplace_back();
+        break;
+    case Type::Histogram:
+        entry.histogram = &histograms_.emplace_back();
+        break;
+    }
+    return entries_.emplace_back(std::move(entry));
+}
+
+Counter& MetricsRegistry::counter(std::string_view name, std::string_view help, std::string_view labels) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return *findOrAdd(Type::Counter, name, help, labels).counter;
+}
+
+Gauge& MetricsRegistry::gauge(std::string_view name, std::string_view help, std::string_view labels) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return *findOrAdd(Type::Gauge, name, help, labels).gauge;
+}
+
+Histogram& MetricsRegistry::histogram(std::string_view name, std::string_view help, std::string_view labels) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return *findOrAdd(Type::Histogram, name, help, labels).histogram;
+}
+
+std::vector<MetricsRegistry::Entry> MetricsRegistry::entries() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return std::vector<Entry>(entries_.begin(), entries_.end());
+}
+
+} // namespace monitoring
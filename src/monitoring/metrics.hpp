@@ -0,0 +1,192 @@
+// 指标注册表：计数器、仪表盘、延迟直方图
+// 计数器和直方图按线程分片（每个线程固定落在一个缓存行对齐的分片上），记录只是一两次无竞争的原子加，
+// 读取时再把各分片合并；直方图为 HDR 风格的对数-线性分桶（相对误差约 3%）
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace monitoring {
+
+namespace detail {
+
+inline constexpr std::size_t kMetricShards = 8;
+
+// 当前线程使用的分片（第一次调用时轮流分配）
+inline std::size_t shardIndex() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return index;
+}
+
+} // namespace detail
+
+// 单调递增计数器
+class Counter {
+public:
+    void inc(uint64_t n = 1) {
+        shards_[detail::shardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& shard : shards_) {
+            total += shard.value.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Shard, detail::kMetricShards> shards_;
+};
+
+// 仪表盘（当前值，如队列深度、连接数）
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+// 直方图合并后的快照
+struct HistogramSnapshot {
+    uint64_t count{0};      // 分桶合计
+    uint64_t sum{0};
+    uint64_t max{0};
+    std::vector<uint64_t> buckets;
+
+    // 分位数（0~1），返回所在分桶的上界
+    uint64_t percentile(double q) const;
+
+    // 值 <= limit 的样本数（按分桶上界统计，Prometheus 的累计分桶用）
+    uint64_t countAtOrBelow(uint64_t limit) const;
+};
+
+// 延迟直方图（单位由调用方决定，项目里统一记录纳秒）
+class Histogram {
+public:
+    static constexpr unsigned kSubBucketBits = 5;   // 每个 2 的幂区间再分 32 个线性子桶
+    static constexpr unsigned kMaxExponent = 40;    // 超过 2^40（纳秒约 18 分钟）的值记入最后一个桶
+    static constexpr std::size_t kBuckets = static_cast<std::size_t>(kMaxExponent - kSubBucketBits + 1) << kSubBucketBits;
+
+    Histogram()
+        : shards_(new Shard[detail::kMetricShards]) {}
+
+    void record(uint64_t value) {
+        Shard& shard = shards_[detail::shardIndex()];
+        shard.buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t current = shard.max.load(std::memory_order_relaxed);
+        while (value > current && !shard.max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // 记录从 start 到现在经过的纳秒数
+    void recordSince(std::chrono::steady_clock::time_point start) {
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    HistogramSnapshot snapshot() const;
+
+    static std::size_t bucketIndex(uint64_t value) {
+        constexpr uint64_t kLinear = 1ull << kSubBucketBits;
+        constexpr uint64_t kLimit = (1ull << kMaxExponent) - 1;
+        if (value > kLimit) {
+            value = kLimit;
+        }
+        if (value < kLinear) {
+            return static_cast<std::size_t>(value);
+        }
+        const unsigned msb = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        const unsigned exponent = msb - kSubBucketBits + 1;
+        return (static_cast<std::size_t>(exponent) << kSubBucketBits) +
+               static_cast<std::size_t>((value >> (msb - kSubBucketBits)) - kLinear);
+    }
+
+    // 分桶的取值范围 [lower, upper]
+    static uint64_t bucketLowerBound(std::size_t index);
+    static uint64_t bucketUpperBound(std::size_t index);
+
+private:
+    // 样本数由分桶合计得出，记录时少一次原子加
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    };
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// 作用域计时：析构时把经过的纳秒数记入直方图
+class ScopedLatency {
+public:
+    explicit ScopedLatency(Histogram& histogram)
+        : histogram_(histogram)
+        , start_(std::chrono::steady_clock::now()) {}
+
+    ~ScopedLatency() { histogram_.recordSince(start_); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 全局指标注册表（单例）
+// 指标登记一次后地址不变，调用方保存引用，热路径上不再查表
+class MetricsRegistry {
+public:
+    enum class Type { Counter, Gauge, Histogram };
+
+    // 一个已登记的指标
+    struct Entry {
+        Type type{Type::Counter};
+        std::string name;       // 如 aqua_redis_op_seconds
+        std::string labels;     // 如 op="set"（可为空）
+        std::string help;
+        Counter* counter{nullptr};
+        Gauge* gauge{nullptr};
+        Histogram* histogram{nullptr};
+    };
+
+    static MetricsRegistry& instance();
+
+    // 登记（或取回同名同标签的）指标；同名指标类型不一致时抛出 std::logic_error
+    Counter& counter(std::string_view name, std::string_view help, std::string_view labels = {});
+    Gauge& gauge(std::string_view name, std::string_view help, std::string_view labels = {});
+    Histogram& histogram(std::string_view name, std::string_view help, std::string_view labels = {});
+
+    // 所有已登记指标（按登记顺序），值需由调用方从指针读取
+    std::vector<Entry> entries() const;
+
+private:
+    MetricsRegistry() = default;
+
+    Entry& findOrAdd(Type type, std::string_view name, std::string_view help, std::string_view labels);
+
+    mutable std::mutex mutex_;
+    std::deque<Entry> entries_;
+    std::deque<Counter> counters_;
+    std::deque<Gauge> gauges_;
+    std::deque<Histogram> histograms_;
+};
+
+} // namespace monitoring
@@ -0,0 +1,416 @@
+#include "monitoring/metrics_server.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/logger.hpp"
+#include "monitoring/tracing.hpp"
+
+namespace monitoring {
+
+namespace {
+
+constexpr std::size_t kMaxRequestBytes = 8 * 1024;  // 请求头上限，超过直接关闭
+constexpr int kMaxEvents = 32;
+constexpr int64_t kIdleTimeoutMs = 10000;           // 连接没有进展的最长时间
+constexpr int kSweepIntervalMs = 1000;              // 有连接时检查空闲的间隔
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 直方图导出的分桶上界（秒）
+constexpr double kBucketBounds[] = {
+    0.000001, 0.000005, 0.00001, 0.00005, 0.0001, 0.00025, 0.0005,
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+};
+
+std::string withLabels(const std::string& labels, const std::string& extra = {}) {
+    if (labels.empty() && extra.empty()) {
+        return {};
+    }
+    if (labels.empty() || extra.empty()) {
+        return "{" + labels + extra + "}";
+    }
+    return "{" + labels + "," + extra + "}";
+}
+
+std::string httpResponse(int status, const char* reason, const char* contentType, const std::string& body) {
+    std::ostringstream oss;
+    oss << "HTTP/1.1 " << status << ' ' << reason << "\r\n"
+        << "Content-Type: " << contentType << "\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+    return oss.str();
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(MetricsRegistry& registry, HealthMonitor& health)
+    : registry_(registry)
+    , health_(health) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(const std::string& bindAddress, uint16_t port) {
+    if (running_) {
+        return true;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (::inet_pton(AF_INET, bindAddress.c_str(), &addr.sin_addr) != 1) {
+        LOG_ERROR("metrics_server", "Invalid bind address ", bindAddress);
+        return false;
+    }
+
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (listenFd_ < 0 ||
+        ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        ::bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listenFd_, 16) != 0) {
+        LOG_ERROR("metrics_server", "Failed to listen on ", bindAddress, ":", port, ": ", std::strerror(errno));
+        stop();
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    ::getsockname(listenFd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reserveFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    listenPaused_ = false;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &ev);
+    ev.data.fd = wakeFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+
+    running_ = true;
+    worker_ = std::thread(&MetricsServer::run, this);
+    LOG_INFO("metrics_server", "Serving /metrics, /health and /trace on ", bindAddress, ":", port_);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (running_.exchange(false) && wakeFd_ >= 0) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(wakeFd_, &one, sizeof(one));
+    }
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+    for (auto& [fd, connection] : connections_) {
+        ::close(fd);
+    }
+    connections_.clear();
+    for (int* fd : {&listenFd_, &epollFd_, &wakeFd_, &reserveFd_}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void MetricsServer::run() {
+    epoll_event events[kMaxEvents];
+    while (running_) {
+        // 有连接（检查空闲）或监听暂停（重试恢复）时定时醒来
+        const int timeout = connections_.empty() && !listenPaused_ ? -1 : kSweepIntervalMs;
+        int n = ::epoll_wait(epollFd_, events, kMaxEvents, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("metrics_server", "epoll_wait failed: ", std::strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == wakeFd_) {
+                continue;   // stop()
+            }
+            if (fd == listenFd_) {
+                accept();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close(fd);
+            } else if (it->second.response.empty()) {
+                onReadable(fd, it->second);
+            } else if (flush(fd, it->second)) {
+                close(fd);
+            }
+        }
+        closeIdle();
+        resumeListener();
+    }
+}
+
+void MetricsServer::accept() {
+    while (true) {
+        int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;     // 已经取完
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                shedConnection();
+                return;
+            }
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+                continue;   // 这个连接在排队时已断开
+            }
+            LOG_WARN("metrics_server", "accept failed: ", std::strerror(errno));
+            return;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        ::epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+        Connection connection;
+        connection.activeAt = nowMs();
+        connections_.emplace(fd, std::move(connection));
+    }
+}
+
+void MetricsServer::shedConnection() {
+    // 监听套接字是水平触发，不把排队的连接取走会一直可读，epoll 循环空转
+    if (reserveFd_ >= 0) {
+        ::close(reserveFd_);
+        reserveFd_ = -1;
+        const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        reserveFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    if (++shed_ == 1 || shed_ % 1000 == 0) {
+        LOG_WARN("metrics_server", "Out of file descriptors, dropped ", shed_, " metrics connections so far");
+    }
+    if (reserveFd_ < 0) {
+        pauseListener(true);    // 预留的描述符被别处占走了：等有连接关闭或定时重试时再接
+    }
+}
+
+void MetricsServer::pauseListener(bool paused) {
+    if (listenPaused_ == paused) {
+        return;
+    }
+    listenPaused_ = paused;
+    epoll_event ev{};
+    ev.events = paused ? 0u : static_cast<uint32_t>(EPOLLIN);
+    ev.data.fd = listenFd_;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, listenFd_, &ev);
+}
+
+void MetricsServer::closeIdle() {
+    if (connections_.empty()) {
+        return;
+    }
+    const int64_t now = nowMs();
+    std::vector<int> idle;
+    for (const auto& [fd, connection] : connections_) {
+        if (now - connection.activeAt >= kIdleTimeoutMs) {
+            idle.push_back(fd);
+        }
+    }
+    for (int fd : idle) {
+        close(fd);
+    }
+}
+
+void MetricsServer::onReadable(int fd, Connection& connection) {
+    char buffer[2048];
+    while (true) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            connection.activeAt = nowMs();
+            connection.request.append(buffer, static_cast<std::size_t>(n));
+            if (connection.request.size() > kMaxRequestBytes) {
+                close(fd);
+                return;
+            }
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            close(fd);  // 对端关闭或出错
+            return;
+        }
+        if (errno == EAGAIN) {
+            break;
+        }
+    }
+
+    if (connection.request.find("\r\n\r\n") == std::string::npos) {
+        return;     // 请求头还没收全
+    }
+
+    // 生成响应；一次写不完就改为等待可写
+    connection.response = handle(connection.request);
+    if (flush(fd, connection)) {
+        close(fd);
+        return;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLOUT;
+    ev.data.fd = fd;
+    ::epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+bool MetricsServer::flush(int fd, Connection& connection) {
+    while (connection.written < connection.response.size()) {
+        ssize_t n = ::send(fd, connection.response.data() + connection.written,
+                           connection.response.size() - connection.written, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno != EAGAIN;     // 出错直接关闭
+        }
+        connection.written += static_cast<std::size_t>(n);
+        connection.activeAt = nowMs();
+    }
+    return true;
+}
+
+void MetricsServer::close(int fd) {
+    ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections_.erase(fd);
+    resumeListener();
+}
+
+void MetricsServer::resumeListener() {
+    if (listenPaused_) {
+        // 先补回预留的描述符，补上了才恢复监听
+        reserveFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        pauseListener(reserveFd_ < 0);
+    }
+}
+
+std::string MetricsServer::handle(const std::string& request) const {
+    // 只看请求行：GET /path HTTP/1.1
+    const auto lineEnd = request.find("\r\n");
+    std::istringstream line(request.substr(0, lineEnd));
+    std::string method;
+    std::string target;
+    line >> method >> target;
+    const std::string path = target.substr(0, target.find('?'));
+
+    if (method != "GET") {
+        return httpResponse(405, "Method Not Allowed", "text/plain", "method not allowed\n");
+    }
+    if (path == "/metrics") {
+        return httpResponse(200, "OK", "text/plain; version=0.0.4; charset=utf-8", renderMetrics());
+    }
+    if (path == "/health") {
+        return httpResponse(200, "OK", "application/json", renderHealth());
+    }
+    if (path == "/trace") {
+        return httpResponse(200, "OK", "application/json", Tracer::instance().renderChromeJson());
+    }
+    return httpResponse(404, "Not Found", "text/plain", "not found\n");
+}
+
+std::string MetricsServer::renderMetrics() const {
+    std::ostringstream out;
+    const auto entries = registry_.entries();
+
+    // 同名指标（不同标签）放在一起，只输出一次 HELP/TYPE
+    std::vector<bool> done(entries.size(), false);
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        if (done[i]) {
+            continue;
+        }
+        const auto& head = entries[i];
+        const char* type = head.type == MetricsRegistry::Type::Counter ? "counter"
+                         : head.type == MetricsRegistry::Type::Gauge   ? "gauge"
+                                                                        : "histogram";
+        out << "# HELP " << head.name << ' ' << head.help << '\n';
+        out << "# TYPE " << head.name << ' ' << type << '\n';
+
+        for (std::size_t j = i; j < entries.size(); ++j) {
+            const auto& entry = entries[j];
+            if (done[j] || entry.name != head.name) {
+                continue;
+            }
+            done[j] = true;
+
+            switch (entry.type) {
+            case MetricsRegistry::Type::Counter:
+                out << entry.name << withLabels(entry.labels) << ' ' << entry.counter->value() << '\n';
+                break;
+            case MetricsRegistry::Type::Gauge:
+                out << entry.name << withLabels(entry.labels) << ' ' << entry.gauge->value() << '\n';
+                break;
+            case MetricsRegistry::Type::Histogram: {
+                // 直方图记录的是纳秒，导出为秒
+                const auto snapshot = entry.histogram->snapshot();
+                for (double bound : kBucketBounds) {
+                    std::ostringstream le;
+                    le << "le=\"" << bound << '"';
+                    out << entry.name << "_bucket" << withLabels(entry.labels, le.str()) << ' '
+                        << snapshot.countAtOrBelow(static_cast<uint64_t>(bound * 1e9)) << '\n';
+                }
+                out << entry.name << "_bucket" << withLabels(entry.labels, "le=\"+Inf\"") << ' ' << snapshot.count << '\n';
+                out << entry.name << "_sum" << withLabels(entry.labels) << ' ' << static_cast<double>(snapshot.sum) / 1e9 << '\n';
+                out << entry.name << "_count" << withLabels(entry.labels) << ' ' << snapshot.count << '\n';
+                break;
+            }
+            }
+        }
+    }
+
+    // 健康状态和日志丢弃数
+    const auto states = health_.snapshot();
+    out << "# HELP aqua_component_healthy Component health reported to HealthMonitor (1 = healthy)\n"
+        << "# TYPE aqua_component_healthy gauge\n";
+    for (const auto& [component, state] : states) {
+        out << "aqua_component_healthy{component=\"" << component << "\"} " << (state.healthy ? 1 : 0) << '\n';
+    }
+    out << "# HELP aqua_component_updated_timestamp_seconds Last health update time\n"
+        << "# TYPE aqua_component_updated_timestamp_seconds gauge\n";
+    for (const auto& [component, state] : states) {
+        out << "aqua_component_updated_timestamp_seconds{component=\"" << component << "\"} "
+            << std::chrono::duration_cast<std::chrono::seconds>(state.updatedAt.time_since_epoch()).count() << '\n';
+    }
+    out << "# HELP aqua_log_dropped_total Log messages dropped because the queue was full\n"
+        << "# TYPE aqua_log_dropped_total counter\n"
+        << "aqua_log_dropped_total " << core::Logger::instance().droppedCount() << '\n';
+    return out.str();
+}
+
+std::string MetricsServer::renderHealth() const {
+    return health_.renderJson();
+}
+
+} // namespace monitoring
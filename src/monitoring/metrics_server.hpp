@@ -0,0 +1,78 @@
+// 本地 HTTP 观测端口（可选）
+//   GET /metrics  Prometheus 文本格式（指标注册表 + 各组件健康状态）
+//   GET /health   各组件健康状态 JSON（与健康文件格式一致）
+//   GET /trace    帧延迟追踪的 Chrome trace-event JSON（见 monitoring/tracing.hpp）
+// 单线程 epoll 循环，每个请求渲染后即关闭连接；渲染只读取原子变量和快照，不阻塞热路径
+// 连接 kIdleTimeoutMs 内没有读写进展就关闭；文件描述符用完（EMFILE/ENFILE）时用预留的描述符接下并关掉连接，
+// 预留的也拿不回来就暂停监听，等有连接关闭再恢复，不会因为一直可读的监听套接字空转
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "monitoring/health_monitor.hpp"
+#include "monitoring/metrics.hpp"
+
+namespace monitoring {
+
+class MetricsServer {
+public:
+    MetricsServer(MetricsRegistry& registry, HealthMonitor& health);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // 绑定地址并启动后台线程（端口为 0 时由系统分配，可用 port() 查询）
+    bool start(const std::string& bindAddress, uint16_t port);
+
+    // 停止后台线程并关闭所有连接
+    void stop();
+
+    uint16_t port() const { return port_; }
+
+    // 渲染 Prometheus 文本格式
+    std::string renderMetrics() const;
+
+    // 渲染健康状态 JSON
+    std::string renderHealth() const;
+
+private:
+    // 一个 HTTP 连接：读到完整请求头后生成响应，写完即关闭
+    struct Connection {
+        std::string request;
+        std::string response;
+        std::size_t written{0};
+        int64_t activeAt{0};        // 最近一次读写进展（steady_clock 毫秒）
+    };
+
+    void run();
+    void accept();
+    void onReadable(int fd, Connection& connection);
+    bool flush(int fd, Connection& connection);    // 写完返回 true
+    void close(int fd);
+    void closeIdle();
+    void shedConnection();          // EMFILE/ENFILE：腾出预留描述符接下一个连接并立即关闭
+    void pauseListener(bool paused);
+    void resumeListener();          // 监听暂停时重新取预留描述符，取到就恢复
+    std::string handle(const std::string& request) const;
+
+    MetricsRegistry& registry_;
+    HealthMonitor& health_;
+    int listenFd_{-1};
+    int epollFd_{-1};
+    int wakeFd_{-1};        // eventfd：stop() 时唤醒 epoll_wait
+    int reserveFd_{-1};     // 预留的描述符（/dev/null），描述符耗尽时腾出来 accept 后关掉
+    bool listenPaused_{false};
+    uint64_t shed_{0};      // 描述符耗尽时直接关掉的连接数
+    uint16_t port_{0};
+    std::unordered_map<int, Connection> connections_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+};
+
+} // namespace monitoring
@@ -0,0 +1,218 @@
+#include "monitoring/tracing.hpp"
+
+#include <cstring>
+#include <sstream>
+
+namespace monitoring {
+
+namespace {
+
+thread_local TraceScope* currentScope = nullptr;
+
+} // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::configure(bool enabled, uint32_t sampleEvery, uint32_t slowFrameMs, std::size_t ringCapacity) {
+    std::call_once(once_, [&] {
+        std::size_t capacity = 64;
+        while (capacity < ringCapacity) {
+            capacity <<= 1;
+        }
+        ring_.reset(new Slot[capacity]);
+        mask_ = capacity - 1;
+    });
+    setSampleEvery(sampleEvery);
+    setSlowFrameMs(slowFrameMs);
+    setEnabled(enabled);
+}
+
+uint32_t Tracer::threadIndex() {
+    static std::atomic<uint32_t> next{1};
+    thread_local const uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+void Tracer::record(const TraceEvent& event) {
+    if (ring_ == nullptr) {
+        return;
+    }
+    const uint64_t ticket = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring_[ticket & mask_];
+    slot.sequence.store(ticket * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.event, &event, sizeof(TraceEvent));
+    slot.sequence.store(ticket * 2 + 2, std::memory_order_release);
+}
+
+std::vector<TraceEvent> Tracer::collect() const {
+    std::vector<TraceEvent> events;
+    if (ring_ == nullptr) {
+        return events;
+    }
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t capacity = mask_ + 1;
+    const uint64_t first = head > capacity ? head - capacity : 0;
+    events.reserve(static_cast<std::size_t>(head - first));
+
+    // seqlock 读：序号与期望一致且前后未变，说明拷到的是第 t 个事件的完整内容
+    // 正在写或已被后来的事件覆盖的槽位直接跳过
+    for (uint64_t t = first; t < head; ++t) {
+        const Slot& slot = ring_[t & mask_];
+        const uint64_t expected = t * 2 + 2;
+        if (slot.sequence.load(std::memory_order_acquire) != expected) {
+            continue;
+        }
+        TraceEvent event;
+        std::memcpy(&event, &slot.event, sizeof(TraceEvent));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == expected) {
+            events.push_back(event);
+        }
+    }
+    return events;
+}
+
+std::string Tracer::renderChromeJson() const {
+    return renderChromeJson(collect());
+}
+
+std::string Tracer::renderChromeJson(const std::vector<TraceEvent>& events) {
+    std::ostringstream out;
+    out.setf(std::ios::fixed);
+    out.precision(3);
+
+    // "X" 为完整事件（ts/dur 单位微秒）；同一帧的事件用 args.correlationId 关联
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const auto& event = events[i];
+        out << (i == 0 ? "" : ",") << '\n'
+            << "{\"name\":\"" << event.stage << "\",\"cat\":\"telemetry\",\"ph\":\"X\""
+            << ",\"ts\":" << static_cast<double>(event.startNs) / 1000.0
+            << ",\"dur\":" << static_cast<double>(event.endNs - event.startNs) / 1000.0
+            << ",\"pid\":1,\"tid\":" << event.thread
+            << ",\"args\":{\"correlationId\":\"frame-" << event.traceId << '"';
+        if (event.connection != 0) {
+            out << ",\"connection\":" << event.connection;
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+TraceScope::TraceScope(uint64_t traceId)
+    : traceId_(traceId)
+    , startNs_(0)
+    , sampled_(false)
+    , previous_(currentScope) {
+    const Tracer& tracer = Tracer::instance();
+    if (!tracer.enabled()) {
+        return;     // 未开启：不成为当前上下文，作用域内的 TraceSpan 都是空操作
+    }
+    startNs_ = Tracer::nowNs();
+    sampled_ = tracer.sampled(traceId);
+    currentScope = this;
+}
+
+TraceScope::~TraceScope() {
+    if (currentScope != this) {
+        return;
+    }
+    currentScope = previous_;
+
+    const int64_t endNs = Tracer::nowNs();
+    Tracer& tracer = Tracer::instance();
+    if (!sampled_ && !keep_ && endNs - startNs_ < tracer.slowFrameNs()) {
+        return;
+    }
+
+    const uint32_t thread = Tracer::threadIndex();
+    tracer.record(TraceEvent{traceId_, "frame", startNs_, endNs, thread, 0});
+    for (std::size_t i = 0; i < count_; ++i) {
+        tracer.record(TraceEvent{traceId_, spans_[i].stage, spans_[i].startNs, spans_[i].endNs, thread, 0});
+    }
+}
+
+TraceScope* TraceScope::current() {
+    return currentScope;
+}
+
+void TraceScope::add(const char* stage, int64_t startNs, int64_t endNs) {
+    if (count_ < kMaxSpans) {
+        spans_[count_++] = Span{stage, startNs, endNs};
+    }
+}
+
+bool TraceScope::trackSends() {
+    if (!keep_ && (sampled_ || Tracer::nowNs() - startNs_ >= Tracer::instance().slowFrameNs())) {
+        keep_ = true;
+    }
+    return keep_;
+}
+
+void SendCompletionTracker::onQueued(uint64_t connection, std::size_t length, uint64_t traceId, std::size_t pendingBefore) {
+    if (traceId == 0 && tracked_.load(std::memory_order_relaxed) == 0) {
+        return;     // 没有任何连接在跟踪
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = connections_.find(connection);
+    if (it == connections_.end()) {
+        if (traceId == 0) {
+            return;
+        }
+        // 开始跟踪：之前投递但还没发出的字节也会触发完成回调，先计入已投递
+        it = connections_.emplace(connection, Progress{}).first;
+        it->second.queued = pendingBefore;
+        tracked_.store(connections_.size(), std::memory_order_relaxed);
+    }
+
+    Progress& progress = it->second;
+    progress.queued += length;
+    if (traceId != 0) {
+        progress.waiters.push_back(Waiter{traceId, progress.queued, Tracer::nowNs()});
+    }
+}
+
+void SendCompletionTracker::onSent(uint64_t connection, std::size_t length) {
+    if (tracked_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = connections_.find(connection);
+    if (it == connections_.end()) {
+        return;
+    }
+
+    Progress& progress = it->second;
+    progress.sent += length;
+    const int64_t now = Tracer::nowNs();
+    const uint32_t thread = Tracer::threadIndex();
+    while (!progress.waiters.empty() && progress.waiters.front().endOffset <= progress.sent) {
+        const Waiter& waiter = progress.waiters.front();
+        Tracer::instance().record(TraceEvent{waiter.traceId, "send", waiter.queuedNs, now, thread, connection});
+        progress.waiters.pop_front();
+    }
+
+    // 没有等待中的帧就不再跟踪这个连接（下次从头计数）
+    if (progress.waiters.empty()) {
+        connections_.erase(it);
+        tracked_.store(connections_.size(), std::memory_order_relaxed);
+    }
+}
+
+void SendCompletionTracker::onClosed(uint64_t connection) {
+    if (tracked_.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lk(mutex_);
+    connections_.erase(connection);
+    tracked_.store(connections_.size(), std::memory_order_relaxed);
+}
+
+} // namespace monitoring
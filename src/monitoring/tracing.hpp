@@ -0,0 +1,188 @@
+// 帧级延迟追踪：按关联 ID（frame-N）记录一帧从 Modbus 读取到各连接发送完成的各阶段耗时
+// 阶段事件写入固定大小的无锁环形缓冲区（写满后覆盖最旧的事件），按需导出为 Chrome trace-event JSON
+// （chrome://tracing 或 Perfetto 打开）
+//
+// 采样：每 sampleEvery 帧完整记录一帧；另外耗时超过 slowFrameMs 的帧总会被记录，用来定位尾延迟
+// 未开启追踪时 TraceScope/TraceSpan 只读一个原子标志
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace monitoring {
+
+// 一个阶段事件
+struct TraceEvent {
+    uint64_t traceId{0};        // 关联 ID 的序号（frame-N 中的 N）
+    const char* stage{""};      // 阶段名（必须是字符串字面量）
+    int64_t startNs{0};         // steady_clock 纳秒
+    int64_t endNs{0};
+    uint32_t thread{0};         // 记录线程的序号
+    uint64_t connection{0};     // 发送阶段的连接 ID，其他阶段为 0
+};
+
+class Tracer {
+public:
+    static Tracer& instance();
+
+    // 启动时调用一次（环形缓冲区容量只在第一次调用时生效，向上取 2 的幂）
+    void configure(bool enabled, uint32_t sampleEvery, uint32_t slowFrameMs, std::size_t ringCapacity);
+
+    // 运行时调整（trace 命令使用）
+    void setEnabled(bool enabled) { enabled_.store(enabled && ring_ != nullptr, std::memory_order_relaxed); }
+    void setSampleEvery(uint32_t every) { sampleEvery_.store(every, std::memory_order_relaxed); }
+    void setSlowFrameMs(uint32_t ms) { slowFrameNs_.store(static_cast<int64_t>(ms) * 1000000, std::memory_order_relaxed); }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    uint32_t sampleEvery() const { return sampleEvery_.load(std::memory_order_relaxed); }
+    uint32_t slowFrameMs() const { return static_cast<uint32_t>(slowFrameNs_.load(std::memory_order_relaxed) / 1000000); }
+    int64_t slowFrameNs() const { return slowFrameNs_.load(std::memory_order_relaxed); }
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // 头部采样：该帧是否完整记录
+    bool sampled(uint64_t traceId) const {
+        const uint32_t every = sampleEvery();
+        return every != 0 && traceId % every == 0;
+    }
+
+    // 写入一个事件（无锁，任意线程）
+    void record(const TraceEvent& event);
+
+    // 环形缓冲区中现存的完整事件（按写入顺序）
+    std::vector<TraceEvent> collect() const;
+
+    // Chrome trace-event JSON
+    std::string renderChromeJson() const;
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static uint32_t threadIndex();
+
+private:
+    Tracer() = default;
+
+    static std::string renderChromeJson(const std::vector<TraceEvent>& events);
+
+    // 每个槽位一个 seqlock：写入第 t 个事件时序号先置 2t+1，写完置 2t+2
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        TraceEvent event;
+    };
+
+    std::unique_ptr<Slot[]> ring_;
+    std::size_t mask_{0};
+    std::atomic<uint64_t> head_{0};     // 下一个写入序号
+    std::atomic<bool> enabled_{false};
+    std::atomic<uint32_t> sampleEvery_{100};
+    std::atomic<int64_t> slowFrameNs_{50 * 1000000ll};
+    std::once_flag once_;
+};
+
+// 一帧的追踪上下文：在产生帧的线程上构造，作用域内的 TraceSpan 都记在这一帧上
+// 阶段事件先攒在本地，析构时若被采样或整帧超过慢帧阈值才写入环形缓冲区
+class TraceScope {
+public:
+    static constexpr std::size_t kMaxSpans = 16;
+
+    explicit TraceScope(uint64_t traceId);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // 当前线程正在追踪的帧（没有则为 nullptr）
+    static TraceScope* current();
+
+    uint64_t traceId() const { return traceId_; }
+
+    void add(const char* stage, int64_t startNs, int64_t endNs);
+
+    // 是否跟踪这一帧的发送完成（已采样，或到目前为止已超过慢帧阈值）
+    // 返回 true 时这一帧一定会被写入，发送事件不会成为孤儿
+    bool trackSends();
+
+private:
+    // 本地攒的阶段（不做初始化，未开启追踪时构造 TraceScope 不需要清零这块内存）
+    struct Span {
+        const char* stage;
+        int64_t startNs;
+        int64_t endNs;
+    };
+
+    uint64_t traceId_;
+    int64_t startNs_;
+    bool sampled_;
+    bool keep_{false};
+    std::size_t count_{0};
+    Span spans_[kMaxSpans];
+    TraceScope* previous_;
+};
+
+// 作用域内的一个阶段（当前线程没有 TraceScope 时什么都不做）
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* stage)
+        : scope_(TraceScope::current())
+        , stage_(stage)
+        , start_(scope_ != nullptr ? Tracer::nowNs() : 0) {}
+
+    ~TraceSpan() {
+        if (scope_ != nullptr) {
+            scope_->add(stage_, start_, Tracer::nowNs());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    TraceScope* scope_;
+    const char* stage_;
+    int64_t start_;
+};
+
+// 按连接跟踪“发送完成”：发送时记下该帧在连接字节流中的结束位置，
+// 发送完成回调累计到这个位置时记一个 send 事件（开始为投递时间，结束为完成时间）
+// 只在有被追踪的发送未完成时才维护连接状态，平时 onQueued/onSent 只读一个原子计数
+class SendCompletionTracker {
+public:
+    // 投递之前调用（连接上的每次发送都要调用，traceId 为 0 表示不跟踪这次发送）
+    // pendingBefore 是此刻该连接尚未发出的字节数，只在 traceId 非 0 时需要
+    void onQueued(uint64_t connection, std::size_t length, uint64_t traceId, std::size_t pendingBefore);
+
+    // 发送完成回调中调用（length 为本次完成的字节数）
+    void onSent(uint64_t connection, std::size_t length);
+
+    // 连接关闭时丢弃未完成的跟踪
+    void onClosed(uint64_t connection);
+
+private:
+    struct Waiter {
+        uint64_t traceId;
+        uint64_t endOffset;     // 该帧最后一个字节在连接字节流中的位置
+        int64_t queuedNs;
+    };
+
+    struct Progress {
+        uint64_t queued{0};
+        uint64_t sent{0};
+        std::deque<Waiter> waiters;
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Progress> connections_;
+    std::atomic<std::size_t> tracked_{0};   // connections_ 的大小（快速路径判断用）
+};
+
+} // namespace monitoring
@@ -0,0 +1,665 @@
+#include "network/epoll_server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "core/logger.hpp"
+
+namespace network {
+
+namespace {
+
+constexpr uint64_t kListenToken = 0;                // 连接 ID 的序号从 1 开始，不会是 0
+constexpr uint64_t kWakeToken = ~uint64_t{0};
+constexpr uint64_t kLocalListenToken = ~uint64_t{0} - 1;
+constexpr mode_t kLocalSocketMode = 0666;            // 谁能连由 SO_PEERCRED 白名单决定，文件权限不再另设一道
+constexpr int kMaxEvents = 256;
+constexpr int kAcceptRetryMs = 100;         // 描述符耗尽时重试 accept 的间隔
+constexpr std::size_t kReadBufferBytes = 64 * 1024;
+constexpr std::size_t kCompactBytes = 1024 * 1024;  // 发送缓冲区已写出的前缀超过这个大小就挪掉
+
+bool wouldBlock(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+// 把当前线程绑到进程可用 CPU 中的第 index 个（按可用 CPU 数取模）
+void pinToCpu(std::size_t index) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+    std::size_t target = index % static_cast<std::size_t>(CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) != 0) {
+                LOG_WARN("epoll_server", "Failed to pin event loop ", index, " to cpu ", cpu);
+            }
+            return;
+        }
+    }
+}
+
+} // namespace
+
+EpollServer::EpollServer(const TcpServerOptions& options, TcpServerHandler& handler)
+    : options_(options)
+    , handler_(handler)
+    , loopCount_(std::min(options.listenerShards > 0 ? std::size_t{options.listenerShards}
+                          : options.workerThreads > 0 ? std::size_t{options.workerThreads}
+                                                      : std::size_t{std::max(1u, std::thread::hardware_concurrency())},
+                          kMaxLoops)) {}
+
+EpollServer::~EpollServer() {
+    stop();
+}
+
+int EpollServer::openListener(const std::string& bindAddress, uint16_t port, bool reusePort) const {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    addrinfo* addresses = nullptr;
+    const std::string service = std::to_string(port);
+    const int resolved = ::getaddrinfo(bindAddress.empty() ? "0.0.0.0" : bindAddress.c_str(), service.c_str(), &hints, &addresses);
+    if (resolved != 0) {
+        LOG_ERROR("epoll_server", "Cannot resolve ", bindAddress, ": ", ::gai_strerror(resolved));
+        return -1;
+    }
+    int listenFd = -1;
+    for (addrinfo* ai = addresses; ai != nullptr && listenFd < 0; ai = ai->ai_next) {
+        const int fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        const int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (reusePort && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+            ::close(fd);
+            continue;
+        }
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+            listenFd = fd;
+        } else {
+            ::close(fd);
+        }
+    }
+    ::freeaddrinfo(addresses);
+    if (listenFd < 0) {
+        LOG_ERROR("epoll_server", "Failed to listen on ", bindAddress, ":", port, ": ", std::strerror(errno));
+    }
+    return listenFd;
+}
+
+int EpollServer::openLocalListener() const {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options_.localSocket.size() >= sizeof(address.sun_path)) {
+        LOG_ERROR("epoll_server", "Local socket path too long: ", options_.localSocket);
+        return -1;
+    }
+    std::memcpy(address.sun_path, options_.localSocket.c_str(), options_.localSocket.size() + 1);
+
+    // 上次没清理掉的套接字文件直接删掉；同名的普通文件不动
+    struct stat st{};
+    if (::lstat(address.sun_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            LOG_ERROR("epoll_server", "Local socket path exists and is not a socket: ", options_.localSocket);
+            return -1;
+        }
+        ::unlink(address.sun_path);
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("epoll_server", "Failed to create local socket: ", std::strerror(errno));
+        return -1;
+    }
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || ::chmod(address.sun_path, kLocalSocketMode) != 0
+        || ::listen(fd, SOMAXCONN) != 0) {
+        LOG_ERROR("epoll_server", "Failed to listen on ", options_.localSocket, ": ", std::strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool EpollServer::peerAllowed(int fd) const {
+    ucred peer{};
+    socklen_t length = sizeof(peer);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &length) != 0) {
+        return false;
+    }
+    const auto& uids = options_.localAllowedUids;
+    const auto& gids = options_.localAllowedGids;
+    const bool allowed = (uids.empty() && gids.empty())
+                             ? peer.uid == 0 || peer.uid == ::geteuid()
+                             : std::find(uids.begin(), uids.end(), peer.uid) != uids.end()
+                                   || std::find(gids.begin(), gids.end(), peer.gid) != gids.end();
+    if (!allowed) {
+        LOG_WARN("epoll_server", "Rejected local client pid ", peer.pid, " uid ", peer.uid, " gid ", peer.gid);
+    }
+    return allowed;
+}
+
+bool EpollServer::start(const std::string& bindAddress, uint16_t port) {
+    if (running_) {
+        return false;
+    }
+    loops_.clear();
+
+    // 分片监听：每个线程一个 SO_REUSEPORT 监听套接字；否则线程数取 workerThreads，只有第一个线程 accept
+    const bool sharded = options_.listenerShards > 0;
+    for (std::size_t i = 0; i < loopCount_; ++i) {
+        auto loop = std::make_unique<Loop>();
+        loop->index = i;
+        loop->epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        loop->buffer.resize(kReadBufferBytes);
+        const bool accepts = sharded || i == 0;
+        if (accepts) {
+            loop->listenFd = openListener(bindAddress, port, sharded);
+        }
+        const bool acceptsLocal = i == 0 && !options_.localSocket.empty();
+        if (acceptsLocal) {
+            loop->localListenFd = openLocalListener();
+        }
+        if (accepts || acceptsLocal) {
+            loop->reserveFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        }
+        bool ok = loop->epollFd >= 0 && loop->wakeFd >= 0 && (!accepts || loop->listenFd >= 0)
+               && (!acceptsLocal || loop->localListenFd >= 0);
+        if (ok) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = kWakeToken;
+            ok = ::epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &event) == 0;
+        }
+        if (ok && accepts) {
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLET;
+            event.data.u64 = kListenToken;
+            ok = ::epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->listenFd, &event) == 0;
+        }
+        if (ok && acceptsLocal) {
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLET;
+            event.data.u64 = kLocalListenToken;
+            ok = ::epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->localListenFd, &event) == 0;
+        }
+        loops_.push_back(std::move(loop));
+        if (!ok) {
+            LOG_ERROR("epoll_server", "Failed to create event loop ", i);
+            closeFds();
+            return false;
+        }
+    }
+
+    running_ = true;
+    for (auto& loop : loops_) {
+        loop->thread = std::thread(&EpollServer::run, this, std::ref(*loop));
+    }
+    LOG_INFO("epoll_server", "Listening on ", bindAddress.empty() ? "0.0.0.0" : bindAddress, ":", port, " with ", loops_.size(),
+             sharded ? " SO_REUSEPORT shards pinned to cpus" : " event loops");
+    if (!options_.localSocket.empty()) {
+        LOG_INFO("epoll_server", "Listening on local socket ", options_.localSocket);
+    }
+    return true;
+}
+
+void EpollServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    for (auto& loop : loops_) {
+        const uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(loop->wakeFd, &one, sizeof(one));
+    }
+    for (auto& loop : loops_) {
+        if (loop->thread.joinable()) {
+            loop->thread.join();
+        }
+    }
+
+    // I/O 线程都已退出，剩下的连接在这里关闭；没执行的任务丢弃
+    for (auto& loop : loops_) {
+        std::vector<std::shared_ptr<Connection>> remaining;
+        {
+            std::shared_lock<std::shared_mutex> lk(loop->connectionsMutex);
+            for (const auto& [id, connection] : loop->connections) {
+                remaining.push_back(connection);
+            }
+        }
+        for (const auto& connection : remaining) {
+            close(connection, 0);
+        }
+        std::lock_guard<std::mutex> lk(loop->inboxMutex);
+        loop->notify.clear();
+        loop->tasks.clear();
+        loop->wakePending = false;
+    }
+    closeFds();
+}
+
+void EpollServer::closeFds() {
+    for (auto& loop : loops_) {
+        // Loop 对象留到下次 start，停止过程中别的线程的 send 还可能引用它
+        if (loop->localListenFd >= 0) {
+            ::unlink(options_.localSocket.c_str());
+        }
+        for (int* fd : {&loop->listenFd, &loop->localListenFd, &loop->reserveFd, &loop->epollFd, &loop->wakeFd}) {
+            if (*fd >= 0) {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+}
+
+std::shared_ptr<EpollServer::Connection> EpollServer::find(ConnectionId id) const {
+    const std::size_t shard = shardOf(id);
+    if (shard >= loops_.size()) {
+        return nullptr;
+    }
+    const Loop& loop = *loops_[shard];
+    std::shared_lock<std::shared_mutex> lk(loop.connectionsMutex);
+    const auto it = loop.connections.find(id);
+    return it != loop.connections.end() ? it->second : nullptr;
+}
+
+bool EpollServer::send(ConnectionId id, const uint8_t* data, std::size_t length) {
+    const auto connection = find(id);
+    if (!connection) {
+        return false;
+    }
+    std::size_t written = 0;
+    {
+        std::lock_guard<std::mutex> lk(connection->mutex);
+        if (connection->closed) {
+            return false;
+        }
+        // 前面没有积压才能直接写，否则会乱序
+        if (connection->outputOffset == connection->output.size()) {
+            while (written < length) {
+                const ssize_t n = ::send(connection->fd, data + written, length - written, MSG_NOSIGNAL);
+                if (n > 0) {
+                    written += static_cast<std::size_t>(n);
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else if (n < 0 && wouldBlock(errno)) {
+                    break;
+                } else {
+                    // 连接已坏：让 I/O 线程走关闭流程
+                    ::shutdown(connection->fd, SHUT_RDWR);
+                    return false;
+                }
+            }
+        }
+        if (written < length) {
+            connection->output.insert(connection->output.end(), data + written, data + length);
+            connection->pending.fetch_add(length - written, std::memory_order_relaxed);
+        }
+    }
+    if (written > 0) {
+        deferSent(connection, written);
+    }
+    return true;
+}
+
+void EpollServer::deferSent(const std::shared_ptr<Connection>& connection, std::size_t bytes) {
+    connection->unreported.fetch_add(bytes, std::memory_order_relaxed);
+    if (connection->notifyQueued.exchange(true)) {
+        return;
+    }
+    Loop& loop = *loops_[connection->loop];
+    bool wakeNeeded = false;
+    {
+        std::lock_guard<std::mutex> lk(loop.inboxMutex);
+        loop.notify.push_back(connection);
+        wakeNeeded = !std::exchange(loop.wakePending, true);
+    }
+    if (wakeNeeded) {
+        wake(loop);
+    }
+}
+
+void EpollServer::post(std::size_t shard, std::function<void()> task) {
+    if (!running_ || shard >= loops_.size()) {
+        return;
+    }
+    Loop& loop = *loops_[shard];
+    bool wakeNeeded = false;
+    {
+        std::lock_guard<std::mutex> lk(loop.inboxMutex);
+        loop.tasks.push_back(std::move(task));
+        wakeNeeded = !std::exchange(loop.wakePending, true);
+    }
+    if (wakeNeeded) {
+        wake(loop);
+    }
+}
+
+void EpollServer::wake(Loop& loop) {
+    // wakePending 保证一批通知和任务只写一次 eventfd
+    if (running_) {
+        const uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(loop.wakeFd, &one, sizeof(one));
+    }
+}
+
+bool EpollServer::disconnect(ConnectionId id) {
+    const auto connection = find(id);
+    if (!connection) {
+        return false;
+    }
+    // 只关读写方向，fd 由所属 I/O 线程收到挂断事件后关闭（避免 fd 被复用）
+    std::lock_guard<std::mutex> lk(connection->mutex);
+    if (!connection->closed) {
+        ::shutdown(connection->fd, SHUT_RDWR);
+    }
+    return true;
+}
+
+std::size_t EpollServer::connectionCount() const {
+    std::size_t count = 0;
+    for (const auto& loop : loops_) {
+        std::shared_lock<std::shared_mutex> lk(loop->connectionsMutex);
+        count += loop->connections.size();
+    }
+    return count;
+}
+
+std::size_t EpollServer::pendingBytes(ConnectionId id) const {
+    const auto connection = find(id);
+    return connection ? connection->pending.load(std::memory_order_relaxed) : 0;
+}
+
+void EpollServer::setExtra(ConnectionId id, void* extra) {
+    if (const auto connection = find(id)) {
+        connection->extra.store(extra);
+    }
+}
+
+void* EpollServer::extra(ConnectionId id) const {
+    const auto connection = find(id);
+    return connection ? connection->extra.load() : nullptr;
+}
+
+void EpollServer::run(Loop& loop) {
+    if (options_.listenerShards > 0) {
+        pinToCpu(loop.index);
+    }
+    epoll_event events[kMaxEvents];
+    while (running_) {
+        const int n = ::epoll_wait(loop.epollFd, events, kMaxEvents, loop.acceptStalled ? kAcceptRetryMs : -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("epoll_server", "epoll_wait failed: ", std::strerror(errno));
+            break;
+        }
+        if (loop.acceptStalled) {
+            // 监听套接字是边沿触发，排队的连接不会再产生事件，主动再取一次
+            loop.acceptStalled = false;
+            if (loop.listenFd >= 0) {
+                acceptAll(loop, false);
+            }
+            if (loop.localListenFd >= 0) {
+                acceptAll(loop, true);
+            }
+        }
+        for (int i = 0; i < n && running_; ++i) {
+            const uint64_t token = events[i].data.u64;
+            const uint32_t flags = events[i].events;
+            if (token == kWakeToken) {
+                uint64_t count = 0;
+                [[maybe_unused]] const auto readBytes = ::read(loop.wakeFd, &count, sizeof(count));
+                drainInbox(loop);
+                continue;
+            }
+            if (token == kListenToken || token == kLocalListenToken) {
+                acceptAll(loop, token == kLocalListenToken);
+                continue;
+            }
+            const auto connection = find(token);
+            if (!connection) {
+                continue;
+            }
+            if (flags & (EPOLLIN | EPOLLRDHUP)) {
+                readAll(loop, connection);
+            }
+            if ((flags & EPOLLOUT) && !connection->closed) {
+                flush(connection);
+            }
+            if ((flags & (EPOLLERR | EPOLLHUP)) && !connection->closed) {
+                int error = 0;
+                socklen_t errorLength = sizeof(error);
+                ::getsockopt(connection->fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+                close(connection, error);
+            }
+        }
+    }
+}
+
+bool EpollServer::shedConnection(Loop& acceptor, int listenFd) {
+    // 描述符耗尽：用预留的描述符接受排队的连接并立刻关掉，客户端马上知道连不上，而不是一直挂在队列里
+    bool shed = false;
+    if (acceptor.reserveFd >= 0) {
+        ::close(acceptor.reserveFd);
+        const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            ::close(fd);
+            shed = true;
+        }
+    }
+    acceptor.reserveFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (shed) {
+        const uint64_t count = shed_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (count == 1 || count % 1000 == 0) {
+            LOG_WARN("epoll_server", "Out of file descriptors, dropped ", count, " connections so far");
+        }
+    }
+    if (!shed || acceptor.reserveFd < 0) {
+        // 预留的描述符被别处占走了（或腾出来也没接到）：等描述符释放，定时重试
+        acceptor.acceptStalled = true;
+        return false;
+    }
+    return true;
+}
+
+void EpollServer::acceptAll(Loop& acceptor, bool local) {
+    // 本机连接只有第一个线程接受，同样轮流分给各线程
+    const bool sharded = options_.listenerShards > 0 && !local;
+    const int listenFd = local ? acceptor.localListenFd : acceptor.listenFd;
+    while (true) {
+        const int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && shedConnection(acceptor, listenFd)) {
+                continue;   // 边沿触发：把队列取空，否则后面的连接一直没有通知
+            }
+            if (!wouldBlock(errno) && errno != EMFILE && errno != ENFILE) {
+                LOG_WARN("epoll_server", "accept failed: ", std::strerror(errno));
+            }
+            return;
+        }
+        if (options_.maxConnections != 0 && connectionCount() >= options_.maxConnections) {
+            ::close(fd);
+            continue;
+        }
+        if (local) {
+            if (!peerAllowed(fd)) {
+                ::close(fd);
+                continue;
+            }
+        } else {
+            // 转发的是实时数据，小包不等 Nagle 攒批
+            const int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            // 限制内核里排队的未发数据，多出来的留在发送缓冲区，pendingBytes 能看到（上层据此做发送优先级）
+            if (options_.notSentLowat > 0) {
+                const int lowat = static_cast<int>(options_.notSentLowat);
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+            }
+        }
+
+        // 分片监听时连接留在接受它的线程上，否则轮流分给各线程
+        Loop& owner = sharded ? acceptor : *loops_[nextLoop_++ % loops_.size()];
+        const ConnectionId id = (owner.nextSerial.fetch_add(1, std::memory_order_relaxed) << kShardBits) | owner.index;
+        auto connection = std::make_shared<Connection>(id, fd, owner.index);
+        {
+            std::unique_lock<std::shared_mutex> lk(owner.connectionsMutex);
+            owner.connections.emplace(id, connection);
+        }
+        // 先回调 onAccept 再注册到 epoll，保证 onReceive 不会抢在 onAccept 前面
+        if (handler_.onAccept(*this, id) != HandleResult::Ok) {
+            {
+                std::lock_guard<std::mutex> lk(connection->mutex);
+                connection->closed = true;
+            }
+            {
+                std::unique_lock<std::shared_mutex> lk(owner.connectionsMutex);
+                owner.connections.erase(id);
+            }
+            ::close(fd);
+            continue;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u64 = id;
+        if (::epoll_ctl(owner.epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            const int error = errno;
+            LOG_WARN("epoll_server", "Failed to watch connection ", id, ": ", std::strerror(error));
+            close(connection, error);
+        }
+    }
+}
+
+void EpollServer::readAll(Loop& loop, const std::shared_ptr<Connection>& connection) {
+    // 边沿触发：一直读到 EAGAIN
+    while (!connection->closed) {
+        const ssize_t n = ::recv(connection->fd, loop.buffer.data(), loop.buffer.size(), 0);
+        if (n > 0) {
+            if (handler_.onReceive(*this, connection->id, loop.buffer.data(), static_cast<std::size_t>(n)) != HandleResult::Ok) {
+                close(connection, 0);
+                return;
+            }
+        } else if (n == 0) {
+            close(connection, 0);
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (!wouldBlock(errno)) {
+                close(connection, errno);
+            }
+            return;
+        }
+    }
+}
+
+void EpollServer::flush(const std::shared_ptr<Connection>& connection) {
+    std::size_t written = 0;
+    int error = 0;
+    {
+        std::lock_guard<std::mutex> lk(connection->mutex);
+        auto& output = connection->output;
+        while (connection->outputOffset < output.size()) {
+            const ssize_t n = ::send(connection->fd, output.data() + connection->outputOffset,
+                                     output.size() - connection->outputOffset, MSG_NOSIGNAL);
+            if (n > 0) {
+                connection->outputOffset += static_cast<std::size_t>(n);
+                written += static_cast<std::size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                if (n < 0 && !wouldBlock(errno)) {
+                    error = errno;
+                }
+                break;
+            }
+        }
+        if (connection->outputOffset == output.size()) {
+            output.clear();
+            connection->outputOffset = 0;
+        } else if (connection->outputOffset >= kCompactBytes && connection->outputOffset * 2 >= output.size()) {
+            output.erase(output.begin(), output.begin() + static_cast<std::ptrdiff_t>(connection->outputOffset));
+            connection->outputOffset = 0;
+        }
+        connection->pending.fetch_sub(written, std::memory_order_relaxed);
+    }
+    if (error != 0) {
+        close(connection, error);
+        return;
+    }
+    if (written > 0) {
+        handler_.onSend(*this, connection->id, written);
+    }
+}
+
+void EpollServer::drainInbox(Loop& loop) {
+    std::vector<std::shared_ptr<Connection>> notify;
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lk(loop.inboxMutex);
+        notify.swap(loop.notify);
+        tasks.swap(loop.tasks);
+        loop.wakePending = false;
+    }
+    for (const auto& connection : notify) {
+        // 先清标记再取字节数：之后的直接写会重新排队
+        connection->notifyQueued.store(false);
+        const std::size_t bytes = connection->unreported.exchange(0, std::memory_order_relaxed);
+        if (bytes > 0 && !connection->closed) {
+            handler_.onSend(*this, connection->id, bytes);
+        }
+    }
+    for (auto& task : tasks) {
+        task();
+    }
+}
+
+void EpollServer::close(const std::shared_ptr<Connection>& connection, int errorCode) {
+    {
+        std::lock_guard<std::mutex> lk(connection->mutex);
+        if (connection->closed) {
+            return;
+        }
+        connection->closed = true;
+        // close 会把 fd 从 epoll 里摘掉
+        ::close(connection->fd);
+        connection->output.clear();
+        connection->outputOffset = 0;
+        connection->pending = 0;
+    }
+    {
+        Loop& loop = *loops_[connection->loop];
+        std::unique_lock<std::shared_mutex> lk(loop.connectionsMutex);
+        loop.connections.erase(connection->id);
+    }
+    handler_.onClose(*this, connection->id, errorCode);
+}
+
+} // namespace network
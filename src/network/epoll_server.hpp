@@ -0,0 +1,119 @@
+// 内置 epoll 后端：N 个 I/O 线程，每个一个边沿触发的 epoll 和自己的一组连接（分片），分片之间不共享锁
+// 默认第一个线程负责 accept，新连接轮流分给各线程；listenerShards > 0 时每个线程一个 SO_REUSEPORT 监听套接字，
+// 由内核把新连接分散到各线程，连接留在接受它的线程上，线程绑定到各自的 CPU 核
+// 连接 ID 的低 8 位是分片号，按 ID 找连接只锁所属分片
+// 发送在调用线程直接 send()（发送缓冲区空时零拷贝），写不完的部分拷进连接的发送缓冲区，等 EPOLLOUT 再写
+// 直接写出的字节数记在连接上，由所属 I/O 线程（eventfd 唤醒，同一批合并成一次唤醒）回调 onSend
+// 配置了 localSocket 时第一个线程还监听该 Unix 域套接字，accept 时按 SO_PEERCRED 校验对端，之后与 TCP 连接完全相同
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "network/tcp_server.hpp"
+
+namespace network {
+
+class EpollServer : public TcpServer {
+public:
+    EpollServer(const TcpServerOptions& options, TcpServerHandler& handler);
+    ~EpollServer() override;
+
+    bool start(const std::string& bindAddress, uint16_t port) override;
+    void stop() override;
+
+    bool send(ConnectionId id, const uint8_t* data, std::size_t length) override;
+    bool disconnect(ConnectionId id) override;
+
+    std::size_t connectionCount() const override;
+    std::size_t pendingBytes(ConnectionId id) const override;
+
+    void setExtra(ConnectionId id, void* extra) override;
+    void* extra(ConnectionId id) const override;
+
+    std::size_t shardCount() const override { return loopCount_; }
+    std::size_t shardOf(ConnectionId id) const override { return static_cast<std::size_t>(id & kShardMask); }
+    void post(std::size_t shard, std::function<void()> task) override;
+
+    const char* backend() const override { return "epoll"; }
+
+    static constexpr unsigned kShardBits = 8;
+    static constexpr ConnectionId kShardMask = (ConnectionId{1} << kShardBits) - 1;
+    static constexpr std::size_t kMaxLoops = std::size_t{1} << kShardBits;
+
+private:
+    struct Connection {
+        Connection(ConnectionId connectionId, int socket, std::size_t loopIndex)
+            : id(connectionId), fd(socket), loop(loopIndex) {}
+
+        const ConnectionId id;
+        const int fd;
+        const std::size_t loop;             // 所属 I/O 线程（分片）
+
+        std::mutex mutex;                   // 保护写 fd 和 output
+        std::vector<uint8_t> output;        // 没写完的数据，从 outputOffset 开始有效
+        std::size_t outputOffset{0};
+        std::atomic<bool> closed{false};
+        std::atomic<std::size_t> pending{0};
+        std::atomic<std::size_t> unreported{0};    // 已直接写出、还没回调 onSend 的字节数
+        std::atomic<bool> notifyQueued{false};
+        std::atomic<void*> extra{nullptr};
+    };
+
+    struct Loop {
+        std::size_t index{0};
+        int epollFd{-1};
+        int wakeFd{-1};                     // eventfd：停止、onSend 通知和投递的任务
+        int listenFd{-1};                   // 只有负责 accept 的线程有
+        int localListenFd{-1};              // Unix 域套接字，只有第一个线程有
+        int reserveFd{-1};                  // 预留的描述符（/dev/null），描述符耗尽时腾出来接受并关掉排队的连接
+        bool acceptStalled{false};          // 描述符耗尽、排队的连接没取走：边沿触发不会再通知，定时重试
+        std::thread thread;
+        std::vector<uint8_t> buffer;        // 读缓冲区
+
+        mutable std::shared_mutex connectionsMutex;
+        std::unordered_map<ConnectionId, std::shared_ptr<Connection>> connections;
+        std::atomic<ConnectionId> nextSerial{1};
+
+        std::mutex inboxMutex;              // 保护以下三项
+        std::vector<std::shared_ptr<Connection>> notify;
+        std::vector<std::function<void()>> tasks;
+        bool wakePending{false};
+    };
+
+    int openListener(const std::string& bindAddress, uint16_t port, bool reusePort) const;
+    int openLocalListener() const;
+    bool peerAllowed(int fd) const;
+    std::shared_ptr<Connection> find(ConnectionId id) const;
+    void run(Loop& loop);
+    void acceptAll(Loop& loop, bool local);
+    bool shedConnection(Loop& loop, int listenFd);
+    void readAll(Loop& loop, const std::shared_ptr<Connection>& connection);
+    void flush(const std::shared_ptr<Connection>& connection);
+    void drainInbox(Loop& loop);
+    void wake(Loop& loop);
+    void deferSent(const std::shared_ptr<Connection>& connection, std::size_t bytes);
+    void close(const std::shared_ptr<Connection>& connection, int errorCode);
+    void closeFds();
+
+    const TcpServerOptions options_;
+    TcpServerHandler& handler_;
+    const std::size_t loopCount_;           // I/O 线程数（= 分片数），创建时就确定
+
+    std::vector<std::unique_ptr<Loop>> loops_;
+    std::atomic<bool> running_{false};
+    std::size_t nextLoop_{0};               // 只在 accept 线程使用（不分片监听时）
+    std::atomic<uint64_t> shed_{0};         // 描述符耗尽时丢弃的连接数（限频告警）
+};
+
+} // namespace network
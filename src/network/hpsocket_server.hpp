@@ -0,0 +1,152 @@
+// HPSocket 后端：把 CTcpServerListener 的回调转给 TcpServerHandler
+// HPSocket 的 Send 在调用线程直接写出时会在 Send 内部同步回调 OnSend，而接口约定 onSend 不在 send() 里回调
+// （调用方持锁发送，回调里再取同一把锁就死锁）：send() 期间在本线程触发的 OnSend 按连接合并字节数，交给通知线程回调，
+// I/O 线程里的 OnSend 照旧直接转发
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "hpsocket/HPSocket.h"
+#include "network/tcp_server.hpp"
+
+namespace network {
+
+class HpSocketServer : public TcpServer, private CTcpServerListener {
+public:
+    HpSocketServer(const TcpServerOptions& options, TcpServerHandler& handler)
+        : options_(options)
+        , handler_(handler)
+        , server_(this) {}
+
+    ~HpSocketServer() override { stop(); }
+
+    bool start(const std::string& bindAddress, uint16_t port) override {
+        if (!notifier_.joinable()) {
+            notifying_ = true;
+            notifier_ = std::thread(&HpSocketServer::notifyLoop, this);
+        }
+        if (options_.maxConnections != 0) {
+            server_->SetMaxConnectionCount(options_.maxConnections);
+        }
+        if (options_.workerThreads != 0) {
+            server_->SetWorkerThreadCount(options_.workerThreads);
+        }
+        return server_->Start(bindAddress.empty() ? nullptr : bindAddress.c_str(), port);
+    }
+
+    void stop() override {
+        server_->Stop();
+        {
+            std::lock_guard<std::mutex> lk(pendingMutex_);
+            notifying_ = false;
+        }
+        pendingCv_.notify_all();
+        if (notifier_.joinable()) {
+            notifier_.join();
+        }
+    }
+
+    bool send(ConnectionId id, const uint8_t* data, std::size_t length) override {
+        const bool outer = !sending_;
+        sending_ = true;
+        const bool ok = server_->Send(static_cast<CONNID>(id), data, static_cast<int>(length));
+        sending_ = !outer;
+        return ok;
+    }
+
+    bool disconnect(ConnectionId id) override { return server_->Disconnect(static_cast<CONNID>(id)); }
+
+    std::size_t connectionCount() const override { return server_->GetConnectionCount(); }
+
+    std::size_t pendingBytes(ConnectionId id) const override {
+        int pending = 0;
+        server_->GetPendingDataLength(static_cast<CONNID>(id), pending);
+        return pending > 0 ? static_cast<std::size_t>(pending) : 0;
+    }
+
+    void setExtra(ConnectionId id, void* extra) override { server_->SetConnectionExtra(static_cast<CONNID>(id), extra); }
+
+    void* extra(ConnectionId id) const override {
+        PVOID extra = nullptr;
+        return server_->GetConnectionExtra(static_cast<CONNID>(id), &extra) ? extra : nullptr;
+    }
+
+    const char* backend() const override { return "hpsocket"; }
+
+private:
+    EnHandleResult OnAccept(ITcpServer*, CONNID id, UINT_PTR) override {
+        return handler_.onAccept(*this, id) == HandleResult::Ok ? HR_OK : HR_ERROR;
+    }
+
+    EnHandleResult OnReceive(ITcpServer*, CONNID id, const BYTE* data, int length) override {
+        if (length <= 0) {
+            return HR_OK;
+        }
+        return handler_.onReceive(*this, id, data, static_cast<std::size_t>(length)) == HandleResult::Ok ? HR_OK : HR_ERROR;
+    }
+
+    EnHandleResult OnSend(ITcpServer*, CONNID id, const BYTE*, int length) override {
+        const std::size_t bytes = length > 0 ? static_cast<std::size_t>(length) : 0;
+        if (!sending_) {
+            handler_.onSend(*this, id, bytes);
+            return HR_OK;
+        }
+        {
+            std::lock_guard<std::mutex> lk(pendingMutex_);
+            pending_[id] += bytes;
+        }
+        pendingCv_.notify_one();
+        return HR_OK;
+    }
+
+    EnHandleResult OnClose(ITcpServer*, CONNID id, EnSocketOperation, int errorCode) override {
+        {
+            // 等正在进行的通知回调结束，并丢掉这个连接还没回调的：onClose 仍是连接的最后一个回调
+            std::lock_guard<std::recursive_mutex> deliver(deliverMutex_);
+            std::lock_guard<std::mutex> lk(pendingMutex_);
+            pending_.erase(id);
+        }
+        handler_.onClose(*this, id, errorCode);
+        return HR_OK;
+    }
+
+    void notifyLoop() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lk(pendingMutex_);
+                pendingCv_.wait(lk, [this] { return !notifying_ || !pending_.empty(); });
+                if (pending_.empty()) {
+                    return;     // 已停止
+                }
+            }
+            // 先拿 deliverMutex_ 再取出待回调的（和 OnClose 同样的加锁顺序）：关闭的连接要么已从 pending_ 删掉，要么等这批回调完
+            std::lock_guard<std::recursive_mutex> deliver(deliverMutex_);
+            std::unordered_map<ConnectionId, std::size_t> batch;
+            {
+                std::lock_guard<std::mutex> lk(pendingMutex_);
+                batch.swap(pending_);
+            }
+            for (const auto& [id, bytes] : batch) {
+                handler_.onSend(*this, id, bytes);
+            }
+        }
+    }
+
+    const TcpServerOptions options_;
+    TcpServerHandler& handler_;
+    CTcpServerPtr server_;  // 构造时传入监听器（this）
+
+    static inline thread_local bool sending_ = false;  // 本线程正在 send() 里
+    std::mutex pendingMutex_;
+    std::condition_variable pendingCv_;
+    std::unordered_map<ConnectionId, std::size_t> pending_;    // send() 里同步触发、还没回调的 onSend 字节数
+    bool notifying_{false};
+    std::recursive_mutex deliverMutex_;     // 通知线程回调期间持有，OnClose 据此保证顺序（回调里发送失败可能在本线程触发 OnClose）
+    std::thread notifier_;
+};
+
+} // namespace network
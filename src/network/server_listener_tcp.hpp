@@ -1,100 +1,151 @@
 #pragma once
 
-#include "hpsocket/HPSocket.h"
+#include "network/tcp_server.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
-//继承 HPSocket 的监听器基类
-class ServerListener : public CTcpServerListener
+//实现传输层的回调接口（后端可以是 HPSocket 或 epoll），记录所有活跃连接
+//连接按传输层的分片分组记录，每组一把锁：各分片的 I/O 线程增删、遍历自己的连接时互不争锁
+class ServerListener : public network::TcpServerHandler
 {
 private:
-    CONNID _connID = 0; // 记录最后一个连接的 ID（注意：并发时会被覆盖）
-    std::vector<CONNID> _connIDs;   //所有活跃连接（只要建立连接没有断开都算活跃连接）
-    mutable std::mutex _connMutex;  //线程锁
+    struct ConnectionShard {
+        std::vector<network::ConnectionId> connIDs;   //这个分片的活跃连接（只要建立连接没有断开都算活跃连接）
+        mutable std::mutex connMutex;  //线程锁
+    };
 
-public:
-    // 当服务器准备开始监听某个端口时触发
-    // pSender: 指向当前的服务器组件对象
-    // soListen: 底层的监听 SOCKET 句柄
-    EnHandleResult OnPrepareListen(ITcpServer *pSender, SOCKET soListen) override
+    std::atomic<network::ConnectionId> _connID{0}; // 记录最后一个连接的 ID（注意：并发时会被覆盖）
+    std::vector<std::unique_ptr<ConnectionShard>> _shards = makeShards(1);
+
+    static std::vector<std::unique_ptr<ConnectionShard>> makeShards(std::size_t count)
+    {
+        std::vector<std::unique_ptr<ConnectionShard>> shards;
+        for (std::size_t i = 0; i < std::max<std::size_t>(count, 1); ++i) {
+            shards.push_back(std::make_unique<ConnectionShard>());
+        }
+        return shards;
+    }
+
+    ConnectionShard& shardFor(network::TcpServer &pSender, network::ConnectionId dwConnID) const
     {
-        // std::cout << "[Server] Ready to listen..." << std::endl;
-        return HR_OK;   //允许启动
+        return *_shards[pSender.shardOf(dwConnID) % _shards.size()];
     }
 
+protected:
+    //按传输层的分片数分组（必须在服务器启动、有连接之前调用）
+    void setShardCount(std::size_t count)
+    {
+        _shards = makeShards(count);
+    }
+
+public:
     //当有新客户端连接时触发（把连接加入连接数组，更新最后连接id）
-    EnHandleResult OnAccept(ITcpServer *pSender, CONNID dwConnID, UINT_PTR soClient) override
+    // pSender: 指向当前的服务器对象
+    network::HandleResult onAccept(network::TcpServer &pSender, network::ConnectionId dwConnID) override
     {
         _connID = dwConnID; //更新最后连接的id
         {
-            // 加锁：防止在记录新连接时，另一个线程正在进行断开清理或遍历
-            std::lock_guard<std::mutex> lk(_connMutex);
+            // 加锁：防止在记录新连接时，另一个线程正在进行断开清理或遍历（只锁所属分片）
+            auto &shard = shardFor(pSender, dwConnID);
+            std::lock_guard<std::mutex> lk(shard.connMutex);
 
             // 将新连接的唯一标识存入数组
-            _connIDs.push_back(dwConnID);
+            shard.connIDs.push_back(dwConnID);
         }
 
         std::cout << "[Server] Client connected: " << dwConnID << std::endl;
-        return HR_OK;   // 确认接受此连接
+        return network::HandleResult::Ok;   // 确认接受此连接
     }
 
     //当该连接有数据到达时触发
     //    pData = 接收到的字节
     //    iLength = 字节数
-    EnHandleResult OnReceive(ITcpServer *pSender, CONNID dwConnID, const BYTE *pData, int iLength) override
+    network::HandleResult onReceive(network::TcpServer &pSender, network::ConnectionId dwConnID, const uint8_t *pData, std::size_t iLength) override
     {
         std::string msg((const char *)pData, iLength);  // 将原始字节流转换为 std::string 方便打印
         std::cout << "[Server] Received: " << msg << std::endl;
 
         std::string reply = "Server reply: " + msg; //构造回复字符串（回声）
-        pSender->Send(dwConnID, (const BYTE *)reply.c_str(), reply.size()); // 调用组件方法，通过 ID 将数据发回给特定的客户端
-        return HR_OK;
+        pSender.send(dwConnID, (const uint8_t *)reply.c_str(), reply.size()); // 调用组件方法，通过 ID 将数据发回给特定的客户端
+        return network::HandleResult::Ok;
     }
 
     // 当连接关闭时触发（客户端断开或错误）
-    EnHandleResult OnClose(ITcpServer *pSender, CONNID dwConnID, EnSocketOperation, int iErrorCode) override
+    void onClose(network::TcpServer &pSender, network::ConnectionId dwConnID, int iErrorCode) override
     {
         std::cout << "[Server] Client disconnected: " << dwConnID << std::endl;
-        std::lock_guard<std::mutex> lk(_connMutex); // 再次加锁保护数组
+        auto &shard = shardFor(pSender, dwConnID);
+        std::lock_guard<std::mutex> lk(shard.connMutex); // 再次加锁保护数组
 
         // 使用 Erase-Remove 惯用法：从数组中找到并删除对应的 dwConnID
-        _connIDs.erase(
-            std::remove(_connIDs.begin(), _connIDs.end(), dwConnID),
-            _connIDs.end());
-        return HR_OK;
+        shard.connIDs.erase(
+            std::remove(shard.connIDs.begin(), shard.connIDs.end(), dwConnID),
+            shard.connIDs.end());
     }
 
 
-    CONNID 
+    network::ConnectionId 
     getConnectionID() const 
-    { return _connID; }
+    { return _connID.load(); }
+
+    std::size_t 
+    shardCount() const 
+    { return _shards.size(); }
+
+    std::vector<network::ConnectionId> 
+    getConnectionIDs(std::size_t shard) const 
+    { 
+        const auto &entry = *_shards[shard];
+        std::lock_guard<std::mutex> lk(entry.connMutex);
+        return entry.connIDs; 
+    }
 
-    std::vector<CONNID> 
+    std::vector<network::ConnectionId> 
     getAllConnectionIDs() const 
     { 
-        std::lock_guard<std::mutex> lk(_connMutex);
-        return _connIDs; 
+        std::vector<network::ConnectionId> ids;
+        for (std::size_t shard = 0; shard < _shards.size(); ++shard) {
+            auto part = getConnectionIDs(shard);
+            ids.insert(ids.end(), part.begin(), part.end());
+        }
+        return ids; 
     }
 
     // 判断当前是否有客户端在线
     bool hasConnections() const
     {
-        std::lock_guard<std::mutex> lk(_connMutex);
-        return !_connIDs.empty();
+        for (const auto &shard : _shards) {
+            std::lock_guard<std::mutex> lk(shard->connMutex);
+            if (!shard->connIDs.empty()) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    //遍历所有连接
+    //遍历一个分片的连接
     template <typename Fn>
-    void forEachConnection(Fn&& fn) const   //传入回调函数（万能引用）
+    void forEachConnection(std::size_t shard, Fn&& fn) const
     {
         // 先拷贝一份列表，这样在遍历执行 fn 时不需要持有锁，提高并发效率
-        auto ids = getAllConnectionIDs();
+        for (const auto id : getConnectionIDs(shard)) {
+            fn(id);
+        }
+    }
 
-        for (const auto id : ids) {
-            fn(id); // 执行传入的函数或 lambda
+    //遍历所有连接
+    template <typename Fn>
+    void forEachConnection(Fn&& fn) const   //传入回调函数（万能引用）
+    {
+        for (std::size_t shard = 0; shard < _shards.size(); ++shard) {
+            forEachConnection(shard, fn); // 执行传入的函数或 lambda
         }
     }
 };
@@ -0,0 +1,26 @@
+#include "network/tcp_server.hpp"
+
+#include "core/logger.hpp"
+#include "network/epoll_server.hpp"
+#include "network/hpsocket_server.hpp"
+
+namespace network {
+
+std::unique_ptr<TcpServer> makeTcpServer(const TcpServerOptions& options, TcpServerHandler& handler) {
+    if (options.backend == "hpsocket") {
+        if (options.listenerShards > 0) {
+            LOG_WARN("tcp_server", "listenerShards requires the epoll transport, using a single HPSocket listener");
+        }
+        if (!options.localSocket.empty()) {
+            LOG_WARN("tcp_server", "localSocket requires the epoll transport, not listening on ", options.localSocket);
+        }
+        return std::make_unique<HpSocketServer>(options, handler);
+    }
+    if (options.backend == "epoll") {
+        return std::make_unique<EpollServer>(options, handler);
+    }
+    LOG_ERROR("tcp_server", "Unknown transport backend ", options.backend);
+    return nullptr;
+}
+
+} // namespace network
@@ -0,0 +1,90 @@
+// TCP 服务端传输层抽象：遥测发布器和视频中转只依赖这组接口，不直接继承 HPSocket 的监听器
+// 后端：
+//   hpsocket  预编译的 libhpsocket（原有实现）
+//   epoll     内置的 Linux 边沿触发 epoll 实现（不依赖第三方库，发送先在调用线程直接写，写不完才缓存）
+//             还可以同时监听一个本机 Unix 域套接字（localSocket），连接和 TCP 连接走同一套回调
+// 回调约定（两个后端一致）：
+//   onAccept 先于该连接的其他回调；同一连接的 onReceive 串行调用；onClose 是连接的最后一个回调
+//   onSend 在数据写入内核后由 I/O 线程调用（不会在 send() 内部同步回调，调用方持有锁时调用 send 是安全的）
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace network {
+
+using ConnectionId = uint64_t;
+
+enum class HandleResult {
+    Ok,
+    Error,      // 断开该连接
+};
+
+class TcpServer;
+
+// 服务端回调
+class TcpServerHandler {
+public:
+    virtual ~TcpServerHandler() = default;
+
+    // 新连接（返回 Error 拒绝）
+    virtual HandleResult onAccept(TcpServer&, ConnectionId) { return HandleResult::Ok; }
+    // 收到数据（返回 Error 断开）
+    virtual HandleResult onReceive(TcpServer& server, ConnectionId id, const uint8_t* data, std::size_t length) = 0;
+    // 又有一批字节（最后一个参数）已写入内核（可以继续发积压的数据）
+    virtual void onSend(TcpServer&, ConnectionId, std::size_t) {}
+    // 连接关闭（最后一个参数是错误码，0 表示正常关闭）
+    virtual void onClose(TcpServer&, ConnectionId, int) {}
+};
+
+struct TcpServerOptions {
+    std::string backend = "hpsocket";   // hpsocket / epoll
+    uint32_t maxConnections = 0;        // 0 表示用后端默认值
+    uint32_t workerThreads = 0;         // I/O 线程数，0 表示用后端默认值
+    uint32_t listenerShards = 0;        // >0 时开这么多个 SO_REUSEPORT 监听，每个一个绑核的 I/O 线程和自己的连接分片（仅 epoll）
+    uint32_t notSentLowat = 0;          // TCP_NOTSENT_LOWAT：内核里未发出的数据超过这么多字节就不再收，其余留在传输层（0 为内核默认，仅 epoll，hpsocket 忽略）
+    std::string localSocket;            // 同时监听的 Unix 域套接字路径（为空不监听，仅 epoll）
+    std::vector<uint32_t> localAllowedUids; // 本机连接按 SO_PEERCRED 校验：uid 或 gid 命中其一即放行
+    std::vector<uint32_t> localAllowedGids; // 两个列表都为空时只允许与本进程同一用户和 root
+};
+
+class TcpServer {
+public:
+    virtual ~TcpServer() = default;
+
+    // 监听 bindAddress:port（地址为空表示所有地址）
+    virtual bool start(const std::string& bindAddress, uint16_t port) = 0;
+    // 停止监听并关闭所有连接（每个连接都会收到 onClose）
+    virtual void stop() = 0;
+
+    // 发送（任意线程可调用；数据在返回前已写入内核或拷进连接的发送缓冲区）
+    virtual bool send(ConnectionId id, const uint8_t* data, std::size_t length) = 0;
+    // 断开连接（异步，随后收到 onClose）
+    virtual bool disconnect(ConnectionId id) = 0;
+
+    virtual std::size_t connectionCount() const = 0;
+    // 已交给传输层但还没写入内核的字节数
+    virtual std::size_t pendingBytes(ConnectionId id) const = 0;
+
+    // 连接附带的指针（onAccept 之后可设置，onClose 之后失效）
+    virtual void setExtra(ConnectionId id, void* extra) = 0;
+    virtual void* extra(ConnectionId id) const = 0;
+
+    // 连接分片：每个分片的连接只由一个 I/O 线程处理，分片之间不共享锁（不分片的后端只有一个分片）
+    virtual std::size_t shardCount() const { return 1; }
+    virtual std::size_t shardOf(ConnectionId) const { return 0; }
+    // 在分片的 I/O 线程上执行 task（不分片的后端直接在调用线程执行；停止后投递的任务丢弃）
+    virtual void post(std::size_t, std::function<void()> task) { task(); }
+
+    virtual const char* backend() const = 0;
+};
+
+// 按 options.backend 创建服务端；未知后端返回空
+std::unique_ptr<TcpServer> makeTcpServer(const TcpServerOptions& options, TcpServerHandler& handler);
+
+} // namespace network
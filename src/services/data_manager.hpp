@@ -14,9 +14,10 @@
 
 #include "core/configuration.hpp"
 #include "domain/telemetry_models.hpp"
-#include "infrastructure/cache/telemetry_cache.hpp"
+#include "infrastructure/cache/compressed_telemetry_cache.hpp"
 #include "infrastructure/database/telemetry_repository.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/tracing.hpp"
 #include "infrastructure/sensors/sensor_data.hpp"
 #include "transport/tcp_data_sender.hpp"
 
@@ -31,8 +32,8 @@ public:
         , repository_(repository)
         , sensorGateway_(sensorGateway)
         , publisher_(publisher)
-        , healthMonitor_(healthMonitor)
-        , cache_(pipelineConfig.cacheSize) {
+        , health_(healthMonitor.registerComponent("telemetry_service"))
+        , cache_(pipelineConfig.cacheSize, std::chrono::hours(pipelineConfig.historyHours)) {
 
         // 设置发布器的快照提供者
         publisher_.setSnapshotProvider([this]() {
@@ -101,27 +102,34 @@ private:
 
     // 处理实时数据
     void processRealtime() {
+        // 整帧按关联 ID 追踪（读取、解码、入缓存、编码、发送各阶段）
+        const uint64_t id = ++correlationId_;
+        monitoring::TraceScope trace(id);
+
         // 从传感器读取实时数据
         auto reading = sensorGateway_.readRealtime();
         if (!reading.has_value()) {
-            healthMonitor_.update("telemetry_service", false, "Realtime read failed");
+            health_.update(false, "Realtime read failed");
             return;
         }
 
         // 将实时数据存入缓存
-        cache_.store(domain::TelemetryChannel::Realtime, *reading);
+        {
+            monitoring::TraceSpan span("cache_store");
+            cache_.store(domain::TelemetryChannel::Realtime, *reading);
+        }
 
         // 如果有客户端订阅（连接），发布数据
         if (publisher_.hasSubscribers()) {
             domain::TelemetryFrame frame;
             frame.channel = domain::TelemetryChannel::Realtime; //数据的通道（实时、历史环境、历史土壤）
             frame.snapshot = false; // 增量数据，不是快照
-            frame.correlationId = nextCorrelationId();
+            frame.correlationId = correlationName(id);
             frame.readings.push_back(*reading); 
             publisher_.publish(frame);  //对所有连接的客户端发布数据
         }
 
-        healthMonitor_.update("telemetry_service", true, "Realtime frame published");
+        health_.update(true, "Realtime frame published");
     }
 
     // 处理历史数据
@@ -152,7 +160,7 @@ private:
             }
         }
 
-        healthMonitor_.update("telemetry_service", true, "Historical frame published");
+        health_.update(true, "Historical frame published");
     }
 
     // 构建快照 frame（用于新客户端连接）
@@ -174,7 +182,10 @@ private:
 
     // 生成下一个关联 ID
     std::string nextCorrelationId() const {
-        auto id = ++correlationId_;
+        return correlationName(++correlationId_);
+    }
+
+    static std::string correlationName(uint64_t id) {
         return "frame-" + std::to_string(id);
     }
 
@@ -182,8 +193,8 @@ private:
     infrastructure::database::TelemetryRepository& repository_; //数据库
     SensorGateway& sensorGateway_;  //传感器
     TelemetryPublisher& publisher_; //推送端
-    monitoring::HealthMonitor& healthMonitor_;  //健康监控
-    infrastructure::cache::TelemetryCache cache_;   //缓存传感器数据到内存中，避免频繁访问数据库
+    monitoring::HealthMonitor::Handle health_;  //健康监控
+    infrastructure::cache::CompressedTelemetryCache cache_;   //缓存传感器数据到内存中（Gorilla 压缩），避免频繁访问数据库
 
     std::atomic<bool> running_{false};
     std::thread worker_;
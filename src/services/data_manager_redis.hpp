@@ -13,9 +13,10 @@
 #include "domain/telemetry_models.hpp"
 #include "infrastructure/cache/redis_client.hpp"
 #include "infrastructure/cache/redis_telemetry_cache.hpp"
-#include "infrastructure/cache/telemetry_cache.hpp"
+#include "infrastructure/cache/compressed_telemetry_cache.hpp"
 #include "infrastructure/database/telemetry_repository.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/tracing.hpp"
 #include "infrastructure/sensors/sensor_data.hpp"
 #include "transport/tcp_data_sender.hpp"
 
@@ -32,8 +33,8 @@ public:
         , repository_(repository)
         , sensorGateway_(sensorGateway)
         , publisher_(publisher)
-        , healthMonitor_(healthMonitor)
-        , memoryCache_(pipelineConfig.cacheSize)
+        , health_(healthMonitor.registerComponent("telemetry_service"))
+        , memoryCache_(pipelineConfig.cacheSize, std::chrono::hours(pipelineConfig.historyHours))
         , redisClient_(redisConfig, healthMonitor)
         , redisCache_(redisClient_, pipelineConfig.cacheSize) {
 
@@ -110,27 +111,34 @@ private:
 
     // 处理实时数据
     void processRealtime() {
+        // 整帧按关联 ID 追踪（读取、解码、入缓存、编码、发送各阶段）
+        const uint64_t id = ++correlationId_;
+        monitoring::TraceScope trace(id);
+
         // 从传感器读取实时数据
         auto reading = sensorGateway_.readRealtime();
         if (!reading.has_value()) {
-            healthMonitor_.update("telemetry_service", false, "Realtime read failed");
+            health_.update(false, "Realtime read failed");
             return;
         }
 
         // 存入缓存（Redis 或内存）
-        storeToCache(domain::TelemetryChannel::Realtime, *reading);
+        {
+            monitoring::TraceSpan span("cache_store");
+            storeToCache(domain::TelemetryChannel::Realtime, *reading);
+        }
 
         // 如果有客户端订阅，发布数据
         if (publisher_.hasSubscribers()) {
             domain::TelemetryFrame frame;
             frame.channel = domain::TelemetryChannel::Realtime;
             frame.snapshot = false;
-            frame.correlationId = nextCorrelationId();
+            frame.correlationId = correlationName(id);
             frame.readings.push_back(*reading);
             publisher_.publish(frame);
         }
 
-        healthMonitor_.update("telemetry_service", true, "Realtime frame published");
+        health_.update(true, "Realtime frame published");
     }
 
     // 处理历史数据
@@ -161,7 +169,7 @@ private:
             }
         }
 
-        healthMonitor_.update("telemetry_service", true, "Historical frame published");
+        health_.update(true, "Historical frame published");
     }
 
     // 存储到缓存（自动选择 Redis 或内存）
@@ -201,7 +209,10 @@ private:
 
     // 生成下一个关联 ID
     std::string nextCorrelationId() const {
-        auto id = ++correlationId_;
+        return correlationName(++correlationId_);
+    }
+
+    static std::string correlationName(uint64_t id) {
         return "frame-" + std::to_string(id);
     }
 
@@ -210,10 +221,10 @@ private:
     infrastructure::database::TelemetryRepository& repository_;
     SensorGateway& sensorGateway_;
     TelemetryPublisher& publisher_;
-    monitoring::HealthMonitor& healthMonitor_;
+    monitoring::HealthMonitor::Handle health_;  // 健康状态句柄（构造时登记一次）
 
     // 双缓存策略：Redis 优先，内存作为降级方案
-    infrastructure::cache::TelemetryCache memoryCache_;
+    infrastructure::cache::CompressedTelemetryCache memoryCache_;
     infrastructure::cache::RedisClient redisClient_;
     infrastructure::cache::RedisTelemetryCache redisCache_;
 
@@ -0,0 +1,364 @@
+// 视频通道协议：角色声明 + 可选的长度前缀分帧，按连接增量解析
+// 连接开头是一行角色声明 "ROLE:<PUBLISHER|SUBSCRIBER>[ 选项...]\n"，选项 FRAMED 表示使用分帧协议；
+// 角色行和后面的视频数据可能在同一次 onReceive 里到达，也可能被拆成好几次，解析器按字节流切分，两种情况结果一样
+// 兼容旧客户端：不带换行的 "ROLE:PUBLISHER" 后面直接跟视频数据也能识别
+//
+// 分帧模式下每帧 = 20 字节帧头（网络字节序）+ 负载：
+//   magic u16 (0x4156 "AV") | version u8 | flags u8 | streamId u16 | reserved u16 | timestamp u64 | length u32
+//   flags：bit0 关键帧，bit1 编解码配置（SPS/PPS 等），bit2 timestamp 为采集时刻的 Unix 微秒（服务端据此统计采集到发送的延迟）
+// 转发以整帧为单位，丢包策略只会丢整帧，不会把一帧截断在中间
+// 原始模式（不带 FRAMED）沿用旧行为：收到的数据块原样转发，没有帧边界
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/packet_pool.hpp"
+
+namespace video_framing {
+
+inline constexpr uint16_t kMagic = 0x4156;     // "AV"
+inline constexpr uint8_t kVersion = 1;
+inline constexpr std::size_t kHeaderBytes = 20;
+inline constexpr uint8_t kFlagKeyframe = 0x01;
+inline constexpr uint8_t kFlagConfig = 0x02;
+inline constexpr uint8_t kFlagWallclock = 0x04;
+inline constexpr uint32_t kMaxFrameBytes = 16 * 1024 * 1024;   // 超过视为协议错误
+inline constexpr std::size_t kMaxRoleLine = 256;
+
+struct FrameHeader {
+    uint8_t flags{0};
+    uint16_t streamId{0};
+    uint64_t timestamp{0};      // 推流端时间戳，单位由推流端约定（建议微秒）
+    uint32_t length{0};         // 负载长度，不含帧头
+};
+
+// 写帧头（推流端和测试工具使用）
+inline void encodeHeader(const FrameHeader& header, uint8_t* out) {
+    out[0] = static_cast<uint8_t>(kMagic >> 8);
+    out[1] = static_cast<uint8_t>(kMagic & 0xFF);
+    out[2] = kVersion;
+    out[3] = header.flags;
+    out[4] = static_cast<uint8_t>(header.streamId >> 8);
+    out[5] = static_cast<uint8_t>(header.streamId & 0xFF);
+    out[6] = 0;
+    out[7] = 0;
+    for (int i = 0; i < 8; ++i) {
+        out[8 + i] = static_cast<uint8_t>(header.timestamp >> (56 - 8 * i));
+    }
+    for (int i = 0; i < 4; ++i) {
+        out[16 + i] = static_cast<uint8_t>(header.length >> (24 - 8 * i));
+    }
+}
+
+// 读帧头；magic 或版本不对返回 false
+inline bool decodeHeader(const uint8_t* in, FrameHeader& header) {
+    if (((static_cast<uint16_t>(in[0]) << 8) | in[1]) != kMagic || in[2] != kVersion) {
+        return false;
+    }
+    header.flags = in[3];
+    header.streamId = static_cast<uint16_t>((in[4] << 8) | in[5]);
+    header.timestamp = 0;
+    for (int i = 0; i < 8; ++i) {
+        header.timestamp = (header.timestamp << 8) | in[8 + i];
+    }
+    header.length = 0;
+    for (int i = 0; i < 4; ++i) {
+        header.length = (header.length << 8) | in[16 + i];
+    }
+    return true;
+}
+
+// 改写帧头里的 streamId（服务端按流名统一编号）
+inline void rewriteStreamId(uint8_t* header, uint16_t streamId) {
+    header[4] = static_cast<uint8_t>(streamId >> 8);
+    header[5] = static_cast<uint8_t>(streamId & 0xFF);
+}
+
+} // namespace video_framing
+
+// 视频数据包结构（data 为池化的引用计数缓冲区，转发给多个订阅端时共享同一块内存）
+struct VideoPacket {
+    core::PacketRef data;   // 视频数据（分帧模式下包含帧头）
+    int64_t timestamp{0};   // 收到的时间（steady_clock）
+    uint64_t source{0};     // 推流连接 ID
+    uint64_t pts{0};        // 推流端时间戳（帧头中的 timestamp，原始模式为 0）
+    uint16_t streamId{0};
+    uint8_t flags{0};
+    uint8_t headerBytes{0}; // 帧头长度，原始数据块为 0
+
+    bool framed() const { return headerBytes != 0; }
+    bool keyframe() const { return (flags & video_framing::kFlagKeyframe) != 0; }
+    bool config() const { return (flags & video_framing::kFlagConfig) != 0; }
+    bool wallclock() const { return (flags & video_framing::kFlagWallclock) != 0; }
+};
+
+// 解析出的角色声明
+struct RoleDeclaration {
+    std::string role;                   // 声明的角色原文（PUBLISHER / SUBSCRIBER / 其他）
+    bool publisher{false};
+    bool framed{false};                 // 带 FRAMED 选项
+    std::vector<std::string> options;   // 其余选项，原样保留
+};
+
+// 单个连接的增量解析器；同一连接的回调由传输层串行调用，解析器本身不加锁
+class VideoStreamParser {
+public:
+    bool publisher() const { return state_ == State::Raw || state_ == State::Framed; }
+    bool framed() const { return state_ == State::Framed; }
+    const std::string& error() const { return error_; }
+
+    // 喂入一次收到的数据：
+    //   onRole(const RoleDeclaration&)   解析出角色声明
+    //   onPacket(VideoPacket&&)          推流端的一个数据块（原始模式）或一整帧（分帧模式）
+    //   onIgnored(std::size_t)           非推流端发来的数据（被忽略的字节数）
+    // 返回 false 表示协议错误（帧头非法、帧过大、角色行过长），调用方应断开连接
+    template <typename OnRole, typename OnPacket, typename OnIgnored>
+    bool feed(const uint8_t* data, std::size_t length, core::PacketPool& pool,
+              OnRole&& onRole, OnPacket&& onPacket, OnIgnored&& onIgnored) {
+        const int64_t receivedAt = std::chrono::steady_clock::now().time_since_epoch().count();
+
+        // 旧行为：原始推流端以 "ROLE:" 开头的数据块是新的角色声明
+        if (state_ == State::Raw && startsWithRole(data, length)) {
+            state_ = State::Handshake;
+        }
+
+        while (length > 0) {
+            switch (state_) {
+            case State::Handshake:
+                if (!consumeHandshake(data, length, pool, receivedAt, onRole, onPacket, onIgnored)) {
+                    return false;
+                }
+                break;
+
+            case State::Raw: {
+                VideoPacket packet;
+                packet.data = pool.copyFrom(data, length);
+                packet.timestamp = receivedAt;
+                onPacket(std::move(packet));
+                length = 0;
+                break;
+            }
+
+            case State::Framed:
+                if (!consumeFrame(data, length, pool, receivedAt, onPacket)) {
+                    return false;
+                }
+                break;
+            }
+        }
+        return true;
+    }
+
+private:
+    enum class State {
+        Handshake,  // 等待角色声明（订阅端一直处于这个状态）
+        Raw,        // 原始推流
+        Framed,     // 分帧推流
+    };
+
+    static constexpr const char kRolePrefix[] = "ROLE:";
+    static constexpr std::size_t kRolePrefixLength = 5;
+    static constexpr const char* kLegacyRoles[] = {"ROLE:PUBLISHER", "ROLE:SUBSCRIBER"};
+
+    static bool startsWithRole(const uint8_t* data, std::size_t length) {
+        return length >= kRolePrefixLength && std::memcmp(data, kRolePrefix, kRolePrefixLength) == 0;
+    }
+
+    static bool isOptionSeparator(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    template <typename OnRole, typename OnPacket, typename OnIgnored>
+    bool consumeHandshake(const uint8_t*& data, std::size_t& length, core::PacketPool& pool, int64_t receivedAt,
+                          OnRole& onRole, OnPacket& onPacket, OnIgnored& onIgnored) {
+        // 逐字节确认开头是 "ROLE:"（前缀本身也可能被拆开）
+        while (line_.size() < kRolePrefixLength && length > 0) {
+            if (static_cast<char>(*data) != kRolePrefix[line_.size()]) {
+                // 不是角色声明：订阅端发来的数据，连同已缓存的字节一起忽略
+                onIgnored(line_.size() + length);
+                line_.clear();
+                length = 0;
+                return true;
+            }
+            line_.push_back(static_cast<char>(*data));
+            ++data;
+            --length;
+        }
+        if (line_.size() < kRolePrefixLength) {
+            return true;    // 前缀还没收全
+        }
+
+        // 之后的字节全部收进行缓冲区再切分（只在握手阶段发生）
+        line_.append(reinterpret_cast<const char*>(data), length);
+        data += length;
+        length = 0;
+
+        // 旧客户端的 "ROLE:PUBLISHER" 后面可能不带换行直接跟视频数据（数据里也可能碰巧有换行字节）
+        bool waitForLine = false;
+        for (const char* legacy : kLegacyRoles) {
+            const std::size_t legacyLength = std::strlen(legacy);
+            if (line_.size() <= legacyLength) {
+                if (std::memcmp(line_.data(), legacy, line_.size()) == 0) {
+                    return true;    // 还可能是完整的声明，等后续字节
+                }
+                continue;
+            }
+            if (std::memcmp(line_.data(), legacy, legacyLength) != 0) {
+                continue;
+            }
+            if (isOptionSeparator(line_[legacyLength]) || line_[legacyLength] == '\n') {
+                waitForLine = true;     // 新格式的声明，按行处理
+                break;
+            }
+            rest_.assign(line_, legacyLength, std::string::npos);
+            line_.resize(legacyLength);
+            applyRole(parseRoleLine(line_), onRole);
+            line_.clear();
+            // 角色之后紧跟的数据
+            if (state_ == State::Raw) {
+                VideoPacket packet;
+                packet.data = pool.copyFrom(rest_.data(), rest_.size());
+                packet.timestamp = receivedAt;
+                onPacket(std::move(packet));
+            } else {
+                onIgnored(rest_.size());
+            }
+            return true;
+        }
+
+        const std::size_t newline = line_.find('\n');
+        if (newline == std::string::npos) {
+            if (line_.size() > video_framing::kMaxRoleLine) {
+                error_ = "role line too long";
+                return false;
+            }
+            if (!waitForLine) {
+                // 旧客户端整块的 "ROLE:xxx"（未知角色）：按整块处理
+                applyRole(parseRoleLine(line_), onRole);
+                line_.clear();
+            }
+            return true;
+        }
+        if (newline > video_framing::kMaxRoleLine) {
+            error_ = "role line too long";
+            return false;
+        }
+
+        // 一行完整的声明，剩余字节交回 feed() 按新角色继续解析
+        rest_.assign(line_, newline + 1, std::string::npos);
+        line_.resize(newline);
+        if (!line_.empty() && line_.back() == '\r') {
+            line_.pop_back();
+        }
+        applyRole(parseRoleLine(line_), onRole);
+        line_.clear();
+        data = reinterpret_cast<const uint8_t*>(rest_.data());
+        length = rest_.size();
+        return true;
+    }
+
+    template <typename OnPacket>
+    bool consumeFrame(const uint8_t*& data, std::size_t& length, core::PacketPool& pool, int64_t receivedAt,
+                      OnPacket& onPacket) {
+        if (headerFill_ < video_framing::kHeaderBytes) {
+            const std::size_t n = std::min(video_framing::kHeaderBytes - headerFill_, length);
+            std::memcpy(header_ + headerFill_, data, n);
+            headerFill_ += n;
+            data += n;
+            length -= n;
+            if (headerFill_ < video_framing::kHeaderBytes) {
+                return true;
+            }
+
+            if (!video_framing::decodeHeader(header_, current_)) {
+                error_ = "bad frame header";
+                return false;
+            }
+            if (current_.length > video_framing::kMaxFrameBytes) {
+                error_ = "frame too large: " + std::to_string(current_.length);
+                return false;
+            }
+            // 帧头和负载放进同一块池化缓冲区，分帧订阅端可以原样转发
+            frame_ = pool.allocate(video_framing::kHeaderBytes + current_.length);
+            std::memcpy(frame_.data(), header_, video_framing::kHeaderBytes);
+            payloadFill_ = 0;
+        } else {
+            const std::size_t n = std::min<std::size_t>(current_.length - payloadFill_, length);
+            std::memcpy(frame_.data() + video_framing::kHeaderBytes + payloadFill_, data, n);
+            payloadFill_ += n;
+            data += n;
+            length -= n;
+        }
+
+        if (payloadFill_ == current_.length) {
+            VideoPacket packet;
+            packet.data = std::move(frame_);
+            packet.timestamp = receivedAt;
+            packet.pts = current_.timestamp;
+            packet.streamId = current_.streamId;
+            packet.flags = current_.flags;
+            packet.headerBytes = static_cast<uint8_t>(video_framing::kHeaderBytes);
+            headerFill_ = 0;
+            onPacket(std::move(packet));
+        }
+        return true;
+    }
+
+    static RoleDeclaration parseRoleLine(const std::string& line) {
+        RoleDeclaration declaration;
+        std::size_t pos = kRolePrefixLength;
+        bool first = true;
+        while (pos < line.size()) {
+            while (pos < line.size() && isOptionSeparator(line[pos])) {
+                ++pos;
+            }
+            std::size_t end = pos;
+            while (end < line.size() && !isOptionSeparator(line[end])) {
+                ++end;
+            }
+            if (end > pos) {
+                std::string token = line.substr(pos, end - pos);
+                if (first) {
+                    declaration.role = std::move(token);
+                    first = false;
+                } else if (token == "FRAMED") {
+                    declaration.framed = true;
+                } else {
+                    declaration.options.push_back(std::move(token));
+                }
+            }
+            pos = end;
+        }
+        declaration.publisher = declaration.role == "PUBLISHER";
+        return declaration;
+    }
+
+    template <typename OnRole>
+    void applyRole(const RoleDeclaration& declaration, OnRole& onRole) {
+        if (declaration.publisher) {
+            state_ = declaration.framed ? State::Framed : State::Raw;
+        } else {
+            state_ = State::Handshake;
+        }
+        headerFill_ = 0;
+        frame_.reset();
+        onRole(declaration);
+    }
+
+    State state_{State::Handshake};
+    std::string line_;                  // 未收全的角色行
+    std::string rest_;                  // 角色行之后、同一次收到的数据
+    uint8_t header_[video_framing::kHeaderBytes]{};
+    std::size_t headerFill_{0};
+    video_framing::FrameHeader current_;
+    core::PacketRef frame_;             // 正在拼装的帧
+    std::size_t payloadFill_{0};
+    std::string error_;
+};
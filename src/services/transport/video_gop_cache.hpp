@@ -0,0 +1,83 @@
+// GOP 缓存：每路分帧流保留最近的编解码配置帧和"最近一个关键帧 + 其后的帧"
+// 新订阅端加入时先收到这组帧，不用等下一个关键帧就能出画面；缓存的是共享的引用计数缓冲区，不额外拷贝
+// 缓存超过帧数或字节上限时整组作废（不完整的 GOP 解不出来），等下一个关键帧重新开始
+// 非线程安全，由 VideoManager 加锁访问
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "services/transport/video_framing.hpp"
+
+class GopCache {
+public:
+    GopCache(std::size_t maxFrames, std::size_t maxBytes)
+        : maxFrames_(maxFrames)
+        , maxBytes_(maxBytes) {}
+
+    // 记录一帧（只接受分帧数据）
+    void add(const VideoPacket& packet) {
+        if (packet.config()) {
+            // 连续到达的配置帧是一组（如 SPS + PPS），中间隔了其他帧就换新的一组
+            if (!lastWasConfig_) {
+                config_.clear();
+            }
+            config_.push_back(packet);
+            lastWasConfig_ = true;
+            if (!packet.keyframe()) {
+                return;
+            }
+        } else {
+            lastWasConfig_ = false;
+        }
+
+        if (packet.keyframe()) {
+            frames_.clear();
+            bytes_ = 0;
+        } else if (frames_.empty()) {
+            return;     // 还没有关键帧（或缓存已作废）
+        }
+
+        if (frames_.size() >= maxFrames_ || bytes_ + packet.data.size() > maxBytes_) {
+            frames_.clear();
+            bytes_ = 0;
+            return;
+        }
+        frames_.push_back(packet);
+        bytes_ += packet.data.size();
+    }
+
+    // 按播放顺序逐帧回调（配置帧在前）；没有可用的 GOP 时只回调配置帧
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& packet : config_) {
+            if (!packet.keyframe()) {
+                fn(packet);
+            }
+        }
+        for (const auto& packet : frames_) {
+            fn(packet);
+        }
+    }
+
+    // 推流端断开或更换时清空（旧画面不再拿来预填）
+    void clear() {
+        config_.clear();
+        frames_.clear();
+        bytes_ = 0;
+        lastWasConfig_ = false;
+    }
+
+    std::size_t frames() const { return frames_.size(); }
+    std::size_t bytes() const { return bytes_; }
+
+private:
+    const std::size_t maxFrames_;
+    const std::size_t maxBytes_;
+    std::vector<VideoPacket> config_;
+    std::vector<VideoPacket> frames_;
+    std::size_t bytes_{0};
+    bool lastWasConfig_{false};
+};
@@ -1,40 +1,116 @@
 #include "video_manager.hpp"
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <functional>
 
-VideoManager::VideoManager(monitoring::HealthMonitor* monitor) 
-    : server_(this)
-    , healthMonitor_(monitor)
+namespace {
+
+constexpr const char* kMulticastOption = "MULTICAST";   // 订阅端改从组播组接收
+
+// 角色行里的流名：推流端取第一个，订阅端可以用逗号或空格分隔多个；没有声明时为默认流
+std::vector<std::string> streamNames(const RoleDeclaration& declaration) {
+    std::vector<std::string> names;
+    for (const auto& option : declaration.options) {
+        if (option == kMulticastOption) {
+            continue;
+        }
+        std::size_t start = 0;
+        while (start < option.size()) {
+            std::size_t end = option.find(',', start);
+            if (end == std::string::npos) {
+                end = option.size();
+            }
+            if (end > start) {
+                std::string name = option.substr(start, end - start);
+                if (std::find(names.begin(), names.end(), name) == names.end()) {
+                    names.push_back(std::move(name));
+                }
+            }
+            start = end + 1;
+        }
+    }
+    if (names.empty()) {
+        names.emplace_back(VideoManager::kDefaultStream);
+    }
+    return names;
+}
+
+} // namespace
+
+VideoManager::VideoManager(core::VideoConfig config, monitoring::HealthMonitor* monitor)
+    : config_(std::move(config))
+    , subscribers_(std::make_shared<SubscriberMap>())
 {
+    network::TcpServerOptions options;
+    options.backend = config_.transport;
+    server_ = network::makeTcpServer(options, *this);
+    setHealthMonitor(monitor);
+
+    // 预填的 GOP 要能整组放进订阅端队列
+    gopFrames_ = std::min<std::size_t>(config_.gopCacheFrames, config_.subscriberQueuePackets);
+
+    dropPolicy_ = parseDropPolicy(config_.dropPolicy);
+    if (config_.dropPolicy != dropPolicyName(dropPolicy_)) {
+        LOG_WARN("video_manager", "Unknown drop policy ", config_.dropPolicy, ", using ", dropPolicyName(dropPolicy_));
+    }
+
+    const std::size_t workerCount = std::max<std::size_t>(1, config_.relayWorkers);
+    for (std::size_t i = 0; i < workerCount; ++i) {
+        auto worker = std::make_unique<RelayWorker>(std::max<std::size_t>(config_.relayQueuePackets, 16));
+        worker->depth = &monitoring::MetricsRegistry::instance().gauge(
+            "aqua_video_queue_depth", "Video packets waiting for a relay worker", "worker=\"" + std::to_string(i) + "\"");
+        workers_.push_back(std::move(worker));
+    }
+
+    if (config_.recording.enabled) {
+        recorder_ = std::make_unique<VideoRecorder>(config_.recording);
+    }
 }
 
 VideoManager::~VideoManager() {
+    setHealthMonitor(nullptr);  // 先移除探针，监控线程不会再访问本对象
     stop();
 }
 
+void VideoManager::setHealthMonitor(monitoring::HealthMonitor* monitor) {
+    if (monitor_ != nullptr) {
+        monitor_->removeProbe(probeId_);
+    }
+    monitor_ = monitor;
+    probeId_ = monitor_ ? monitor_->addProbe("video_manager", [this](const auto& handle) { sampleHealth(handle); }) : 0;
+}
+
 
 bool VideoManager::start(uint16_t port) {
-    // 启动 HPSocket 服务器
-    if (!server_->Start(nullptr, port)) // 传的是视频模块配置中的端口
+    // 组播要在接受连接之前准备好，之后创建的流才有组播通道
+    if (config_.multicast.enabled && !multicast_) {
+        multicast_ = std::make_unique<VideoMulticast>(config_.multicast);
+        if (!multicast_->start()) {
+            multicast_.reset();     // 组播不可用时订阅端全部走 TCP
+        }
+    }
+
+    // 启动传输层服务器
+    if (!server_ || !server_->start("", port)) // 传的是视频模块配置中的端口
     {
         LOG_ERROR("video_manager", "Failed to start server on port ", port);
-
-        //更新健康检查
-        if (healthMonitor_) 
-        {
-            healthMonitor_->update("video_manager", false, "Start failed");
-        }
         return false;
     }
 
-    // 启动转发线程
+    // 启动转发线程（直接分发模式下不需要）
     running_ = true;
-    relayThread_ = std::thread(&VideoManager::relayThreadFunc, this);
-    LOG_INFO("video_manager", "Started on port ", port);
-    if (healthMonitor_) 
-    {
-        healthMonitor_->update("video_manager", true, "Listening on port " + std::to_string(port));
+    if (recorder_) {
+        recorder_->start();
+    }
+    if (config_.directFanout) {
+        LOG_INFO("video_manager", "Started on port ", port, " (", server_->backend(), ") with direct fan-out");
+    } else {
+        for (auto& worker : workers_) {
+            worker->thread = std::thread(&VideoManager::relayThreadFunc, this, std::ref(*worker));
+        }
+        LOG_INFO("video_manager", "Started on port ", port, " (", server_->backend(), ") with ", workers_.size(), " relay workers");
     }
     return true;
 }
@@ -42,113 +118,548 @@ bool VideoManager::start(uint16_t port) {
 void VideoManager::stop() {
     if (!running_) return;
     running_ = false;
-    queueCv_.notify_all();  // 唤醒转发线程
-    if (relayThread_.joinable()) relayThread_.join();
-    server_->Stop();
+    // 先停传输层：直接分发模式下 fanOut 跑在接收线程上，停掉之后才没有线程再往录像和组播里送帧
+    server_->stop();
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lk(worker->mutex);
+        }
+        worker->cv.notify_all();  // 唤醒转发线程
+    }
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    if (recorder_) {
+        recorder_->stop();  // 转发线程退出后再停，队列里剩下的帧写完
+    }
+    if (multicast_) {
+        multicast_->stop();
+    }
 }
 
-EnHandleResult VideoManager::OnAccept(ITcpServer* pSender, CONNID dwConnID, UINT_PTR soClient) {
+network::HandleResult VideoManager::onAccept(network::TcpServer& pSender, network::ConnectionId dwConnID) {
     // 新客户端连接
     std::lock_guard<std::mutex> lk(clientsMutex_);
 
-    VideoClient client{dwConnID, false};    // 默认为非publisher
-    clients_[dwConnID] = client;
+    // 默认为默认流的订阅端，分配发送队列
+    VideoClient client{dwConnID, false,
+                       std::make_shared<VideoSubscriber>(dwConnID, &pSender, config_.subscriberQueuePackets,
+                                                         static_cast<std::size_t>(config_.maxPendingKb) * 1024, dropPolicy_),
+                       std::make_unique<VideoConnection>(),
+                       {},
+                       nullptr};
+    // 连接级状态挂到连接上，onReceive 直接取用（onClose 是连接的最后一个回调，之后才释放）
+    pSender.setExtra(dwConnID, client.connection.get());
+    VideoClient& stored = clients_[dwConnID] = std::move(client);
+    clientCount_.set(static_cast<int64_t>(clients_.size()));
+    rebuildSubscribersLocked();
+    joinLocked(stored, streamLocked(kDefaultStream));
+    stored.subscriber->drain();
 
     LOG_INFO("video_manager", "Client connected: ", dwConnID);
-    if (healthMonitor_) {
-        healthMonitor_->update("video_manager", true, "Client connected: " + std::to_string(dwConnID));
-    }
-    return HR_OK;
+    return network::HandleResult::Ok;
 }
 
-EnHandleResult VideoManager::OnClose(ITcpServer* pSender, CONNID dwConnID, EnSocketOperation, int) {
+void VideoManager::onClose(network::TcpServer&, network::ConnectionId dwConnID, int) {
     std::lock_guard<std::mutex> lk(clientsMutex_);
 
-    clients_.erase(dwConnID);   //删掉视频客户端的连接
+    if (auto it = clients_.find(dwConnID); it != clients_.end()) {
+        leaveAllLocked(it->second);
+        stopPlaybackLocked(it->second);
+        if (it->second.connection) {
+            stopPublishingLocked(*it->second.connection);
+        }
+        clients_.erase(it);   //删掉视频客户端的连接
+    }
+    clientCount_.set(static_cast<int64_t>(clients_.size()));
+    rebuildSubscribersLocked();     // 转发线程手里的旧快照仍持有订阅端对象，用完自动释放
 
     LOG_INFO("video_manager", "Client disconnected: ", dwConnID);
-    if (healthMonitor_) 
-    {
-        healthMonitor_->update("video_manager", true, "Client disconnected: " + std::to_string(dwConnID));
+}
+
+//pData：数据   iLength：数据长度
+network::HandleResult VideoManager::onReceive(network::TcpServer& pSender, network::ConnectionId dwConnID, const uint8_t* pData, std::size_t iLength) {
+    auto* connection = static_cast<VideoConnection*>(pSender.extra(dwConnID));
+    if (connection == nullptr) {
+        return network::HandleResult::Ok;
     }
 
-    return HR_OK;
+    // 按字节流解析：角色声明可能和数据合并到达或被拆开，分帧推流按帧切分
+    // 推流端的数据拷进池化缓冲区，交给负责这路流的转发线程（整个转发过程中唯一的一次拷贝）
+    RelayWorker* worker = nullptr;
+    const bool ok = connection->parser.feed(
+        pData, iLength, packetPool_,
+        [&](const RoleDeclaration& declaration) { applyRole(&pSender, dwConnID, *connection, declaration); },
+        [&](VideoPacket&& pkt) {
+            const auto& stream = connection->publishing;
+            if (!stream) {
+                return;     // 推流端被拒绝
+            }
+            pkt.source = dwConnID;
+            if (pkt.framed()) {
+                // 帧头的 streamId 改写为流编号（缓冲区此时还没有共享出去）
+                pkt.streamId = stream->number;
+                video_framing::rewriteStreamId(pkt.data.data(), stream->number);
+            }
+
+            if (config_.directFanout) {
+                // 直接分发：在本连接的接收线程里入队到各订阅端并触发发送，省掉一次队列交接和跨线程唤醒
+                // 一路流只有一个推流连接，传输层串行调用同一连接的接收回调，帧序不变
+                fanOut(*stream, pkt);
+                return;
+            }
+
+            RelayWorker* target = workers_[stream->worker].get();
+            if (worker != nullptr && worker != target) {
+                worker->cv.notify_one();
+            }
+            worker = target;
+            //入队（移动，不拷贝缓冲区）
+            std::lock_guard<std::mutex> lk(worker->mutex);
+            if (!worker->queue.tryPush(RelayItem{stream, std::move(pkt)})) {
+                relayDropped_.inc();
+            }
+            worker->depth->set(static_cast<int64_t>(worker->queue.sizeApprox()));
+        },
+        [&](std::size_t) {
+            //不是推流端，不转发数据
+            LOG_WARN("video_manager", "Subscriber ", dwConnID, " attempted to push data. Ignored.");
+        });
+
+    //唤醒转发线程
+    if (worker != nullptr) {
+        worker->cv.notify_one();
+    }
+
+    if (!ok) {
+        LOG_WARN("video_manager", "Protocol error from client ", dwConnID, ": ", connection->parser.error());
+        protocolErrors_.inc();
+        return network::HandleResult::Error;    // 传输层随后关闭连接
+    }
+    if (connection->rejected) {
+        return network::HandleResult::Error;
+    }
+    return network::HandleResult::Ok;
 }
 
-//pData：数据   iLength：数据长度
-EnHandleResult VideoManager::OnReceive(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) {
-    if (iLength <= 0) return HR_OK;
+void VideoManager::applyRole(network::TcpServer* sender, network::ConnectionId id, VideoConnection& connection, const RoleDeclaration& declaration) {
+    if (declaration.role == "PLAYBACK") {
+        startPlayback(sender, id, connection, declaration);
+        return;
+    }
+    const auto names = streamNames(declaration);
 
-    //将数据构造成字符串
-    std::string payload(reinterpret_cast<const char*>(pData), iLength);
+    std::lock_guard<std::mutex> lk(clientsMutex_);
+    auto it = clients_.find(id);
+    if (it == clients_.end()) {
+        return;
+    }
+    VideoClient& client = it->second;
 
-    // 检查是否是角色声明（格式：ROLE:PUBLISHER 或 ROLE:SUBSCRIBER）
-    // 处理角色声明（如果是PUBLISHER则isPublisher存true）
-    if (payload.rfind("ROLE:", 0) == 0) {   //检查前缀是否是ROLE:
-        std::string role = payload.substr(5);   // 从指定的 start_index（5，也就是"ROLE:"之后） 开始，一直截取到字符串的末尾
+    // 先退出原来的角色
+    leaveAllLocked(client);
+    stopPublishingLocked(connection);
+    stopPlaybackLocked(client);
 
-        std::lock_guard<std::mutex> lk(clientsMutex_);
-        auto it = clients_.find(dwConnID);
-        if (it != clients_.end()) 
-        {
-            it->second.isPublisher = (role == "PUBLISHER"); //若为PUBLISHER则存true，否则存false
-            LOG_INFO("video_manager", "Client ", dwConnID, " role updated -> ", role);
+    client.isPublisher = declaration.publisher; //若为PUBLISHER则存true，否则存false
+    if (client.isPublisher) {
+        client.subscriber.reset();  // 推流端不接收视频
+        rebuildSubscribersLocked();
+
+        // 每路流只有一个推流端，两路推流交错在一起就花屏了
+        auto stream = streamLocked(names.front());
+        if (stream->publisher != 0) {
+            LOG_WARN("video_manager", "Stream ", stream->name, " already has publisher ", stream->publisher,
+                     ", rejecting client ", id);
+            connection.rejected = true;
+            releaseStreamLocked(stream);
+            return;
+        }
+        stream->publisher = id;
+        stream->publishingSince = std::chrono::steady_clock::now().time_since_epoch().count();
+        connection.publishing = std::move(stream);
+    } else if (multicast_ && std::find(declaration.options.begin(), declaration.options.end(), kMulticastOption) !=
+                                 declaration.options.end() && multicastReadyLocked(names)) {
+        // 组播订阅端：TCP 上只收一行各路流的组播地址，视频从组播组接收；仍计入订阅数，流（端口）保持不变
+        client.subscriber.reset();
+        rebuildSubscribersLocked();
+        std::string line = "MULTICAST";
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            auto stream = streamLocked(names[i]);
+            line += (i == 0 ? " " : ",") + stream->name + "=" + multicast_->address(*stream->multicast);
+            joinLocked(client, stream);
+        }
+        line += "\n";
+        sender->send(id, reinterpret_cast<const uint8_t*>(line.data()), line.size());
+    } else {
+        if (!client.subscriber) {
+            client.subscriber = std::make_shared<VideoSubscriber>(
+                id, sender, config_.subscriberQueuePackets,
+                static_cast<std::size_t>(config_.maxPendingKb) * 1024, dropPolicy_);
+        }
+        client.subscriber->setFramedOutput(declaration.framed);
+        rebuildSubscribersLocked();
+
+        std::vector<std::shared_ptr<VideoStream>> streams;
+        for (const auto& name : names) {
+            streams.push_back(streamLocked(name));
+        }
+        if (declaration.framed) {
+            // 分帧订阅端先收到一行流名与编号的对应关系，之后帧头的 streamId 就是流编号
+            std::string line = "STREAMS";
+            for (std::size_t i = 0; i < streams.size(); ++i) {
+                line += (i == 0 ? " " : ",") + streams[i]->name + "=" + std::to_string(streams[i]->number);
+            }
+            line += "\n";
+            sender->send(id, reinterpret_cast<const uint8_t*>(line.data()), line.size());
+        }
+        for (const auto& stream : streams) {
+            joinLocked(client, stream);
+        }
+        client.subscriber->drain();
+    }
+    std::string streamList;
+    for (const auto& name : names) {
+        streamList += (streamList.empty() ? "" : ",") + name;
+    }
+    LOG_INFO("video_manager", "Client ", id, " role updated -> ", declaration.role,
+             declaration.framed ? " (framed)" : "", " streams: ", streamList);
+}
+
+void VideoManager::startPlayback(network::TcpServer* sender, network::ConnectionId id, VideoConnection& connection, const RoleDeclaration& declaration) {
+    // 选项：流名、起始毫秒、可选的结束毫秒
+    const auto& options = declaration.options;
+    uint64_t fromMs = 0;
+    uint64_t toMs = UINT64_MAX / 1000;
+    bool valid = recorder_ != nullptr && (options.size() == 2 || options.size() == 3);
+    try {
+        if (valid) {
+            fromMs = std::stoull(options[1]);
+            if (options.size() == 3) {
+                toMs = std::stoull(options[2]);
+            }
+            valid = fromMs <= toMs;
         }
-        return HR_OK;
+    } catch (const std::exception&) {
+        valid = false;
+    }
+    if (!valid) {
+        LOG_WARN("video_manager", "Rejecting playback request from client ", id,
+                 recorder_ ? ": expected <stream> <fromMs> [toMs]" : ": recording is disabled");
+        connection.rejected = true;
+        return;
     }
 
-    // 检查该连接是否是推流端
+    const std::string& name = options[0];
+    auto segments = recorder_->segments(name, fromMs * 1000, toMs * 1000);
+    std::shared_ptr<VideoPlayback> playback;
     {
         std::lock_guard<std::mutex> lk(clientsMutex_);
-        //视频客户端连接中有dwConnID，但不是推送端，则不推送数据，直接返回
-        if (auto it = clients_.find(dwConnID); it != clients_.end() && !it->second.isPublisher) 
+        auto it = clients_.find(id);
+        if (it == clients_.end()) {
+            return;
+        }
+        VideoClient& client = it->second;
+        leaveAllLocked(client);
+        stopPublishingLocked(connection);
+        stopPlaybackLocked(client);
+        client.isPublisher = false;
+        client.subscriber.reset();
+        rebuildSubscribersLocked();
+
+        client.playback = std::make_shared<VideoPlayback>(
+            id, sender, static_cast<std::size_t>(config_.maxPendingKb) * 1024, declaration.framed,
+            segments, fromMs * 1000, toMs * 1000);
+        playback = client.playback;
+        playbackSessions_.set(static_cast<int64_t>(++playbackCount_));
+    }
+    LOG_INFO("video_manager", "Client ", id, " playing back stream ", name, " from ", fromMs,
+             declaration.framed ? " (framed), " : ", ", segments.size(), " segments");
+    playback->pump();   // 在锁外发送
+}
+
+void VideoManager::stopPlaybackLocked(VideoClient& client) {
+    if (client.playback) {
+        client.playback.reset();
+        playbackSessions_.set(static_cast<int64_t>(--playbackCount_));
+    }
+}
+
+std::shared_ptr<VideoStream> VideoManager::streamLocked(const std::string& name) {
+    auto it = streams_.find(name);
+    if (it != streams_.end()) {
+        return it->second;
+    }
+
+    const uint16_t number = nextStreamNumber_;
+    nextStreamNumber_ = nextStreamNumber_ == UINT16_MAX ? 1 : nextStreamNumber_ + 1;
+    const std::size_t worker = std::hash<std::string>{}(name) % workers_.size();
+    auto stream = std::make_shared<VideoStream>(name, number, worker, gopFrames_,
+                                                static_cast<std::size_t>(config_.gopCacheKb) * 1024);
+    if (multicast_) {
+        stream->multicast = multicast_->open(number);
+    }
+    streams_.emplace(name, stream);
+    streamCount_.set(static_cast<int64_t>(streams_.size()));
+    LOG_INFO("video_manager", "Stream ", name, " created (#", number, ", relay worker ", worker, ")");
+    return stream;
+}
+
+bool VideoManager::multicastReadyLocked(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+        auto stream = streamLocked(name);
+        if (!stream->multicast) {
+            LOG_WARN("video_manager", "Stream ", name, " has no multicast port, subscriber falls back to TCP");
+            return false;   // 下面按 TCP 订阅端处理，已创建的流由它加入
+        }
+    }
+    return true;
+}
+
+void VideoManager::releaseStreamLocked(const std::shared_ptr<VideoStream>& stream) {
+    if (stream->publisher == 0 && stream->subscriberCount == 0) {
+        streams_.erase(stream->name);     // 转发队列里还没处理的帧仍持有这路流，处理完自动释放
+        streamCount_.set(static_cast<int64_t>(streams_.size()));
+    }
+}
+
+void VideoManager::joinLocked(VideoClient& client, const std::shared_ptr<VideoStream>& stream) {
+    std::size_t primed = 0;
+    if (client.subscriber) {    // 组播订阅端只计数，不进快照
+        std::lock_guard<std::mutex> lk(stream->mutex);
+        // 新订阅端先收到缓存的配置帧和最近一个 GOP（共享缓冲区，只加引用计数）
+        stream->gop.forEach([&](const VideoPacket& packet) {
+            std::size_t dropped = 0;
+            client.subscriber->enqueue(packet, dropped);
+            ++primed;
+        });
+        auto next = std::make_shared<SubscriberMap>(*stream->subscribers);
+        next->emplace(client.id, client.subscriber);
+        stream->subscribers = std::move(next);
+    }
+    ++stream->subscriberCount;
+    client.subscribed.push_back(stream);
+    gopPrimedFrames_.inc(primed);
+}
+
+void VideoManager::leaveAllLocked(VideoClient& client) {
+    for (const auto& stream : client.subscribed) {
         {
-            LOG_WARN("video_manager", "Subscriber ", dwConnID, " attempted to push data. Ignored.");
-            return HR_OK;
+            std::lock_guard<std::mutex> lk(stream->mutex);
+            auto next = std::make_shared<SubscriberMap>(*stream->subscribers);
+            next->erase(client.id);
+            stream->subscribers = std::move(next);
         }
+        --stream->subscriberCount;
+        releaseStreamLocked(stream);
     }
+    client.subscribed.clear();
+}
 
-    // 这是推流端发来的视频数据 → 入队（将视频数据存入视频数据结构中的data）
-    VideoPacket pkt;
-    pkt.data.assign(pData, pData + iLength);
-    pkt.timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
-    //入队
+void VideoManager::stopPublishingLocked(VideoConnection& connection) {
+    if (!connection.publishing) {
+        return;
+    }
+    auto stream = std::move(connection.publishing);
+    connection.publishing.reset();
+    stream->publisher = 0;
     {
-        std::lock_guard<std::mutex> lk(queueMutex_);
-        packetQueue_.push(pkt);
+        // 推流端断开：它的 GOP 已经过时，不再拿来预填新订阅端
+        std::lock_guard<std::mutex> lk(stream->mutex);
+        stream->gop.clear();
     }
+    releaseStreamLocked(stream);
+}
 
-    //唤醒转发线程
-    queueCv_.notify_one();
+void VideoManager::onSend(network::TcpServer&, network::ConnectionId dwConnID, std::size_t) {
+    // 连接的发送缓冲区有空间了，继续发队列里积压的包
+    const auto snapshot = subscribers();
+    if (auto it = snapshot->find(dwConnID); it != snapshot->end()) {
+        it->second->drain();
+        return;
+    }
 
-    return HR_OK;
+    // 回放连接：接着从录像段发
+    if (playbackCount_.load(std::memory_order_relaxed) != 0) {
+        std::shared_ptr<VideoPlayback> playback;
+        {
+            std::lock_guard<std::mutex> lk(clientsMutex_);
+            if (auto it = clients_.find(dwConnID); it != clients_.end()) {
+                playback = it->second.playback;
+            }
+        }
+        if (playback) {
+            playback->pump();
+        }
+    }
 }
 
-void VideoManager::relayThreadFunc() {
+void VideoManager::rebuildSubscribersLocked() {
+    auto snapshot = std::make_shared<SubscriberMap>();
+    for (const auto& [id, client] : clients_) {
+        if (client.subscriber) {
+            snapshot->emplace(id, client.subscriber);
+        }
+    }
+    std::atomic_store(&subscribers_, std::shared_ptr<const SubscriberMap>(std::move(snapshot)));
+}
+
+std::vector<SubscriberStats> VideoManager::subscriberStats() const {
+    std::vector<SubscriberStats> result;
+    for (const auto& [id, subscriber] : *subscribers()) {
+        result.push_back(subscriber->stats());
+    }
+    return result;
+}
+
+std::vector<VideoStreamStats> VideoManager::streamStats() const {
+    std::lock_guard<std::mutex> lk(clientsMutex_);
+    std::vector<VideoStreamStats> result;
+    for (const auto& [name, stream] : streams_) {
+        VideoStreamStats stats;
+        stats.name = name;
+        stats.number = stream->number;
+        stats.publisher = stream->publisher;
+        stats.subscribers = stream->subscriberCount;
+        stats.worker = stream->worker;
+        stats.packetsIn = stream->packetsIn.load(std::memory_order_relaxed);
+        stats.bytesIn = stream->bytesIn.load(std::memory_order_relaxed);
+        stats.bytesOut = stream->bytesOut.load(std::memory_order_relaxed);
+        stats.packetRate = stream->packetRate.load(std::memory_order_relaxed);
+        if (const int64_t last = stream->lastPacketAt.load(std::memory_order_relaxed); last != 0) {
+            stats.lastPacketAgeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(last)).count();
+        }
+        {
+            std::lock_guard<std::mutex> streamLock(stream->mutex);
+            stats.gopFrames = stream->gop.frames();
+        }
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+void VideoManager::relayThreadFunc(RelayWorker& worker) {
     // 转发线程主循环
+    RelayItem item;
     while (running_) {
-        std::unique_lock<std::mutex> lk(queueMutex_);
-
-        // 等待队列非空或收到停止信号
-        queueCv_.wait(lk, [this]() { return !packetQueue_.empty() || !running_; }); //后面的lambda表达式是唤醒条件
-        if (!running_) break;
-
-        // 从队列取出一个包
-        VideoPacket pkt = std::move(packetQueue_.front());  //先移动
-        packetQueue_.pop(); //再出队
-        lk.unlock();    // 提前解锁，避免持有锁时发送数据
-
-        // 广播给所有订阅客户端
-        std::lock_guard<std::mutex> lk2(clientsMutex_);
-        for (auto& [id, client] : clients_) {
-            // 只发给订阅端（isPublisher = false）
-            if (!client.isPublisher) {  //如果不是推流端（说明是订阅端）
-                server_->Send(id, pkt.data.data(), static_cast<int>(pkt.data.size()));
+        // 从队列取出一个包（无锁）；队列空了才持锁等待（入队在同一把锁下，不会丢唤醒）
+        if (!worker.queue.tryPop(item)) {
+            std::unique_lock<std::mutex> lk(worker.mutex);
+            worker.cv.wait(lk, [&]() { return worker.queue.sizeApprox() != 0 || !running_; }); //后面的lambda表达式是唤醒条件
+            continue;
+        }
+        worker.depth->set(static_cast<int64_t>(worker.queue.sizeApprox()));
+
+        fanOut(*item.stream, item.packet);
+        item = RelayItem{};     // 及时释放缓冲区引用
+    }
+}
+
+void VideoManager::fanOut(VideoStream& stream, const VideoPacket& pkt) {
+    // 分发给这路流的订阅端：不持有 clientsMutex_，入队只是一次引用计数加一，
+    // 发送受每个连接的待发字节上限约束，慢订阅端只会让自己的队列积压或丢包
+    {
+        monitoring::ScopedLatency latency(fanoutLatency_);
+        // 更新 GOP 缓存和取快照在同一把锁下：新订阅端要么已经从缓存拿到这一帧，要么在快照里
+        std::shared_ptr<const SubscriberMap> snapshot;
+        {
+            std::lock_guard<std::mutex> streamLock(stream.mutex);
+            if (config_.gopCache && pkt.framed()) {
+                stream.gop.add(pkt);
+            }
+            snapshot = stream.subscribers;
+        }
+        if (recorder_) {
+            recorder_->record(stream.name, pkt);    // 一次无锁入队，写盘在录像线程
+        }
+        if (stream.multicast) {
+            multicast_->send(*stream.multicast, pkt);   // 不论有没有局域网观众，组播只发一份
+        }
+        std::size_t delivered = 0;
+        for (const auto& [id, subscriber] : *snapshot) {
+            std::size_t dropped = 0;
+            if (!subscriber->enqueue(pkt, dropped)) {
+                // disconnect 策略：队列满直接断开，onClose 里从注册表删除
+                LOG_WARN("video_manager", "Subscriber ", id, " cannot keep up, disconnecting");
+                slowDisconnects_.inc();
+                server_->disconnect(id);
+                continue;
             }
+            if (dropped != 0) {
+                droppedPackets_.inc(dropped);
+            }
+            subscriber->drain();
+            ++delivered;
         }
+        packetsRelayed_.inc();
+        bytesRelayed_.inc(pkt.data.size() * delivered);
+
+        // 流级计数（健康探针和诊断接口读取，这里不更新健康状态）
+        stream.packetsIn.fetch_add(1, std::memory_order_relaxed);
+        stream.bytesIn.fetch_add(pkt.data.size(), std::memory_order_relaxed);
+        stream.bytesOut.fetch_add(pkt.data.size() * delivered, std::memory_order_relaxed);
+        stream.lastPacketAt.store(pkt.timestamp, std::memory_order_relaxed);
+    }
+    relayLatency_.recordSince(std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(pkt.timestamp)));
+}
 
-        if (healthMonitor_) {
-            healthMonitor_->update("video_manager", true, "Video packet broadcast");
+void VideoManager::sampleHealth(const monitoring::HealthMonitor::Handle& handle) {
+    if (!running_) {
+        handle.update(false, "Not running");
+        return;
+    }
+
+    const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+    const int64_t stallTicks = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::seconds(kStallSeconds)).count();
+    std::size_t streamCount = 0;
+    std::size_t publishers = 0;
+    std::size_t subscriberLinks = 0;
+    uint64_t totalRate = 0;
+    std::string stalled;
+    {
+        std::lock_guard<std::mutex> lk(clientsMutex_);
+        streamCount = streams_.size();
+        for (const auto& [name, stream] : streams_) {
+            const uint64_t packets = stream->packetsIn.load(std::memory_order_relaxed);
+            if (stream->sampledAt != 0 && now > stream->sampledAt) {
+                const uint64_t rate = (packets - stream->sampledPackets) * 1000000000ull /
+                                      static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::duration(now - stream->sampledAt)).count());
+                stream->packetRate.store(rate, std::memory_order_relaxed);
+                totalRate += rate;
+            }
+            stream->sampledPackets = packets;
+            stream->sampledAt = now;
+
+            subscriberLinks += stream->subscriberCount;
+            if (stream->publisher != 0) {
+                ++publishers;
+                // 推流端在线但一直没有数据：从声明角色或最近一帧算起
+                const int64_t since = std::max(stream->publishingSince, stream->lastPacketAt.load(std::memory_order_relaxed));
+                if (stalled.empty() && now - since > stallTicks) {
+                    stalled = name;
+                }
+            }
         }
     }
+
+    int64_t relayQueue = 0;
+    for (const auto& worker : workers_) {
+        relayQueue = std::max(relayQueue, worker->depth->value());
+    }
+    std::size_t subscriberQueue = 0;
+    for (const auto& [id, subscriber] : *subscribers()) {
+        subscriberQueue = std::max(subscriberQueue, subscriber->stats().queued);
+    }
+
+    if (!stalled.empty()) {
+        handle.update(false, "Stream " + stalled + " has no packets for over " + std::to_string(kStallSeconds) + "s");
+        return;
+    }
+    handle.update(true, std::to_string(streamCount) + " streams, " + std::to_string(publishers) + " publishers, " +
+                            std::to_string(subscriberLinks) + " subscriptions, " + std::to_string(totalRate) +
+                            " pkt/s, relay queue " + std::to_string(relayQueue) + ", subscriber queue " +
+                            std::to_string(subscriberQueue));
 }
@@ -4,32 +4,99 @@
 #include <thread>
 #include <atomic>
 #include <condition_variable>
-#include <queue>
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <cstdint>
 #include <unordered_map>
 
-#include "hpsocket/HPSocket.h"  // HPSocket 库
+#include "core/configuration.hpp"
 #include "core/logger.hpp"
+#include "core/mpmc_queue.hpp"
+#include "core/packet_pool.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/metrics.hpp"
+#include "network/tcp_server.hpp"
+#include "services/transport/video_framing.hpp"
+#include "services/transport/video_gop_cache.hpp"
+#include "services/transport/video_multicast.hpp"
+#include "services/transport/video_playback.hpp"
+#include "services/transport/video_recorder.hpp"
+#include "services/transport/video_subscriber.hpp"
 
-// 视频数据包结构
-struct VideoPacket {
-    std::vector<uint8_t> data;  // 视频数据
-    int64_t timestamp;  // 时间戳
+using SubscriberMap = std::unordered_map<network::ConnectionId, std::shared_ptr<VideoSubscriber>>;
+
+// 一路命名视频流：一个推流端，若干订阅端，固定由一个转发线程处理（保证帧序）
+struct VideoStream {
+    VideoStream(std::string streamName, uint16_t streamNumber, std::size_t workerIndex, std::size_t gopFrames, std::size_t gopBytes)
+        : name(std::move(streamName))
+        , number(streamNumber)
+        , worker(workerIndex)
+        , gop(gopFrames, gopBytes)
+        , subscribers(std::make_shared<SubscriberMap>()) {}
+
+    const std::string name;
+    const uint16_t number;      // 流编号（分帧订阅端收到的帧头 streamId）
+    const std::size_t worker;   // 负责这路流的转发线程
+
+    // 以下受 VideoManager::clientsMutex_ 保护
+    network::ConnectionId publisher{0};        // 当前推流连接（0 表示没有）
+    int64_t publishingSince{0}; // 推流端声明的时间（steady_clock 计数）
+    std::size_t subscriberCount{0};
+    uint64_t sampledPackets{0}; // 健康探针上次采样时的 packetsIn
+    int64_t sampledAt{0};
+
+    // 转发统计：fanOut 里累加（同一路流不会并发），健康探针和诊断接口读取
+    std::atomic<uint64_t> packetsIn{0};
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};          // 入队到各订阅端的字节数合计
+    std::atomic<int64_t> lastPacketAt{0};       // 最近一帧的接收时间（steady_clock 计数，0 表示还没有）
+    std::atomic<uint64_t> packetRate{0};        // 最近一个采样周期的包速率（包/秒，健康探针更新）
+
+    // 转发线程在这把锁下更新 GOP 缓存并取订阅端快照；新订阅端在同一把锁下预填并加入，不漏帧也不重帧
+    std::mutex mutex;
+    GopCache gop;
+    std::shared_ptr<const SubscriberMap> subscribers;  // 订阅端快照（写时复制）
+
+    std::shared_ptr<VideoMulticast::Channel> multicast;     // 组播通道（未启用组播或组播端口用完时为空，创建流时设置）
+};
+
+// 流统计（诊断接口使用）
+struct VideoStreamStats {
+    std::string name;
+    uint16_t number{0};
+    network::ConnectionId publisher{0};
+    std::size_t subscribers{0};
+    std::size_t worker{0};
+    std::size_t gopFrames{0};
+    uint64_t packetsIn{0};
+    uint64_t bytesIn{0};
+    uint64_t bytesOut{0};
+    uint64_t packetRate{0};         // 包/秒（健康探针每个周期更新）
+    int64_t lastPacketAgeMs{-1};    // 距最近一帧的毫秒数（-1 表示还没有）
+};
+
+// 连接级状态（挂在传输层连接的 extra 上，接收回调无锁取用；同一连接的接收回调是串行的）
+struct VideoConnection {
+    VideoStreamParser parser;                   // 角色声明/分帧解析
+    std::shared_ptr<VideoStream> publishing;    // 推流端所推的流（为空则收到的数据不转发）
+    bool rejected{false};                       // 声明的流已有推流端，断开
 };
 
 // 视频客户端结构
 struct VideoClient {
-    CONNID id;  // 连接 ID
+    network::ConnectionId id;  // 连接 ID
     bool isPublisher; // 是否是publisher
+    std::shared_ptr<VideoSubscriber> subscriber;    // 订阅端的发送队列（推流端为空）
+    std::unique_ptr<VideoConnection> connection;    // 连接级状态
+    std::vector<std::shared_ptr<VideoStream>> subscribed;   // 订阅的流
+    std::shared_ptr<VideoPlayback> playback;        // 回放会话（回放连接才有）
 };
 
 // 视频中转管理类
-class VideoManager : public CTcpServerListener {
+class VideoManager : public network::TcpServerHandler {
 public:
-    explicit VideoManager(monitoring::HealthMonitor* monitor = nullptr);
+    explicit VideoManager(core::VideoConfig config = {}, monitoring::HealthMonitor* monitor = nullptr);
     ~VideoManager();
 
     // 启动视频服务器
@@ -38,29 +105,122 @@ public:
     // 停止视频服务器
     void stop();
 
-    // 设置健康监控器
-    void setHealthMonitor(monitoring::HealthMonitor* monitor) { healthMonitor_ = monitor; }
+    // 设置健康监控器：登记探针，由监控线程定期根据转发计数器判断健康状态（转发路径不更新健康状态）
+    void setHealthMonitor(monitoring::HealthMonitor* monitor);
+
+    // 各订阅端的队列和发送统计
+    std::vector<SubscriberStats> subscriberStats() const;
+
+    // 各路流的推流端、订阅端个数、所属转发线程和转发计数
+    std::vector<VideoStreamStats> streamStats() const;
 
     // 推流客户端收到数据
-    EnHandleResult OnReceive(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override;
+    network::HandleResult onReceive(network::TcpServer& pSender, network::ConnectionId dwConnID, const uint8_t* pData, std::size_t iLength) override;
     // 客户端连接/断开
-    EnHandleResult OnAccept(ITcpServer* pSender, CONNID dwConnID, UINT_PTR soClient) override;
-    EnHandleResult OnClose(ITcpServer* pSender, CONNID dwConnID, EnSocketOperation enOperation, int iErrorCode) override;
+    network::HandleResult onAccept(network::TcpServer& pSender, network::ConnectionId dwConnID) override;
+    void onClose(network::TcpServer& pSender, network::ConnectionId dwConnID, int iErrorCode) override;
+    // 数据已发出：继续发该订阅端队列里积压的包
+    void onSend(network::TcpServer& pSender, network::ConnectionId dwConnID, std::size_t iLength) override;
+
+    static constexpr const char* kDefaultStream = "default";   // 不声明流名的客户端都在这一路
 
 private:
+    // 待转发的一帧（或一个原始数据块）
+    struct RelayItem {
+        std::shared_ptr<VideoStream> stream;
+        VideoPacket packet;
+    };
+
+    // 转发线程：每个线程一个有界队列（relayQueuePackets），流按名字哈希固定分给其中一个
+    // 推流比转发快时丢弃新到的包并计数，积压不会无限占内存
+    struct RelayWorker {
+        explicit RelayWorker(std::size_t capacity) : queue(capacity) {}
+
+        std::mutex mutex;   // 入队和等待时持有（配合 cv，不丢唤醒）
+        std::condition_variable cv;     // 队列非空通知（条件变量）
+        core::BoundedMpmcQueue<RelayItem> queue;    // 数据包队列
+        std::thread thread;
+        monitoring::Gauge* depth{nullptr};
+    };
+
     // 后台转发线程
-    void relayThreadFunc();
+    void relayThreadFunc(RelayWorker& worker);
+
+    // 把一帧分发给这路流的所有订阅端（转发线程或直接分发模式下的接收回调调用；同一路流不会并发调用）
+    void fanOut(VideoStream& stream, const VideoPacket& pkt);
+
+    // 应用连接的角色声明（推流端不收视频；分帧订阅端收带帧头的整帧）
+    void applyRole(network::TcpServer* sender, network::ConnectionId id, VideoConnection& connection, const RoleDeclaration& declaration);
+
+    // "ROLE:PLAYBACK <流名> <起始 Unix 毫秒> [结束 Unix 毫秒] [FRAMED]"：退出直播，改为从录像回放
+    void startPlayback(network::TcpServer* sender, network::ConnectionId id, VideoConnection& connection, const RoleDeclaration& declaration);
+
+    // 以下在 clientsMutex_ 下调用
+    std::shared_ptr<VideoStream> streamLocked(const std::string& name);     // 取流，不存在则创建
+    void releaseStreamLocked(const std::shared_ptr<VideoStream>& stream);   // 没有推流端和订阅端时移除
+    bool multicastReadyLocked(const std::vector<std::string>& names);      // 这些流都有组播端口（没有的流会被创建）
+    void joinLocked(VideoClient& client, const std::shared_ptr<VideoStream>& stream);
+    void leaveAllLocked(VideoClient& client);
+    void stopPublishingLocked(VideoConnection& connection);
+    void stopPlaybackLocked(VideoClient& client);
+
+    // 健康探针：采样各路流的包速率，推流端超过 kStallSeconds 没有数据时报告异常
+    void sampleHealth(const monitoring::HealthMonitor::Handle& handle);
+
+    // 在 clientsMutex_ 下重建全体订阅端快照（onSend 和统计使用）
+    void rebuildSubscribersLocked();
+
+    // 读取当前订阅端快照（无需持有 clientsMutex_）
+    std::shared_ptr<const SubscriberMap> subscribers() const { return std::atomic_load(&subscribers_); }
 
 private:
-    CTcpServerPtr server_;  // 构造的时候传的是自己（this）
-    std::thread relayThread_;   // 转发线程
+    core::PacketPool packetPool_;   // 数据包缓冲区池（必须在所有持有 VideoPacket 的成员之前声明）
+    std::unique_ptr<network::TcpServer> server_;  // 传输层服务器（按 config_.transport 创建，回调传的是自己）
     std::atomic<bool> running_{false};  // 运行标志
 
-    std::mutex clientsMutex_;   // 保护 clients_
-    std::unordered_map<CONNID, VideoClient> clients_;   // 连接到视频服务器的客户端（连接 ID → 客户端信息）
+    core::VideoConfig config_;
+    DropPolicy dropPolicy_{DropPolicy::DropOldest};
+    std::size_t gopFrames_{0};      // GOP 缓存帧数上限
+
+    mutable std::mutex clientsMutex_;   // 保护 clients_、streams_ 和订阅端快照的重建
+    std::unordered_map<network::ConnectionId, VideoClient> clients_;   // 连接到视频服务器的客户端（连接 ID → 客户端信息）
+    std::unordered_map<std::string, std::shared_ptr<VideoStream>> streams_;    // 流名 → 流
+    uint16_t nextStreamNumber_{1};
+    std::shared_ptr<const SubscriberMap> subscribers_;  // 订阅端快照（写时复制，发送回调无锁读取）
+    std::atomic<std::size_t> playbackCount_{0};     // 回放会话数（为 0 时发送回调不查 clients_）
+
+    std::unique_ptr<VideoRecorder> recorder_;       // 录像（未启用时为空）
+    std::unique_ptr<VideoMulticast> multicast_;     // 组播出口（未启用或启动失败时为空）
+
+    std::vector<std::unique_ptr<RelayWorker>> workers_;     // 转发线程池
+    monitoring::HealthMonitor* monitor_{nullptr};   // 健康监控（未设置时为空）
+    std::size_t probeId_{0};
+
+    static constexpr int64_t kStallSeconds = 10;    // 推流端多久没有数据视为中断
 
-    std::mutex queueMutex_; // 保护数据包队列
-    std::condition_variable queueCv_;   // 队列非空通知（条件变量）
-    std::queue<VideoPacket> packetQueue_;   // 数据包队列（存视频数据包结构）
-    monitoring::HealthMonitor* healthMonitor_{nullptr}; //健康监控
+    // 指标
+    monitoring::Histogram& relayLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_video_relay_seconds", "Time from packet receipt to fan-out completion");
+    monitoring::Histogram& fanoutLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_video_fanout_seconds", "Time spent sending one packet to all subscribers");
+    monitoring::Counter& packetsRelayed_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_packets_total", "Video packets relayed");
+    monitoring::Counter& bytesRelayed_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_bytes_total", "Video bytes queued to subscribers");
+    monitoring::Gauge& clientCount_ = monitoring::MetricsRegistry::instance().gauge(
+        "aqua_video_clients", "Connected video clients");
+    monitoring::Gauge& streamCount_ = monitoring::MetricsRegistry::instance().gauge(
+        "aqua_video_streams", "Named video streams with a publisher or subscribers");
+    monitoring::Counter& relayDropped_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_relay_dropped_total", "Video packets dropped because a relay worker queue was full");
+    monitoring::Counter& droppedPackets_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_dropped_packets_total", "Video packets dropped because a subscriber queue was full");
+    monitoring::Counter& slowDisconnects_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_slow_disconnects_total", "Subscribers disconnected by the disconnect drop policy");
+    monitoring::Counter& gopPrimedFrames_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_gop_primed_frames_total", "Cached frames sent to new subscribers on join");
+    monitoring::Gauge& playbackSessions_ = monitoring::MetricsRegistry::instance().gauge(
+        "aqua_video_playback_sessions", "Connections playing back recorded video");
+    monitoring::Counter& protocolErrors_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_protocol_errors_total", "Video connections closed because of malformed role lines or frames");
 };
@@ -0,0 +1,316 @@
+#include "services/transport/video_multicast.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <ifaddrs.h>
+
+#include "core/logger.hpp"
+
+namespace {
+
+// 接收时间（steady_clock 纳秒）换算成 90kHz 的 RTP 时间戳
+uint32_t rtpTimestamp(int64_t steadyTicks) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::duration(steadyTicks)).count();
+    return static_cast<uint32_t>(static_cast<uint64_t>(ns) / 100000 * 9);
+}
+
+} // namespace
+
+VideoMulticast::VideoMulticast(core::VideoMulticastConfig config)
+    : config_(std::move(config))
+    , payloadBytes_(std::max<std::size_t>(config_.mtu, video_rtp::kHeaderBytes + 2 * video_framing::kHeaderBytes) -
+                    video_rtp::kHeaderBytes) {}
+
+VideoMulticast::~VideoMulticast() {
+    stop();
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool VideoMulticast::start() {
+    if (fd_ >= 0) {
+        return false;   // 只启动一次
+    }
+    if (::inet_pton(AF_INET, config_.group.c_str(), &group_) != 1 || !IN_MULTICAST(ntohl(group_.s_addr))) {
+        LOG_ERROR("video_multicast", "Invalid multicast group ", config_.group);
+        return false;
+    }
+
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        LOG_ERROR("video_multicast", "socket failed: ", std::strerror(errno));
+        return false;
+    }
+    // 组播从这个端口发出，接收端的 NACK 回到同一个端口
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(config_.nackPort);
+    const unsigned char ttl = static_cast<unsigned char>(std::min<uint32_t>(config_.ttl, 255));
+    const unsigned char loop = config_.loopback ? 1 : 0;
+    const int sendBuffer = 4 * 1024 * 1024;
+    bool ok = ::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) == 0 &&
+              ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) == 0 &&
+              ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) == 0;
+    ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    if (ok && !config_.interfaceAddress.empty()) {
+        in_addr interface{};
+        ok = ::inet_pton(AF_INET, config_.interfaceAddress.c_str(), &interface) == 1 &&
+             ::setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) == 0;
+    }
+    if (!ok) {
+        LOG_ERROR("video_multicast", "Failed to set up multicast socket: ", std::strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    loadSubnets();
+    running_ = true;
+    thread_ = std::thread(&VideoMulticast::nackLoop, this);
+    LOG_INFO("video_multicast", "Multicast egress on ", config_.group, " ports from ", config_.basePort,
+             " (mtu ", config_.mtu, ", retransmit window ", config_.retransmitPackets, ")");
+    return true;
+}
+
+void VideoMulticast::loadSubnets() {
+    // 指定了发送网卡就只接受该网卡所在网段，否则接受本机所有 IPv4 网卡的网段
+    in_addr interface{};
+    const bool specific = !config_.interfaceAddress.empty() && ::inet_pton(AF_INET, config_.interfaceAddress.c_str(), &interface) == 1;
+    subnets_.clear();
+    ifaddrs* addresses = nullptr;
+    if (::getifaddrs(&addresses) != 0) {
+        LOG_WARN("video_multicast", "getifaddrs failed, NACKs will be ignored: ", std::strerror(errno));
+        return;
+    }
+    for (const ifaddrs* it = addresses; it != nullptr; it = it->ifa_next) {
+        if (it->ifa_addr == nullptr || it->ifa_netmask == nullptr || it->ifa_addr->sa_family != AF_INET) {
+            continue;
+        }
+        const uint32_t address = reinterpret_cast<const sockaddr_in*>(it->ifa_addr)->sin_addr.s_addr;
+        const uint32_t mask = reinterpret_cast<const sockaddr_in*>(it->ifa_netmask)->sin_addr.s_addr;
+        if (!specific || address == interface.s_addr) {
+            subnets_.emplace_back(address & mask, mask);
+        }
+    }
+    ::freeifaddrs(addresses);
+    if (subnets_.empty()) {
+        LOG_WARN("video_multicast", "No local subnet matches ", config_.interfaceAddress, ", NACKs will be ignored");
+    }
+}
+
+bool VideoMulticast::allowedSource(const in_addr& address) const {
+    return std::any_of(subnets_.begin(), subnets_.end(), [&](const std::pair<uint32_t, uint32_t>& subnet) {
+        return (address.s_addr & subnet.second) == subnet.first;
+    });
+}
+
+std::size_t VideoMulticast::takeBudget(const in_addr& address, std::size_t wanted) {
+    const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    const double rate = static_cast<double>(config_.nackRatePackets);
+
+    // 长时间没发 NACK 的地址不再占表项
+    if (buckets_.size() > 1024) {
+        for (auto it = buckets_.begin(); it != buckets_.end();) {
+            it = now - it->second.refilledAt > 10000 ? buckets_.erase(it) : std::next(it);
+        }
+    }
+
+    auto [it, inserted] = buckets_.try_emplace(address.s_addr);
+    Bucket& bucket = it->second;
+    if (inserted) {
+        bucket.tokens = rate;   // 桶容量为一秒的配额
+    } else {
+        bucket.tokens = std::min(rate, bucket.tokens + rate * static_cast<double>(now - bucket.refilledAt) / 1000.0);
+    }
+    bucket.refilledAt = now;
+    const auto granted = std::min(wanted, static_cast<std::size_t>(bucket.tokens));
+    bucket.tokens -= static_cast<double>(granted);
+    return granted;
+}
+
+void VideoMulticast::stop() {
+    // 套接字留到析构再关：转发路径可能同时在 send，关掉的描述符号还会被别的连接复用
+    if (running_.exchange(false) && thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+std::shared_ptr<VideoMulticast::Channel> VideoMulticast::open(uint16_t number) {
+    std::lock_guard<std::mutex> lk(channelsMutex_);
+    std::array<bool, video_rtp::kPortSlots> used{};
+    for (auto it = channels_.begin(); it != channels_.end();) {
+        if (auto live = it->second.lock()) {
+            used[live->slot] = true;
+            ++it;
+        } else {
+            it = channels_.erase(it);
+        }
+    }
+    // 通常拿到的就是流编号对应的槽，端口和编号的对应关系跟以前一样；只有撞上还活着的流才顺延
+    const auto preferred = static_cast<uint16_t>((number == 0 ? 0 : number - 1) % video_rtp::kPortSlots);
+    uint16_t slot = preferred;
+    while (used[slot]) {
+        slot = static_cast<uint16_t>((slot + 1) % video_rtp::kPortSlots);
+        if (slot == preferred) {
+            LOG_WARN("video_multicast", "All ", video_rtp::kPortSlots, " multicast ports in use, stream #", number, " is TCP only");
+            return nullptr;
+        }
+    }
+
+    sockaddr_in destination{};
+    destination.sin_family = AF_INET;
+    destination.sin_addr = group_;
+    destination.sin_port = htons(video_rtp::slotPort(config_.basePort, slot));
+
+    // 起始序号随机（RTP 惯例），重开的流不会和接收端记住的旧序号混在一起
+    static std::atomic<uint32_t> seed{static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count())};
+    const auto first = static_cast<uint16_t>(seed.fetch_add(0x9e37, std::memory_order_relaxed) * 2654435761u >> 16);
+    auto channel = std::make_shared<Channel>(number, slot, destination, std::max<std::size_t>(config_.retransmitPackets, 64), first);
+    channels_[number] = channel;
+    return channel;
+}
+
+std::string VideoMulticast::address(const Channel& channel) const {
+    return config_.group + ":" + std::to_string(ntohs(channel.destination.sin_port));
+}
+
+void VideoMulticast::send(Channel& channel, const VideoPacket& packet) {
+    if (!running_.load(std::memory_order_acquire)) {
+        return;     // 没启动或已停止（fd_ 只在 start 里设置，析构时才关）
+    }
+    // 原始数据块补一个帧头，接收端统一按帧重组
+    const std::size_t synthesized = packet.framed() ? 0 : video_framing::kHeaderBytes;
+    const std::size_t frameBytes = synthesized + packet.data.size();
+    const std::size_t fragments = (frameBytes + payloadBytes_ - 1) / payloadBytes_;
+    const uint32_t timestamp = rtpTimestamp(packet.timestamp);
+
+    std::lock_guard<std::mutex> lk(channel.mutex);
+    channel.iov.resize(fragments * 2);
+    channel.messages.resize(fragments);
+    std::size_t position = 0;   // 在帧（含补的帧头）里的偏移
+    for (std::size_t i = 0; i < fragments; ++i) {
+        const std::size_t chunk = std::min(payloadBytes_, frameBytes - position);
+        auto& entry = channel.window[channel.nextSequence % channel.window.size()];
+        entry.valid = true;
+        entry.sequence = channel.nextSequence++;
+        entry.packet = packet;
+        video_rtp::encodeHeader({i + 1 == fragments, entry.sequence, timestamp, channel.number}, entry.prefix.data());
+        entry.prefixBytes = video_rtp::kHeaderBytes;
+        if (position < synthesized) {
+            video_framing::FrameHeader header;
+            header.streamId = channel.number;
+            header.length = static_cast<uint32_t>(packet.data.size());
+            video_framing::encodeHeader(header, entry.prefix.data() + video_rtp::kHeaderBytes);
+            entry.prefixBytes += synthesized;
+            entry.offset = 0;
+            entry.length = chunk - synthesized;
+        } else {
+            entry.offset = position - synthesized;
+            entry.length = chunk;
+        }
+        position += chunk;
+
+        channel.iov[2 * i] = iovec{entry.prefix.data(), entry.prefixBytes};
+        channel.iov[2 * i + 1] = iovec{const_cast<uint8_t*>(packet.data.data()) + entry.offset, entry.length};
+        msghdr& header = channel.messages[i].msg_hdr;
+        header = msghdr{};
+        header.msg_name = const_cast<sockaddr_in*>(&channel.destination);
+        header.msg_namelen = sizeof(channel.destination);
+        header.msg_iov = &channel.iov[2 * i];
+        header.msg_iovlen = 2;
+    }
+
+    // 一次系统调用发出整帧；套接字缓冲区满时剩下的报文不发（接收端可以 NACK 要回来）
+    std::size_t sent = 0;
+    while (sent < fragments) {
+        const int n = ::sendmmsg(fd_, channel.messages.data() + sent, static_cast<unsigned>(fragments - sent), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            sendErrors_.inc(fragments - sent);
+            break;
+        }
+        sent += static_cast<std::size_t>(n);
+    }
+    datagrams_.inc(sent);
+    bytes_.inc(frameBytes + sent * video_rtp::kHeaderBytes);
+}
+
+void VideoMulticast::nackLoop() {
+    uint8_t buffer[2048];
+    std::vector<uint16_t> lost;
+    while (running_) {
+        pollfd pfd{fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        while (true) {
+            sockaddr_in from{};
+            socklen_t fromLength = sizeof(from);
+            const ssize_t n = ::recvfrom(fd_, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from), &fromLength);
+            if (n <= 0) {
+                break;
+            }
+            uint16_t number = 0;
+            if (!video_rtp::decodeNack(buffer, static_cast<std::size_t>(n), number, lost)) {
+                continue;
+            }
+            nacks_.inc();
+            if (!allowedSource(from.sin_addr)) {
+                nackRejected_.inc();
+                continue;
+            }
+            std::shared_ptr<Channel> channel;
+            {
+                std::lock_guard<std::mutex> lk(channelsMutex_);
+                if (auto it = channels_.find(number); it != channels_.end()) {
+                    channel = it->second.lock();
+                }
+            }
+            if (channel) {
+                // 先按令牌桶扣配额，发不出去的（窗口外的序号）退回
+                const std::size_t budget = takeBudget(from.sin_addr, lost.size());
+                if (budget < lost.size()) {
+                    retransmitThrottled_.inc(lost.size() - budget);
+                }
+                const std::size_t used = retransmit(*channel, lost, from, budget);
+                buckets_[from.sin_addr.s_addr].tokens += static_cast<double>(budget - used);
+            }
+        }
+    }
+}
+
+std::size_t VideoMulticast::retransmit(Channel& channel, const std::vector<uint16_t>& lost, const sockaddr_in& to, std::size_t budget) {
+    // 单播重传给请求方，其他接收端不受影响；最多发 budget 个，返回实际发出的个数
+    std::lock_guard<std::mutex> lk(channel.mutex);
+    std::size_t used = 0;
+    for (const uint16_t sequence : lost) {
+        if (used == budget) {
+            break;
+        }
+        const auto& entry = channel.window[sequence % channel.window.size()];
+        if (!entry.valid || entry.sequence != sequence) {
+            retransmitMisses_.inc();
+            continue;
+        }
+        iovec iov[2] = {{const_cast<uint8_t*>(entry.prefix.data()), entry.prefixBytes},
+                        {const_cast<uint8_t*>(entry.packet.data.data()) + entry.offset, entry.length}};
+        msghdr header{};
+        header.msg_name = const_cast<sockaddr_in*>(&to);
+        header.msg_namelen = sizeof(to);
+        header.msg_iov = iov;
+        header.msg_iovlen = 2;
+        ++used;
+        if (::sendmsg(fd_, &header, 0) > 0) {
+            retransmits_.inc();
+        } else {
+            sendErrors_.inc();
+        }
+    }
+    return used;
+}
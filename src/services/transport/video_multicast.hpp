@@ -0,0 +1,484 @@
+// 视频组播出口：每路流一个组播端口，局域网订阅端加入组播组，服务端出口流量不再随观看人数增长
+// 每帧按 20 字节帧头 + 负载（原始数据块补 flags 为 0 的帧头）切成不超过 mtu 的 UDP 报文，每个报文带 12 字节 RTP 头：
+//   V=2 | M（帧的最后一个报文）| PT=96 | 序号 u16 | 时间戳 u32（90kHz，取自接收时间）| SSRC u32（流编号）
+// 可重传窗口直接引用转发用的共享缓冲区（不拷贝），接收端发现缺号时向发送端口发 NACK，服务端单播重传给它：
+//   NACK = magic u16 "NK" | 流编号 u16 | 若干 {起始序号 u16, 后续 16 个序号的位图 u16}（同 RTCP generic NACK 的 FCI）
+// NACK 没有认证、源地址可以伪造：只响应发送网卡所在网段的地址，且每个地址每秒最多重传 nackRatePackets 个报文
+// 订阅端声明 "ROLE:SUBSCRIBER cam1 MULTICAST\n" 时先收到 "MULTICAST cam1=239.255.42.1:5006\n"，之后 TCP 上不再收视频
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/configuration.hpp"
+#include "monitoring/metrics.hpp"
+#include "services/transport/video_framing.hpp"
+
+namespace video_rtp {
+
+inline constexpr std::size_t kHeaderBytes = 12;
+inline constexpr uint8_t kVersion = 2;
+inline constexpr uint8_t kPayloadType = 96;         // 动态负载类型
+inline constexpr uint16_t kNackMagic = 0x4e4b;      // "NK"
+inline constexpr std::size_t kMaxNackEntries = 64;  // 一个 NACK 报文最多带的 {起始序号, 位图} 个数
+inline constexpr uint16_t kPortSlots = 256;         // 端口槽数：同时开组播的流最多这么多路
+
+struct RtpHeader {
+    bool marker{false};
+    uint16_t sequence{0};
+    uint32_t timestamp{0};
+    uint32_t ssrc{0};
+};
+
+inline void encodeHeader(const RtpHeader& header, uint8_t* out) {
+    out[0] = static_cast<uint8_t>(kVersion << 6);
+    out[1] = static_cast<uint8_t>((header.marker ? 0x80 : 0) | kPayloadType);
+    out[2] = static_cast<uint8_t>(header.sequence >> 8);
+    out[3] = static_cast<uint8_t>(header.sequence);
+    for (int i = 0; i < 4; ++i) {
+        out[4 + i] = static_cast<uint8_t>(header.timestamp >> (24 - 8 * i));
+        out[8 + i] = static_cast<uint8_t>(header.ssrc >> (24 - 8 * i));
+    }
+}
+
+inline bool decodeHeader(const uint8_t* in, std::size_t size, RtpHeader& header) {
+    if (size < kHeaderBytes || (in[0] >> 6) != kVersion || (in[1] & 0x7f) != kPayloadType) {
+        return false;
+    }
+    header.marker = (in[1] & 0x80) != 0;
+    header.sequence = static_cast<uint16_t>((in[2] << 8) | in[3]);
+    header.timestamp = 0;
+    header.ssrc = 0;
+    for (int i = 0; i < 4; ++i) {
+        header.timestamp = (header.timestamp << 8) | in[4 + i];
+        header.ssrc = (header.ssrc << 8) | in[8 + i];
+    }
+    return true;
+}
+
+// 缺失序号编码成 NACK（输入按到达顺序即可），返回字节数
+inline std::size_t encodeNack(uint16_t stream, const std::vector<uint16_t>& lost, uint8_t* out, std::size_t capacity) {
+    if (capacity < 4) {
+        return 0;
+    }
+    out[0] = static_cast<uint8_t>(kNackMagic >> 8);
+    out[1] = static_cast<uint8_t>(kNackMagic);
+    out[2] = static_cast<uint8_t>(stream >> 8);
+    out[3] = static_cast<uint8_t>(stream);
+    std::size_t size = 4;
+    std::size_t i = 0;
+    while (i < lost.size() && size + 4 <= capacity) {
+        const uint16_t pid = lost[i++];
+        uint16_t blp = 0;
+        while (i < lost.size()) {
+            const uint16_t delta = static_cast<uint16_t>(lost[i] - pid);
+            if (delta == 0 || delta > 16) {
+                break;
+            }
+            blp = static_cast<uint16_t>(blp | (1u << (delta - 1)));
+            ++i;
+        }
+        out[size++] = static_cast<uint8_t>(pid >> 8);
+        out[size++] = static_cast<uint8_t>(pid);
+        out[size++] = static_cast<uint8_t>(blp >> 8);
+        out[size++] = static_cast<uint8_t>(blp);
+    }
+    return size;
+}
+
+inline bool decodeNack(const uint8_t* in, std::size_t size, uint16_t& stream, std::vector<uint16_t>& lost) {
+    if (size < 8 || (size - 4) % 4 != 0 || ((in[0] << 8) | in[1]) != kNackMagic) {
+        return false;
+    }
+    stream = static_cast<uint16_t>((in[2] << 8) | in[3]);
+    lost.clear();
+    for (std::size_t pos = 4; pos + 4 <= size && lost.size() < kMaxNackEntries * 17; pos += 4) {
+        const uint16_t pid = static_cast<uint16_t>((in[pos] << 8) | in[pos + 1]);
+        const uint16_t blp = static_cast<uint16_t>((in[pos + 2] << 8) | in[pos + 3]);
+        lost.push_back(pid);
+        for (int bit = 0; bit < 16; ++bit) {
+            if (blp & (1u << bit)) {
+                lost.push_back(static_cast<uint16_t>(pid + bit + 1));
+            }
+        }
+    }
+    return true;
+}
+
+// 端口槽对应的组播端口（按 RTP 惯例用偶数端口）
+inline uint16_t slotPort(uint16_t basePort, uint16_t slot) {
+    return static_cast<uint16_t>(basePort + 2 * (slot % kPortSlots));
+}
+
+} // namespace video_rtp
+
+class VideoMulticast {
+public:
+    // 一路流的组播通道：序号和可重传窗口（由 VideoStream 持有；发送只在这路流的转发线程，重传在 NACK 线程，互斥访问）
+    struct Channel {
+        // 窗口里的一个报文：RTP 头（原始数据块的第一个报文还带补的帧头）+ 共享缓冲区里的一段
+        struct Entry {
+            bool valid{false};
+            uint16_t sequence{0};
+            std::array<uint8_t, video_rtp::kHeaderBytes + video_framing::kHeaderBytes> prefix{};
+            std::size_t prefixBytes{0};
+            VideoPacket packet;
+            std::size_t offset{0};
+            std::size_t length{0};
+        };
+
+        Channel(uint16_t streamNumber, uint16_t portSlot, const sockaddr_in& target, std::size_t windowPackets, uint16_t firstSequence)
+            : number(streamNumber)
+            , slot(portSlot)
+            , destination(target)
+            , window(windowPackets)
+            , nextSequence(firstSequence) {}
+
+        const uint16_t number;
+        const uint16_t slot;            // 端口槽，通道释放前不会分给别的流
+        const sockaddr_in destination;
+
+        std::mutex mutex;
+        std::vector<Entry> window;      // 按 序号 % 窗口大小 存放
+        uint16_t nextSequence;
+        std::vector<iovec> iov;         // 发送时复用，避免每帧分配
+        std::vector<mmsghdr> messages;
+    };
+
+    explicit VideoMulticast(core::VideoMulticastConfig config);
+    ~VideoMulticast();
+
+    VideoMulticast(const VideoMulticast&) = delete;
+    VideoMulticast& operator=(const VideoMulticast&) = delete;
+
+    // 创建发送套接字并启动 NACK 线程（只能启动一次）
+    bool start();
+    // 停止发送和 NACK 线程；之后的 send 直接返回，套接字到析构时才关
+    void stop();
+
+    // 为一路流创建通道（流创建时调用一次）：优先用流编号对应的端口槽，被仍在使用的通道占着时顺延到下一个空闲槽，
+    // 槽全被占用时返回空（这路流只走 TCP）。流编号一直递增，按编号取模会让两路活着的流落到同一个组播端口
+    std::shared_ptr<Channel> open(uint16_t number);
+
+    // 发送一帧（转发路径调用：一次 sendmmsg 发出这帧的全部报文，套接字满时丢弃并计数，不阻塞）
+    void send(Channel& channel, const VideoPacket& packet);
+
+    // 通道的 "组播地址:端口"
+    std::string address(const Channel& channel) const;
+
+private:
+    void nackLoop();
+    std::size_t retransmit(Channel& channel, const std::vector<uint16_t>& lost, const sockaddr_in& to, std::size_t budget);
+    void loadSubnets();
+    bool allowedSource(const in_addr& address) const;
+    std::size_t takeBudget(const in_addr& address, std::size_t wanted);
+
+    // 每个接收端地址的重传令牌桶（只在 NACK 线程访问）
+    struct Bucket {
+        double tokens{0};
+        int64_t refilledAt{0};      // steady_clock 毫秒
+    };
+
+    const core::VideoMulticastConfig config_;
+    const std::size_t payloadBytes_;    // 每个报文 RTP 头之后的字节数
+    in_addr group_{};
+    int fd_{-1};                        // start 里创建、析构时关闭，其间不变（send 只看 running_）
+
+    std::mutex channelsMutex_;
+    std::unordered_map<uint16_t, std::weak_ptr<Channel>> channels_;    // 流编号 → 通道（NACK 线程查找，端口槽分配）
+
+    std::vector<std::pair<uint32_t, uint32_t>> subnets_;    // 接受 NACK 的网段 {地址, 掩码}（网络字节序），start 时确定
+    std::unordered_map<uint32_t, Bucket> buckets_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    monitoring::Counter& datagrams_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_datagrams_total", "RTP datagrams sent to multicast groups");
+    monitoring::Counter& bytes_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_bytes_total", "Bytes sent to multicast groups including RTP headers");
+    monitoring::Counter& sendErrors_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_send_errors_total", "Multicast datagrams not sent because the socket buffer was full or sendmmsg failed");
+    monitoring::Counter& nacks_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_nacks_total", "NACK datagrams received from multicast receivers");
+    monitoring::Counter& retransmits_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_retransmits_total", "Datagrams retransmitted by unicast in response to NACKs");
+    monitoring::Counter& nackRejected_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_nack_rejected_total", "NACK datagrams ignored because the source address is outside the multicast interface subnet");
+    monitoring::Counter& retransmitThrottled_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_retransmit_throttled_total", "NACKed sequence numbers not retransmitted because the source exceeded nackRatePackets");
+    monitoring::Counter& retransmitMisses_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_multicast_retransmit_misses_total", "NACKed sequence numbers already outside the retransmit window");
+};
+
+// 组播接收端（局域网客户端和回环测试使用）：加入组播组，按序号重排并重组整帧，发现缺号时向发送端要重传
+// 非线程安全，由一个线程调用 poll
+class VideoMulticastReceiver {
+public:
+    struct Stats {
+        uint64_t datagrams{0};
+        uint64_t duplicates{0};     // 重复或来得太晚的报文
+        uint64_t nacksSent{0};      // 发出的 NACK 报文
+        uint64_t requested{0};      // 请求重传的序号
+        uint64_t lost{0};           // 等到超时仍没收到的序号
+        uint64_t simulatedDrops{0}; // simulateLoss 丢掉的报文
+        uint64_t frames{0};         // 完整交付的帧
+        uint64_t keyframes{0};
+        uint64_t bytes{0};          // 交付的帧字节数（含帧头）
+    };
+
+    static constexpr std::size_t kWindow = 1024;    // 重排窗口（报文数）
+    static constexpr int64_t kGiveUpMs = 200;       // 缺号等这么久还没补上就跳过（丢掉所在的帧）
+    static constexpr int64_t kNackRetryMs = 20;     // 重传报文也可能丢，缺号一直没补上时隔这么久再要一次
+
+    VideoMulticastReceiver() = default;
+    ~VideoMulticastReceiver() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    VideoMulticastReceiver(const VideoMulticastReceiver&) = delete;
+    VideoMulticastReceiver& operator=(const VideoMulticastReceiver&) = delete;
+
+    // 加入组播组（interfaceAddress 为空时由系统选择网卡）
+    bool open(const std::string& group, uint16_t port, const std::string& interfaceAddress, std::string& error) {
+        fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd_ < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        const int one = 1;
+        ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        const int bufferBytes = 4 * 1024 * 1024;
+        ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        ip_mreq membership{};
+        if (::inet_pton(AF_INET, group.c_str(), &membership.imr_multiaddr) != 1) {
+            error = "invalid group address " + group;
+            return false;
+        }
+        local.sin_addr.s_addr = htonl(INADDR_ANY);  // 不绑组播地址：单播的重传报文也发到这个端口
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (!interfaceAddress.empty() && ::inet_pton(AF_INET, interfaceAddress.c_str(), &membership.imr_interface) != 1) {
+            error = "invalid interface address " + interfaceAddress;
+            return false;
+        }
+        if (::bind(fd_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 ||
+            ::setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // 测试用：按比例随机丢掉收到的报文（模拟网络丢包，验证重传）
+    void simulateLoss(double ratio) { lossRatio_ = ratio; }
+
+    // 最多等 timeoutMs 接收报文，完整的帧（20 字节帧头 + 负载）交给 onFrame(const uint8_t*, std::size_t)
+    template <typename Fn>
+    void poll(int timeoutMs, Fn&& onFrame) {
+        pollfd pfd{fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, timeoutMs) > 0) {
+            uint8_t buffer[65536];
+            while (true) {
+                sockaddr_in from{};
+                socklen_t fromLength = sizeof(from);
+                const ssize_t n = ::recvfrom(fd_, buffer, sizeof(buffer), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &fromLength);
+                if (n <= 0) {
+                    break;
+                }
+                onDatagram(buffer, static_cast<std::size_t>(n), from);
+            }
+        }
+        deliver(onFrame);
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    struct Slot {
+        bool valid{false};
+        bool marker{false};
+        uint16_t sequence{0};
+        std::vector<uint8_t> payload;
+    };
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void onDatagram(const uint8_t* data, std::size_t size, const sockaddr_in& from) {
+        video_rtp::RtpHeader header;
+        if (!video_rtp::decodeHeader(data, size, header)) {
+            return;
+        }
+        if (lossRatio_ > 0 && std::uniform_real_distribution<double>(0, 1)(random_) < lossRatio_) {
+            ++stats_.simulatedDrops;
+            return;
+        }
+        ++stats_.datagrams;
+        sender_ = from;
+        stream_ = static_cast<uint16_t>(header.ssrc);
+
+        if (!started_) {
+            started_ = true;
+            expected_ = header.sequence;
+            highest_ = static_cast<uint16_t>(header.sequence - 1);
+            syncing_ = true;    // 中途加入：从下一帧开始
+        }
+        const auto ahead = static_cast<int16_t>(header.sequence - expected_);
+        if (ahead < 0) {
+            ++stats_.duplicates;
+            return;
+        }
+        if (static_cast<std::size_t>(ahead) >= kWindow) {
+            // 落后太多（比如长时间没有调用 poll）：放弃窗口里的内容，从这里重新同步
+            stats_.lost += static_cast<uint64_t>(ahead);
+            for (auto& slot : slots_) {
+                slot.valid = false;
+            }
+            expected_ = header.sequence;
+            highest_ = static_cast<uint16_t>(header.sequence - 1);
+            frame_.clear();
+            syncing_ = true;
+        }
+
+        Slot& slot = slots_[header.sequence % kWindow];
+        if (slot.valid && slot.sequence == header.sequence) {
+            ++stats_.duplicates;
+            return;
+        }
+        slot.valid = true;
+        slot.marker = header.marker;
+        slot.sequence = header.sequence;
+        slot.payload.assign(data + video_rtp::kHeaderBytes, data + size);
+
+        // 比已收到的最大序号还新：中间缺的序号立即要求重传
+        const auto newer = static_cast<int16_t>(header.sequence - highest_);
+        if (newer > 0) {
+            std::vector<uint16_t> lost;
+            for (uint16_t seq = static_cast<uint16_t>(highest_ + 1); seq != header.sequence; ++seq) {
+                lost.push_back(seq);
+            }
+            highest_ = header.sequence;
+            if (!lost.empty()) {
+                sendNack(lost);
+            }
+        }
+    }
+
+    template <typename Fn>
+    void deliver(Fn&& onFrame) {
+        while (started_) {
+            Slot& slot = slots_[expected_ % kWindow];
+            if (!slot.valid || slot.sequence != expected_) {
+                // 缺号：还有更新的报文时开始计时，超时后跳过，所在的帧作废
+                if (static_cast<int16_t>(highest_ - expected_) <= 0) {
+                    gapSince_ = 0;
+                    return;
+                }
+                const int64_t now = nowMs();
+                if (gapSince_ == 0) {
+                    gapSince_ = now;
+                    lastNackAt_ = now;
+                }
+                if (now - gapSince_ < kGiveUpMs) {
+                    if (now - lastNackAt_ >= kNackRetryMs) {
+                        lastNackAt_ = now;
+                        sendNack(missing());
+                    }
+                    return;
+                }
+                ++stats_.lost;
+                ++expected_;
+                frame_.clear();
+                syncing_ = true;
+                gapSince_ = 0;
+                continue;
+            }
+            gapSince_ = 0;
+            if (!syncing_) {
+                frame_.insert(frame_.end(), slot.payload.begin(), slot.payload.end());
+            }
+            if (slot.marker) {
+                complete(onFrame);
+            }
+            slot.valid = false;
+            ++expected_;
+        }
+    }
+
+    template <typename Fn>
+    void complete(Fn&& onFrame) {
+        video_framing::FrameHeader header;
+        if (!syncing_ && frame_.size() >= video_framing::kHeaderBytes &&
+            video_framing::decodeHeader(frame_.data(), header) &&
+            frame_.size() == video_framing::kHeaderBytes + header.length) {
+            ++stats_.frames;
+            stats_.keyframes += (header.flags & video_framing::kFlagKeyframe) ? 1 : 0;
+            stats_.bytes += frame_.size();
+            onFrame(frame_.data(), frame_.size());
+        }
+        frame_.clear();
+        syncing_ = false;
+    }
+
+    // 窗口里还缺的序号（最多一个 NACK 报文能带的数量）
+    std::vector<uint16_t> missing() const {
+        std::vector<uint16_t> lost;
+        for (uint16_t seq = expected_; seq != static_cast<uint16_t>(highest_ + 1) && lost.size() < video_rtp::kMaxNackEntries; ++seq) {
+            const Slot& slot = slots_[seq % kWindow];
+            if (!slot.valid || slot.sequence != seq) {
+                lost.push_back(seq);
+            }
+        }
+        return lost;
+    }
+
+    void sendNack(const std::vector<uint16_t>& lost) {
+        uint8_t buffer[4 + 4 * video_rtp::kMaxNackEntries];
+        const std::size_t size = video_rtp::encodeNack(stream_, lost, buffer, sizeof(buffer));
+        if (::sendto(fd_, buffer, size, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&sender_), sizeof(sender_)) > 0) {
+            ++stats_.nacksSent;
+            stats_.requested += lost.size();
+        }
+    }
+
+    int fd_{-1};
+    std::array<Slot, kWindow> slots_{};
+    bool started_{false};
+    bool syncing_{true};
+    uint16_t expected_{0};      // 下一个要交付的序号
+    uint16_t highest_{0};       // 收到的最大序号
+    int64_t gapSince_{0};
+    int64_t lastNackAt_{0};
+    std::vector<uint8_t> frame_;
+    sockaddr_in sender_{};
+    uint16_t stream_{0};
+    double lossRatio_{0};
+    std::mt19937 random_{std::random_device{}()};
+    Stats stats_;
+};
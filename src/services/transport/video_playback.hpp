@@ -0,0 +1,168 @@
+// DVR 回放：把录像段里一个时间范围的帧发给一个连接
+// 段文件 mmap 进来，直接从映射区交给传输层发送，不经过 read() 拷贝和缓冲区池
+// （epoll 后端能直接写进内核时不再拷贝；HPSocket 的 Send 总会拷进连接的发送缓冲区）
+// 与订阅端相同，只在连接待发字节低于上限时继续发，发送完成回调（onSend）里接着发；全部发完且发送缓冲区清空后断开
+// 第一段先发段开头的配置帧，再从不晚于起始时间的最后一个关键帧开始；超过结束时间的帧不发
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "network/tcp_server.hpp"
+#include "services/transport/video_framing.hpp"
+#include "services/transport/video_recorder.hpp"
+
+class VideoPlayback {
+public:
+    VideoPlayback(network::ConnectionId id, network::TcpServer* server, std::size_t maxPendingBytes, bool framed,
+                  std::vector<video_recording::Segment> segments, uint64_t fromUs, uint64_t toUs)
+        : id_(id)
+        , server_(server)
+        , maxPendingBytes_(maxPendingBytes)
+        , framed_(framed)
+        , segments_(std::move(segments))
+        , fromUs_(fromUs)
+        , toUs_(toUs) {}
+
+    ~VideoPlayback() { unmap(); }
+
+    VideoPlayback(const VideoPlayback&) = delete;
+    VideoPlayback& operator=(const VideoPlayback&) = delete;
+
+    // 继续发送（开始回放和发送完成回调里调用，任意线程）
+    void pump() {
+        std::lock_guard<std::mutex> lk(mutex_);
+        while (!finished_ && pendingBytes() < maxPendingBytes_) {
+            if (data_ == nullptr && !openNext()) {
+                finished_ = true;
+                break;
+            }
+            if (!sendNext()) {
+                unmap();
+            }
+        }
+        if (finished_ && !disconnected_ && pendingBytes() == 0) {
+            disconnected_ = true;
+            server_->disconnect(id_);   // 发送缓冲区已清空，可以直接关闭
+        }
+    }
+
+    uint64_t sentFrames() const { return sentFrames_; }
+
+private:
+    // 映射下一个段并定位起点，没有下一段返回 false
+    bool openNext() {
+        while (next_ < segments_.size()) {
+            const auto& segment = segments_[next_++];
+            const bool first = next_ == 1;
+            const int fd = ::open(segment.path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                continue;   // 可能刚被保留策略删除
+            }
+            struct stat st {};
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                void* mapped = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) {
+                    data_ = static_cast<const uint8_t*>(mapped);
+                    size_ = static_cast<std::size_t>(st.st_size);   // 正在写的段只发到映射时的长度
+                }
+            }
+            ::close(fd);
+            if (data_ == nullptr) {
+                continue;
+            }
+            ::madvise(const_cast<uint8_t*>(data_), size_, MADV_SEQUENTIAL);
+
+            cursor_ = 0;
+            seek_ = 0;
+            if (first) {
+                // 从不晚于起始时间的最后一个关键帧开始（索引偏移指向它前面的配置帧）
+                for (const auto& entry : video_recording::readIndex(segment.indexPath)) {
+                    if (entry.timeUs > fromUs_) {
+                        break;
+                    }
+                    seek_ = entry.offset;
+                }
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // 发送当前位置的一条记录；段结束（或记录不完整）返回 false
+    bool sendNext() {
+        using namespace video_recording;
+        if (cursor_ < seek_) {
+            // 起点之前只发段开头的配置帧，遇到其他帧直接跳到起点
+            video_framing::FrameHeader header;
+            if (!peek(header) || !(header.flags & video_framing::kFlagConfig)) {
+                cursor_ = seek_;
+            }
+        }
+
+        video_framing::FrameHeader header;
+        if (!peek(header)) {
+            return false;
+        }
+        if (readU64(data_ + cursor_) > toUs_) {
+            finished_ = true;
+            return false;
+        }
+        const std::size_t skip = framed_ ? kTimeBytes : kRecordHeaderBytes;
+        const std::size_t recordBytes = kRecordHeaderBytes + header.length;
+        if (recordBytes > skip) {
+            server_->send(id_, data_ + cursor_ + skip, recordBytes - skip);
+            ++sentFrames_;
+        }
+        cursor_ += recordBytes;
+        return true;
+    }
+
+    // 读当前记录的帧头，记录不完整或已损坏返回 false
+    bool peek(video_framing::FrameHeader& header) const {
+        using namespace video_recording;
+        if (cursor_ + kRecordHeaderBytes > size_ || !video_framing::decodeHeader(data_ + cursor_ + kTimeBytes, header)) {
+            return false;
+        }
+        return cursor_ + kRecordHeaderBytes + header.length <= size_;
+    }
+
+    void unmap() {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<uint8_t*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    std::size_t pendingBytes() const {
+        return server_->pendingBytes(id_);
+    }
+
+    const network::ConnectionId id_;
+    network::TcpServer* server_;
+    const std::size_t maxPendingBytes_;
+    const bool framed_;
+    const std::vector<video_recording::Segment> segments_;
+    const uint64_t fromUs_;
+    const uint64_t toUs_;
+
+    std::mutex mutex_;
+    std::size_t next_{0};           // 下一个要打开的段
+    const uint8_t* data_{nullptr};  // 当前段的映射
+    std::size_t size_{0};
+    std::size_t cursor_{0};
+    std::size_t seek_{0};           // 第一段的起点
+    bool finished_{false};
+    bool disconnected_{false};
+    uint64_t sentFrames_{0};
+};
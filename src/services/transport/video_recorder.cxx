@@ -0,0 +1,410 @@
+#include "services/transport/video_recorder.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "core/logger.hpp"
+
+namespace video_recording {
+
+std::vector<IndexEntry> readIndex(const std::string& indexPath) {
+    std::vector<IndexEntry> entries;
+    const int fd = ::open(indexPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return entries;
+    }
+    uint8_t buffer[kIndexEntryBytes * 256];
+    std::size_t carry = 0;
+    while (true) {
+        const ssize_t n = ::read(fd, buffer + carry, sizeof(buffer) - carry);
+        if (n <= 0) {
+            break;
+        }
+        const std::size_t available = carry + static_cast<std::size_t>(n);
+        std::size_t pos = 0;
+        for (; pos + kIndexEntryBytes <= available; pos += kIndexEntryBytes) {
+            entries.push_back(IndexEntry{readU64(buffer + pos), readU64(buffer + pos + 8)});
+        }
+        carry = available - pos;
+        std::memmove(buffer, buffer + pos, carry);
+    }
+    ::close(fd);
+    return entries;
+}
+
+std::string directoryName(const std::string& stream) {
+    std::string name;
+    for (const char c : stream) {
+        const bool safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                          c == '_' || c == '-' || c == '.';
+        name.push_back(safe ? c : '_');
+    }
+    if (name.empty() || name.find_first_not_of('.') == std::string::npos) {
+        name = "_" + name;     // 不能是 "." 或 ".."
+    }
+    return name;
+}
+
+} // namespace video_recording
+
+namespace {
+
+namespace fs = std::filesystem;
+using namespace video_recording;
+
+uint64_t unixMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// 目录下的段，按起始时间排序
+std::vector<Segment> listSegments(const fs::path& directory) {
+    std::vector<Segment> segments;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path& path = it->path();
+        if (path.extension() != kSegmentSuffix) {
+            continue;
+        }
+        const std::string stem = path.stem().string();
+        if (stem.empty() || stem.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        fs::path index = path;
+        index.replace_extension(kIndexSuffix);
+        segments.push_back(Segment{path.string(), index.string(), std::stoull(stem)});
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.startUs < b.startUs; });
+    return segments;
+}
+
+// 写完整个 iovec 数组（处理部分写入，每次最多 IOV_MAX 段）
+bool writeAll(int fd, iovec* pieces, std::size_t count) {
+    while (count > 0) {
+        const int batch = static_cast<int>(std::min<std::size_t>(count, IOV_MAX));
+        ssize_t written = ::writev(fd, pieces, batch);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (count > 0 && written >= static_cast<ssize_t>(pieces->iov_len)) {
+            written -= static_cast<ssize_t>(pieces->iov_len);
+            ++pieces;
+            --count;
+        }
+        if (count > 0 && written > 0) {
+            pieces->iov_base = static_cast<uint8_t*>(pieces->iov_base) + written;
+            pieces->iov_len -= static_cast<std::size_t>(written);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+VideoRecorder::VideoRecorder(core::VideoRecordingConfig config)
+    : config_(std::move(config))
+    , queue_(std::max<std::size_t>(config_.queuePackets, 64)) {}
+
+VideoRecorder::~VideoRecorder() {
+    stop();
+}
+
+void VideoRecorder::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+    std::error_code ec;
+    fs::create_directories(config_.directory, ec);
+    if (ec) {
+        LOG_ERROR("video_recorder", "Cannot create recording directory ", config_.directory, ": ", ec.message());
+    }
+    thread_ = std::thread(&VideoRecorder::run, this);
+    LOG_INFO("video_recorder", "Recording to ", config_.directory, " (", config_.segmentSeconds, "s segments)");
+}
+
+void VideoRecorder::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(wakeMutex_);
+    }
+    wakeCv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void VideoRecorder::record(const std::string& stream, const VideoPacket& packet) {
+    Item item;
+    item.stream = stream;
+    item.timeUs = unixMicros();
+    item.packet = packet;
+    if (!queue_.tryPush(std::move(item))) {
+        droppedPackets_.inc();
+    }
+}
+
+std::vector<Segment> VideoRecorder::segments(const std::string& stream, uint64_t fromUs, uint64_t toUs) const {
+    const auto all = listSegments(fs::path(config_.directory) / directoryName(stream));
+    std::vector<Segment> result;
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        // 段 i 覆盖 [start_i, start_{i+1})，最后一段覆盖到现在
+        const bool endsBefore = i + 1 < all.size() && all[i + 1].startUs <= fromUs;
+        if (!endsBefore && all[i].startUs <= toUs) {
+            result.push_back(all[i]);
+        }
+    }
+    return result;
+}
+
+void VideoRecorder::run() {
+    std::vector<Item> batch;
+    auto nextRetention = std::chrono::steady_clock::now();
+    const auto interval = std::chrono::milliseconds(std::max<uint32_t>(config_.flushIntervalMs, 10));
+
+    while (true) {
+        const bool running = running_.load();
+        {
+            std::unique_lock<std::mutex> lk(wakeMutex_);
+            if (running) {
+                wakeCv_.wait_for(lk, interval, [this] { return !running_.load(); });
+            }
+        }
+
+        Item item;
+        while (queue_.tryPop(item)) {
+            batch.push_back(std::move(item));
+        }
+        if (!batch.empty()) {
+            monitoring::ScopedLatency latency(batchLatency_);
+            writeBatch(batch);
+            batch.clear();  // 写完才释放缓冲区引用
+        }
+        closeIdle();
+
+        if (!running) {
+            break;
+        }
+        if (std::chrono::steady_clock::now() >= nextRetention) {
+            enforceRetention();
+            nextRetention = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+        }
+    }
+
+    for (auto& [stream, writer] : writers_) {
+        closeSegment(writer);
+    }
+    writers_.clear();
+}
+
+void VideoRecorder::writeBatch(std::vector<Item>& batch) {
+    for (const Item& item : batch) {
+        auto it = writers_.find(item.stream);
+        if (it == writers_.end()) {
+            it = writers_.emplace(item.stream, Writer{}).first;
+            it->second.directory = (fs::path(config_.directory) / directoryName(item.stream)).string();
+            std::error_code ec;
+            fs::create_directories(it->second.directory, ec);
+        }
+        Writer& writer = it->second;
+
+        // 切段：到时后在关键帧（或一组配置帧的开头）处切，原始数据块没有关键帧直接切；超过两倍时长强制切
+        const uint64_t segmentUs = static_cast<uint64_t>(std::max<uint32_t>(config_.segmentSeconds, 1)) * 1000000;
+        const uint64_t elapsed = item.timeUs > writer.startUs ? item.timeUs - writer.startUs : 0;
+        const bool boundary = !item.packet.framed() || item.packet.keyframe() ||
+                              (item.packet.config() && !writer.lastWasConfig);
+        if (writer.fd < 0 || (elapsed >= segmentUs && boundary) || elapsed >= 2 * segmentUs) {
+            flush(writer);
+            closeSegment(writer);
+            openSegment(writer, item.timeUs);
+            if (writer.fd >= 0 && !item.packet.config()) {
+                // 新段先写最近的配置帧，单独回放这一段也能解码
+                const auto config = writer.config;
+                for (const auto& packet : config) {
+                    append(writer, Item{item.stream, item.timeUs, packet});
+                }
+            }
+        }
+        if (writer.fd >= 0) {
+            append(writer, item);
+        }
+        writer.lastUs = item.timeUs;
+    }
+
+    for (auto& [stream, writer] : writers_) {
+        flush(writer);
+    }
+}
+
+void VideoRecorder::append(Writer& writer, const Item& item) {
+    const VideoPacket& packet = item.packet;
+
+    // 配置帧跟踪：索引项指向关键帧前紧挨着的配置帧
+    if (packet.config()) {
+        if (!writer.lastWasConfig) {
+            writer.configRunStart = writer.offset;
+            writer.config.clear();
+        }
+        writer.config.push_back(packet);
+    }
+    if (packet.keyframe()) {
+        uint8_t entry[kIndexEntryBytes];
+        writeU64(entry, item.timeUs);
+        writeU64(entry + 8, writer.lastWasConfig || packet.config() ? writer.configRunStart : writer.offset);
+        writer.index.insert(writer.index.end(), entry, entry + kIndexEntryBytes);
+    }
+    writer.lastWasConfig = packet.config();
+
+    auto& header = writer.headers.emplace_back();
+    writeU64(header.data(), item.timeUs);
+    std::size_t headerBytes = kTimeBytes;
+    if (!packet.framed()) {
+        // 原始数据块补一个帧头
+        video_framing::FrameHeader frame;
+        frame.streamId = packet.streamId;
+        frame.length = static_cast<uint32_t>(packet.data.size());
+        video_framing::encodeHeader(frame, header.data() + kTimeBytes);
+        headerBytes = kRecordHeaderBytes;
+    }
+    writer.pieces.push_back(iovec{header.data(), headerBytes});
+    writer.pieces.push_back(iovec{const_cast<uint8_t*>(packet.data.data()), packet.data.size()});
+    writer.packets.push_back(packet);
+    writer.offset += headerBytes + packet.data.size();
+}
+
+void VideoRecorder::flush(Writer& writer) {
+    if (writer.fd >= 0 && !writer.pieces.empty()) {
+        std::size_t bytes = 0;
+        for (const auto& piece : writer.pieces) {
+            bytes += piece.iov_len;
+        }
+        if (writeAll(writer.fd, writer.pieces.data(), writer.pieces.size())) {
+            recordedBytes_.inc(bytes);
+        } else {
+            writeErrors_.inc();
+            LOG_WARN("video_recorder", "Write to ", writer.directory, " failed: ", std::strerror(errno));
+        }
+        // 索引在数据之后写：读端看到的索引项一定指向已经写出的记录
+        if (!writer.index.empty() &&
+            ::write(writer.indexFd, writer.index.data(), writer.index.size()) != static_cast<ssize_t>(writer.index.size())) {
+            writeErrors_.inc();
+        }
+    }
+    writer.pieces.clear();
+    writer.headers.clear();
+    writer.packets.clear();
+    writer.index.clear();
+}
+
+void VideoRecorder::openSegment(Writer& writer, uint64_t startUs) {
+    const std::string base = (fs::path(writer.directory) / std::to_string(startUs)).string();
+    writer.fd = ::open((base + kSegmentSuffix).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    writer.indexFd = ::open((base + kIndexSuffix).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (writer.fd < 0 || writer.indexFd < 0) {
+        writeErrors_.inc();
+        LOG_WARN("video_recorder", "Cannot open segment ", base, ": ", std::strerror(errno));
+        closeSegment(writer);
+        return;
+    }
+    writer.startUs = startUs;
+    writer.offset = 0;
+    writer.lastWasConfig = false;
+}
+
+void VideoRecorder::closeSegment(Writer& writer) {
+    if (writer.fd >= 0) {
+        ::close(writer.fd);
+    }
+    if (writer.indexFd >= 0) {
+        ::close(writer.indexFd);
+    }
+    writer.fd = -1;
+    writer.indexFd = -1;
+}
+
+void VideoRecorder::closeIdle() {
+    const uint64_t segmentUs = static_cast<uint64_t>(std::max<uint32_t>(config_.segmentSeconds, 1)) * 1000000;
+    const uint64_t now = unixMicros();
+    for (auto it = writers_.begin(); it != writers_.end();) {
+        // 批次已经在 writeBatch 里写出，这里只剩关文件
+        if (now > it->second.lastUs && now - it->second.lastUs >= segmentUs) {
+            if (it->second.fd >= 0) {
+                idleClosed_.inc();
+                LOG_INFO("video_recorder", "Stream ", it->first, " idle, closed segment ", it->second.startUs);
+            }
+            closeSegment(it->second);
+            it = writers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void VideoRecorder::enforceRetention() {
+    struct Candidate {
+        Segment segment;
+        uint64_t endUs;
+        uintmax_t bytes;
+    };
+
+    // 正在写的段不删
+    std::vector<std::string> open;
+    for (const auto& [stream, writer] : writers_) {
+        if (writer.fd >= 0) {
+            open.push_back((fs::path(writer.directory) / (std::to_string(writer.startUs) + kSegmentSuffix)).string());
+        }
+    }
+
+    std::vector<Candidate> candidates;
+    uintmax_t totalBytes = 0;
+    std::error_code ec;
+    for (fs::directory_iterator it(config_.directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_directory()) {
+            continue;
+        }
+        const auto segments = listSegments(it->path());
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            std::error_code sizeEc;
+            const uintmax_t bytes = fs::file_size(segments[i].path, sizeEc) + fs::file_size(segments[i].indexPath, sizeEc);
+            totalBytes += sizeEc ? 0 : bytes;
+            if (std::find(open.begin(), open.end(), segments[i].path) != open.end()) {
+                continue;
+            }
+            // 段的结束时间取下一段的开始；最后一段（推流端已断开）按开始时间算
+            const uint64_t endUs = i + 1 < segments.size() ? segments[i + 1].startUs : segments[i].startUs;
+            candidates.push_back(Candidate{segments[i], endUs, sizeEc ? 0 : bytes});
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.endUs < b.endUs; });
+
+    const uint64_t cutoff = config_.retentionHours == 0
+                                ? 0
+                                : unixMicros() - static_cast<uint64_t>(config_.retentionHours) * 3600 * 1000000;
+    const uintmax_t limit = static_cast<uintmax_t>(config_.maxTotalMb) * 1024 * 1024;
+    for (const auto& candidate : candidates) {
+        const bool expired = candidate.endUs < cutoff;
+        const bool overLimit = limit != 0 && totalBytes > limit;
+        if (!expired && !overLimit) {
+            break;  // 按结束时间排序，后面的更新
+        }
+        std::error_code removeEc;
+        fs::remove(candidate.segment.path, removeEc);
+        fs::remove(candidate.segment.indexPath, removeEc);
+        totalBytes -= std::min(totalBytes, candidate.bytes);
+        deletedSegments_.inc();
+        LOG_INFO("video_recorder", "Removed segment ", candidate.segment.path, expired ? " (expired)" : " (size limit)");
+    }
+}
@@ -0,0 +1,146 @@
+// 视频录像：每路流按时间分段写文件，附关键帧索引，供 DVR 回放
+// 转发路径只做一次无锁入队（共享缓冲区，只加引用计数）；后台线程按 flushIntervalMs 攒批，用 writev 一次写出一批记录
+// 段文件：<directory>/<流名>/<起始 Unix 微秒>.avseg，每条记录 = 8 字节接收时间（Unix 微秒，网络序）+ 20 字节帧头 + 负载
+//         原始数据块也补一个帧头（flags 为 0），读端统一按帧解析
+// 索引：同名 .avidx，每个关键帧一条 {时间, 偏移}（网络序各 8 字节），偏移指向紧挨在关键帧前的配置帧（没有则指向关键帧）
+// 分帧流到时后在下一个关键帧处切段，新段开头先写一遍最近的配置帧，每段都能单独解码
+// 保留：后台线程定期按 retentionHours 和 maxTotalMb 删除最旧的段（正在写的段不删）
+// 一路流超过一个分段时长没有新数据（推流端断开或停推）就关闭它的段并释放写端，文件句柄不随流名累积，这一段也归入保留
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <array>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "core/configuration.hpp"
+#include "core/mpmc_queue.hpp"
+#include "monitoring/metrics.hpp"
+#include "services/transport/video_framing.hpp"
+
+namespace video_recording {
+
+inline constexpr const char* kSegmentSuffix = ".avseg";
+inline constexpr const char* kIndexSuffix = ".avidx";
+inline constexpr std::size_t kTimeBytes = 8;
+inline constexpr std::size_t kRecordHeaderBytes = kTimeBytes + video_framing::kHeaderBytes;
+inline constexpr std::size_t kIndexEntryBytes = 16;
+
+// 一个录像段
+struct Segment {
+    std::string path;           // .avseg
+    std::string indexPath;      // .avidx
+    uint64_t startUs{0};
+};
+
+// 索引项：关键帧时间和记录偏移
+struct IndexEntry {
+    uint64_t timeUs{0};
+    uint64_t offset{0};
+};
+
+inline void writeU64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (56 - 8 * i));
+    }
+}
+
+inline uint64_t readU64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+// 读取一个段的索引（读不到返回空）
+std::vector<IndexEntry> readIndex(const std::string& indexPath);
+
+// 流名转成目录名（只保留字母数字和 _-.，防止跳出录像目录）
+std::string directoryName(const std::string& stream);
+
+} // namespace video_recording
+
+class VideoRecorder {
+public:
+    explicit VideoRecorder(core::VideoRecordingConfig config);
+    ~VideoRecorder();
+
+    VideoRecorder(const VideoRecorder&) = delete;
+    VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+    void start();
+    void stop();
+
+    // 转发路径调用：一次无锁入队，队列满时丢弃并计数，不阻塞转发
+    void record(const std::string& stream, const VideoPacket& packet);
+
+    // 覆盖 [fromUs, toUs] 的段，按时间排序（回放使用，任意线程可调用）
+    std::vector<video_recording::Segment> segments(const std::string& stream, uint64_t fromUs, uint64_t toUs) const;
+
+private:
+    struct Item {
+        std::string stream;
+        uint64_t timeUs{0};     // 收到的 Unix 微秒
+        VideoPacket packet;
+    };
+
+    // 每路流当前正在写的段（只由录像线程访问）
+    struct Writer {
+        std::string directory;
+        int fd{-1};
+        int indexFd{-1};
+        uint64_t startUs{0};
+        uint64_t lastUs{0};                 // 最近一条记录的时间
+        uint64_t offset{0};                 // 当前段已写（含待写）的字节数
+        bool lastWasConfig{false};
+        uint64_t configRunStart{0};         // 最近一组配置帧在段内的偏移
+        std::vector<VideoPacket> config;    // 最近一组配置帧，切段后先写一遍
+
+        // 本批待写
+        std::vector<VideoPacket> packets;   // 持有缓冲区直到写完
+        std::deque<std::array<uint8_t, video_recording::kRecordHeaderBytes>> headers;   // deque 追加不搬移，iovec 指针保持有效
+        std::vector<iovec> pieces;
+        std::vector<uint8_t> index;
+    };
+
+    void run();
+    void writeBatch(std::vector<Item>& batch);
+    void append(Writer& writer, const Item& item);
+    void openSegment(Writer& writer, uint64_t startUs);
+    void closeSegment(Writer& writer);
+    void flush(Writer& writer);
+    void closeIdle();
+    void enforceRetention();
+
+    core::VideoRecordingConfig config_;
+    core::BoundedMpmcQueue<Item> queue_;
+    std::unordered_map<std::string, Writer> writers_;
+
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCv_;
+
+    monitoring::Counter& recordedBytes_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_recorded_bytes_total", "Bytes written to video recording segments");
+    monitoring::Counter& droppedPackets_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_recording_dropped_total", "Video packets not recorded because the recording queue was full");
+    monitoring::Counter& writeErrors_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_recording_write_errors_total", "Failed writes to video recording segments");
+    monitoring::Counter& idleClosed_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_recording_idle_closed_total", "Recording segments closed because the stream sent nothing for a segment length");
+    monitoring::Counter& deletedSegments_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_video_recording_deleted_segments_total", "Recording segments removed by retention");
+    monitoring::Histogram& batchLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_video_recording_batch_seconds", "Time spent writing one recording batch");
+};
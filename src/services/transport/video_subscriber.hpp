@@ -0,0 +1,243 @@
+// 视频订阅端：每个订阅端一个有界队列，转发线程只负责入队，发送在注册表锁之外进行
+// 传输层的 send 写不完的部分会拷进连接的发送缓冲区，慢订阅端会让这块缓冲区无限增长；
+// 因此只在连接待发字节低于上限时才从队列取包发送，其余留在有界队列里，队列满了按策略丢弃或断开
+// 发送完成回调（onSend）会再次调用 drain()，把积压的包继续发出去
+// 订阅多路流时各路的转发线程往同一个队列入队（入队串行化），关键帧等待状态按流编号分开记
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "network/tcp_server.hpp"
+#include "core/mpmc_queue.hpp"
+#include "core/packet_pool.hpp"
+#include "monitoring/metrics.hpp"
+#include "services/transport/video_framing.hpp"
+
+// 订阅端队列满时的处理策略
+enum class DropPolicy {
+    DropOldest,         // 丢弃队列里最旧的包，保留最新的
+    DropUntilKeyframe,  // 清空队列并丢弃后续帧，直到下一个关键帧（只对分帧推流有效，原始数据块按 drop_oldest 处理）
+    Disconnect,         // 断开该订阅端
+};
+
+inline DropPolicy parseDropPolicy(const std::string& text, DropPolicy fallback = DropPolicy::DropOldest) {
+    if (text == "drop_oldest") return DropPolicy::DropOldest;
+    if (text == "drop_until_keyframe") return DropPolicy::DropUntilKeyframe;
+    if (text == "disconnect") return DropPolicy::Disconnect;
+    return fallback;
+}
+
+inline const char* dropPolicyName(DropPolicy policy) {
+    switch (policy) {
+    case DropPolicy::DropOldest: return "drop_oldest";
+    case DropPolicy::DropUntilKeyframe: return "drop_until_keyframe";
+    case DropPolicy::Disconnect: return "disconnect";
+    }
+    return "unknown";
+}
+
+// 订阅端统计（诊断接口使用）
+struct SubscriberStats {
+    network::ConnectionId id{0};
+    std::size_t queued{0};          // 队列中等待发送的包
+    std::size_t pendingBytes{0};    // 已交给传输层但还没发出的字节
+    uint64_t sentPackets{0};
+    uint64_t sentBytes{0};
+    uint64_t dropped{0};            // 因队列满丢弃的包
+    bool framedOutput{false};       // 分帧订阅端（收到带帧头的整帧）
+    bool waitingKeyframe{false};    // drop_until_keyframe 丢帧后还有流在等关键帧
+};
+
+class VideoSubscriber {
+public:
+    VideoSubscriber(network::ConnectionId id, network::TcpServer* server, std::size_t queuePackets, std::size_t maxPendingBytes, DropPolicy policy)
+        : id_(id)
+        , server_(server)
+        , maxPendingBytes_(maxPendingBytes)
+        , policy_(policy)
+        , queue_(queuePackets) {
+    }
+
+    VideoSubscriber(const VideoSubscriber&) = delete;
+    VideoSubscriber& operator=(const VideoSubscriber&) = delete;
+
+    network::ConnectionId id() const { return id_; }
+
+    // 分帧订阅端收到带帧头的整帧，其他订阅端只收负载（原始数据块不受影响）
+    void setFramedOutput(bool framed) { framedOutput_.store(framed, std::memory_order_relaxed); }
+
+    // 入队（加入时由 GOP 缓存预填，之后只由转发线程调用），droppedCount 返回这次丢弃的包数
+    // disconnect 策略下队列满时返回 false，由调用方断开该订阅端
+    bool enqueue(const VideoPacket& packet, std::size_t& droppedCount) {
+        droppedCount = 0;
+        if (closing_.load(std::memory_order_relaxed)) {
+            return true;    // 已经要求断开，等 onClose
+        }
+        // 多路流的转发线程会同时入队：关键帧状态的判断、入队和清空队列要一起做
+        std::lock_guard<std::mutex> lock(enqueueMutex_);
+        if (packet.framed()) {
+            // 这路流刚加入或丢过帧：关键帧之前的帧解不出来，直接跳过；编解码配置帧保留，这路流自己的关键帧到了恢复
+            // 刚加入时跳过的帧不算丢包（一般由 GOP 缓存预先送过关键帧，不会跳过）
+            StreamGate& gate = gates_[packet.streamId];
+            if (gate.waitingKeyframe || !gate.started) {
+                if (!packet.keyframe() && !packet.config()) {
+                    if (gate.waitingKeyframe) {
+                        droppedCount = 1;
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    return true;
+                }
+                if (packet.keyframe()) {
+                    gate.waitingKeyframe = false;
+                    gate.started = true;
+                }
+            }
+        }
+        if (queue_.tryPush(packet)) {
+            return true;
+        }
+
+        switch (policy_) {
+        case DropPolicy::Disconnect:
+            closing_.store(true, std::memory_order_relaxed);
+            return false;
+
+        case DropPolicy::DropUntilKeyframe:
+            if (packet.framed()) {
+                // 清空队列（都是整帧，可能来自每一路流），之后每路流都只放行关键帧和配置帧，直到自己的关键帧
+                VideoPacket stale;
+                while (queue_.tryPop(stale)) {
+                    ++droppedCount;
+                }
+                for (auto& [streamId, gate] : gates_) {
+                    gate.waitingKeyframe = gate.started;
+                }
+                if (packet.keyframe() || packet.config()) {
+                    queue_.tryPush(packet);
+                } else {
+                    ++droppedCount;
+                }
+                if (packet.keyframe()) {
+                    gates_[packet.streamId].waitingKeyframe = false;
+                }
+                break;
+            }
+            [[fallthrough]];    // 原始数据块没有帧边界，识别不了关键帧，按 drop_oldest 处理
+
+        case DropPolicy::DropOldest: {
+            // 丢掉最旧的包腾出位置（发送线程可能同时在取，失败就多试一次）
+            VideoPacket oldest;
+            for (int attempt = 0; attempt < 4; ++attempt) {
+                if (queue_.tryPop(oldest)) {
+                    ++droppedCount;
+                }
+                if (queue_.tryPush(packet)) {
+                    break;
+                }
+            }
+            break;
+        }
+        }
+        dropped_.fetch_add(droppedCount, std::memory_order_relaxed);
+        return true;
+    }
+
+    // 发送队列中的包，直到连接的待发字节超过上限（任意线程可调用，同一时刻只有一个线程在发）
+    void drain() {
+        while (true) {
+            bool expected = false;
+            if (!draining_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                return;     // 其他线程正在发，它退出前会再检查一次队列
+            }
+
+            VideoPacket packet;
+            while (pendingBytes() < maxPendingBytes_ && queue_.tryPop(packet)) {
+                // 非分帧订阅端跳过帧头，只发负载
+                const std::size_t offset = framedOutput_.load(std::memory_order_relaxed) ? 0 : packet.headerBytes;
+                const std::size_t length = packet.data.size() - offset;
+                if (length != 0 && server_->send(id_, packet.data.data() + offset, length)) {
+                    sentPackets_.fetch_add(1, std::memory_order_relaxed);
+                    sentBytes_.fetch_add(length, std::memory_order_relaxed);
+                    recordLatency(packet);
+                }
+                packet = VideoPacket{};     // 及时归还缓冲区
+            }
+            draining_.store(false, std::memory_order_release);
+
+            // 释放标志之后才入队的包可能没有人发，再检查一次
+            if (queue_.sizeApprox() == 0 || pendingBytes() >= maxPendingBytes_) {
+                return;
+            }
+        }
+    }
+
+    SubscriberStats stats() const {
+        SubscriberStats stats;
+        stats.id = id_;
+        stats.queued = queue_.sizeApprox();
+        stats.pendingBytes = pendingBytes();
+        stats.sentPackets = sentPackets_.load(std::memory_order_relaxed);
+        stats.sentBytes = sentBytes_.load(std::memory_order_relaxed);
+        stats.dropped = dropped_.load(std::memory_order_relaxed);
+        stats.framedOutput = framedOutput_.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(enqueueMutex_);
+            for (const auto& [streamId, gate] : gates_) {
+                stats.waitingKeyframe = stats.waitingKeyframe || gate.waitingKeyframe;
+            }
+        }
+        return stats;
+    }
+
+private:
+    // 每路流的关键帧状态
+    struct StreamGate {
+        bool started{false};            // 已收到过这路流的关键帧（分帧流从关键帧开始发）
+        bool waitingKeyframe{false};    // drop_until_keyframe 丢帧后等这路流的关键帧
+    };
+
+    // 收到 → 交给传输层的时间；推流端带采集时刻时再记采集 → 交给传输层的时间（端到端延迟的服务端部分）
+    static void recordLatency(const VideoPacket& packet) {
+        static monitoring::Histogram& delivery = monitoring::MetricsRegistry::instance().histogram(
+            "aqua_video_delivery_seconds", "Time from packet receipt to handing it to a subscriber connection");
+        static monitoring::Histogram& captureToSend = monitoring::MetricsRegistry::instance().histogram(
+            "aqua_video_capture_to_send_seconds", "Time from publisher capture timestamp to handing the frame to a subscriber");
+
+        const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        delivery.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::duration(now - packet.timestamp)).count()));
+        if (packet.wallclock()) {
+            const int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            const int64_t elapsedUs = nowUs - static_cast<int64_t>(packet.pts);
+            if (elapsedUs >= 0 && elapsedUs < 60 * 1000 * 1000) {   // 时钟不同步时忽略
+                captureToSend.record(static_cast<uint64_t>(elapsedUs) * 1000);
+            }
+        }
+    }
+
+    std::size_t pendingBytes() const {
+        return server_->pendingBytes(id_);
+    }
+
+    const network::ConnectionId id_;
+    network::TcpServer* server_;
+    const std::size_t maxPendingBytes_;
+    const DropPolicy policy_;
+    core::BoundedMpmcQueue<VideoPacket> queue_;
+    std::atomic<bool> draining_{false};
+    std::atomic<bool> closing_{false};
+    std::atomic<bool> framedOutput_{false};
+    mutable std::mutex enqueueMutex_;              // 串行化入队，保护 gates_
+    std::unordered_map<uint16_t, StreamGate> gates_;   // 按流编号（packet.streamId）
+    std::atomic<uint64_t> sentPackets_{0};
+    std::atomic<uint64_t> sentBytes_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
@@ -0,0 +1,100 @@
+// Gorilla 编码往返测试：时间戳 delta-of-delta 每个分段的边界值、32 位兜底分支，以及 XOR 浮点编码
+// 失败时打印第一处不一致并返回非 0（ctest 运行）
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "infrastructure/cache/gorilla_codec.hpp"
+
+using namespace infrastructure::cache::gorilla;
+
+namespace {
+
+int failures = 0;
+
+// 按给定的 dod 序列生成时间戳，编码后解码，逐个比对
+void checkTimestamps(const char* name, int64_t first, const std::vector<int64_t>& dods) {
+    std::vector<int64_t> expected;
+    int64_t ts = first;
+    int64_t delta = 0;
+    for (int64_t dod : dods) {
+        delta += dod;
+        ts += delta;
+        expected.push_back(ts);
+    }
+
+    BitWriter out;
+    TimestampEncoder encoder;
+    encoder.begin(first);
+    for (int64_t value : expected) {
+        encoder.append(out, value);
+    }
+
+    BitReader in(out.bytes());
+    TimestampDecoder decoder(first);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        const int64_t decoded = decoder.next(in);
+        if (decoded != expected[i]) {
+            std::cerr << name << ": timestamp " << i << " (dod " << dods[i] << ") decoded as " << decoded
+                      << ", expected " << expected[i] << std::endl;
+            ++failures;
+            return;
+        }
+    }
+}
+
+void checkValues(const char* name, const std::vector<double>& values) {
+    BitWriter out;
+    XorEncoder encoder;
+    for (double value : values) {
+        encoder.append(out, value);
+    }
+    BitReader in(out.bytes());
+    XorDecoder decoder;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const double decoded = decoder.next(in);
+        if (doubleBits(decoded) != doubleBits(values[i])) {
+            std::cerr << name << ": value " << i << " decoded as " << decoded << ", expected " << values[i] << std::endl;
+            ++failures;
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    const int64_t start = 1705228245;   // 2024-01-14 10:30:45
+
+    // 每个分段的上下边界和越过边界的第一个值，正负各一次（每个 dod 后面跟一个 0，确认误差不会传下去）
+    const std::vector<int64_t> boundaries = {
+        0, 1, -1, 63, -64, 64, -65,             // 7 位
+        255, -256, 256, -257,                   // 9 位
+        2047, -2048, 2048, -2049,               // 12 位
+        100000, -100000, 2147483647, -2147483647 - 1,  // 32 位兜底
+    };
+    for (int64_t dod : boundaries) {
+        checkTimestamps("boundary", start, {5, dod, 0, 0});
+    }
+
+    // 复现：5 秒采样后隔 69 秒（dod = 64）
+    checkTimestamps("interval change", start, {5, 0, 0, 64, -64, 0});
+
+    // 长序列：各种间隔混在一起
+    std::vector<int64_t> mixed;
+    for (int i = 0; i < 2000; ++i) {
+        const int64_t pattern[] = {0, 0, 1, -1, 64, -64, 256, -256, 2048, -2048, 5000, -5000};
+        mixed.push_back(pattern[i % 12]);
+    }
+    checkTimestamps("mixed", start, mixed);
+
+    checkValues("constant", {21.5, 21.5, 21.5});
+    checkValues("varying", {21.5, 21.6, -3.25, 0.0, 1e300, -1e-300, 65535.0, 21.5});
+
+    if (failures == 0) {
+        std::cout << "gorilla codec round trip ok" << std::endl;
+    }
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,53 @@
+// 健康状态探针：读取 HealthMonitor 发布的二进制状态块（health.statusBlock）
+// 用法：AquaHealthProbe <status-block> [--max-age 秒] [--quiet]
+//   --max-age  状态块超过这么久没有发布视为进程失活（默认 30 秒）
+//   --quiet    不打印组件列表，只返回退出码
+// 退出码：0 全部健康，1 有组件异常或状态块过期，2 无法读取
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "monitoring/health_status_block.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <status-block> [--max-age seconds] [--quiet]" << std::endl;
+        return 2;
+    }
+
+    long maxAge = 30;
+    bool quiet = false;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-age") == 0 && i + 1 < argc) {
+            maxAge = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        }
+    }
+
+    std::vector<monitoring::status_block::Status> components;
+    int64_t publishedAt = 0;
+    std::string error;
+    if (!monitoring::status_block::read(argv[1], components, publishedAt, error)) {
+        std::cerr << "Failed to read status block: " << error << std::endl;
+        return 2;
+    }
+
+    const int64_t age = static_cast<int64_t>(std::time(nullptr)) - publishedAt;
+    bool healthy = age <= maxAge;
+    for (const auto& component : components) {
+        healthy = healthy && component.status == 1;
+        if (!quiet) {
+            std::cout << (component.status == 1 ? "OK   " : "FAIL ") << component.name
+                      << "  (" << component.updatedAt << ") " << component.detail << '\n';
+        }
+    }
+    if (!quiet) {
+        std::cout << "published " << age << "s ago" << (age > maxAge ? " (stale)" : "") << std::endl;
+    }
+    return healthy ? EXIT_SUCCESS : 1;
+}
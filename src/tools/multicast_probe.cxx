@@ -0,0 +1,65 @@
+// 组播接收探针：加入一路视频流的组播组，重组整帧并按需发 NACK 要重传，每秒打印统计
+// 用法：AquaMulticastProbe <group:port> [--interface 地址] [--duration 秒] [--loss 比例]
+//   group:port   订阅端声明 "ROLE:SUBSCRIBER <流名> MULTICAST" 后收到的地址
+//   --interface  加入组播组的网卡地址（回环测试用 127.0.0.1）
+//   --loss       随机丢掉这个比例的报文（如 0.05），验证 NACK 重传
+// 退出码：0 收到过完整的帧，1 没有收到，2 参数错误或无法加入组播组
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "services/transport/video_multicast.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2 || std::strchr(argv[1], ':') == nullptr) {
+        std::cerr << "Usage: " << argv[0] << " <group:port> [--interface address] [--duration seconds] [--loss ratio]" << std::endl;
+        return 2;
+    }
+    const std::string target = argv[1];
+    const auto colon = target.rfind(':');
+    const std::string group = target.substr(0, colon);
+    const auto port = static_cast<uint16_t>(std::strtoul(target.c_str() + colon + 1, nullptr, 10));
+
+    std::string interfaceAddress;
+    long duration = 0;      // 0 表示一直运行
+    double loss = 0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--interface") == 0) {
+            interfaceAddress = argv[i + 1];
+        } else if (std::strcmp(argv[i], "--duration") == 0) {
+            duration = std::strtol(argv[i + 1], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--loss") == 0) {
+            loss = std::strtod(argv[i + 1], nullptr);
+        }
+    }
+
+    VideoMulticastReceiver receiver;
+    std::string error;
+    if (!receiver.open(group, port, interfaceAddress, error)) {
+        std::cerr << "Failed to join " << target << ": " << error << std::endl;
+        return 2;
+    }
+    receiver.simulateLoss(loss);
+
+    const auto started = std::chrono::steady_clock::now();
+    auto nextReport = started + std::chrono::seconds(1);
+    while (duration == 0 || std::chrono::steady_clock::now() - started < std::chrono::seconds(duration)) {
+        receiver.poll(100, [](const uint8_t*, std::size_t) {});
+        if (std::chrono::steady_clock::now() >= nextReport) {
+            nextReport += std::chrono::seconds(1);
+            const auto& stats = receiver.stats();
+            std::printf("frames %llu (key %llu)  %.1f MB  datagrams %llu  nack %llu/%llu seq  lost %llu  dup %llu  simulated drops %llu\n",
+                        static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.keyframes),
+                        static_cast<double>(stats.bytes) / 1e6, static_cast<unsigned long long>(stats.datagrams),
+                        static_cast<unsigned long long>(stats.nacksSent), static_cast<unsigned long long>(stats.requested),
+                        static_cast<unsigned long long>(stats.lost), static_cast<unsigned long long>(stats.duplicates),
+                        static_cast<unsigned long long>(stats.simulatedDrops));
+            std::fflush(stdout);
+        }
+    }
+    return receiver.stats().frames > 0 ? EXIT_SUCCESS : 1;
+}
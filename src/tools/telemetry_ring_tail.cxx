@@ -0,0 +1,67 @@
+// 遥测环读取工具：只读映射 TelemetryPublisher 的共享内存环（publisher.shmRing），逐帧打印，也是 telemetry_ring::Reader 的用法示例
+// 用法：AquaRingTail <ring> [--count 帧数] [--from-latest] [--quiet]
+//   --count        收到这么多帧后退出（默认一直读）
+//   --from-latest  先输出环里的最后一帧，否则只输出之后发布的帧
+//   --quiet        不打印帧内容，退出时只打印统计
+// 退出码：0 正常，1 写端停止（启动时还没运行的写端会一直等），2 无法打开
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "transport/telemetry_ring.hpp"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <ring> [--count frames] [--from-latest] [--quiet]" << std::endl;
+        return 2;
+    }
+
+    unsigned long count = 0;
+    bool fromLatest = false;
+    bool quiet = false;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--from-latest") == 0) {
+            fromLatest = true;
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        }
+    }
+
+    telemetry_ring::Reader reader;
+    std::string error;
+    if (!reader.open(argv[1], fromLatest, error)) {
+        std::cerr << "Failed to open ring: " << error << std::endl;
+        return 2;
+    }
+
+    // 写端还没启动时先等着；启动过再停止才退出
+    int status = EXIT_SUCCESS;
+    bool sawWriter = false;
+    while (count == 0 || reader.stats().frames < count) {
+        reader.poll([&](uint64_t sequence, const uint8_t* payload, std::size_t length) {
+            if (!quiet) {
+                std::cout << sequence << ' ';
+                std::cout.write(reinterpret_cast<const char*>(payload), static_cast<std::streamsize>(length));
+                std::cout << '\n';
+            }
+        });
+        if (count != 0 && reader.stats().frames >= count) {
+            break;
+        }
+        sawWriter = sawWriter || reader.active();
+        if (sawWriter && !reader.active()) {
+            std::cerr << "Writer stopped" << std::endl;
+            status = 1;
+            break;
+        }
+        reader.wait(1000);
+    }
+
+    const auto& stats = reader.stats();
+    std::cout << "frames " << stats.frames << ", lost " << stats.lost << ", overruns " << stats.overruns << std::endl;
+    return status;
+}
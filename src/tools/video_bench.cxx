@@ -0,0 +1,423 @@
+// 视频中转压测：进程内启动 VideoManager（或用 --connect 压已在运行的服务），
+// N 个合成推流端按码率和帧大小在回环上推分帧视频，M 个订阅端接收并统计
+// 用法：AquaVideoBench [--publishers N] [--subscribers M] [--bitrate kbps] [--frame-bytes B] [--gop 帧数]
+//                      [--duration 秒] [--port P] [--connect host:port]
+//                      [--relay-workers W] [--direct] [--drop-policy 策略] [--queue 包数] [--pending-kb KB]
+//                      [--transport hpsocket|epoll]
+// 比较传输后端：同样的参数分别用 --transport hpsocket 和 --transport epoll 各跑一次，对比延迟分位数和中转 CPU
+// 推流端：每路一个连接 "ROLE:PUBLISHER bench<i> FRAMED"，帧头带采集时刻（flags bit2），负载开头 8 字节为帧序号
+// 订阅端：按顺序轮流订阅各路流，用帧序号的空洞统计丢帧，用采集时刻统计延迟
+// 报告：中转吞吐、每个订阅端的延迟分位数和丢帧数、每路流的服务端 CPU（进程 CPU 减去压测线程自身）、内存峰值
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/configuration.hpp"
+#include "monitoring/metrics.hpp"
+#include "services/transport/video_framing.hpp"
+#include "services/transport/video_manager.hpp"
+#include "services/transport/video_recorder.hpp"
+
+namespace {
+
+struct Options {
+    std::size_t publishers = 4;
+    std::size_t subscribers = 16;
+    uint64_t bitrateKbps = 4000;        // 每路码率
+    std::size_t frameBytes = 16 * 1024; // 帧负载大小
+    uint64_t gop = 30;                  // 关键帧间隔（帧）
+    uint64_t durationSeconds = 10;
+    uint16_t port = 16000;
+    std::string connectHost;            // 非空时压外部服务
+    core::VideoConfig video;
+};
+
+struct SubscriberResult {
+    std::size_t stream{0};
+    uint64_t frames{0};
+    uint64_t bytes{0};
+    uint64_t lost{0};                   // 帧序号空洞
+    monitoring::Histogram latency;      // 采集时刻 → 收到（纳秒）
+    bool connected{false};
+};
+
+std::atomic<bool> g_running{true};
+std::atomic<uint64_t> g_clientCpuNs{0};
+
+int64_t unixMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// 压测线程自己用掉的 CPU，最后从进程 CPU 里减掉
+void addThreadCpu() {
+    timespec ts{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        g_clientCpuNs.fetch_add(static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec));
+    }
+}
+
+int connectTo(const std::string& host, uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* ai = result; ai != nullptr && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(result);
+    if (fd >= 0) {
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const uint8_t* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+void publisherThread(const Options& options, std::size_t index, std::atomic<uint64_t>& sentFrames,
+                     std::atomic<uint64_t>& sentBytes) {
+    const int fd = connectTo(options.connectHost, options.port);
+    if (fd < 0) {
+        std::cerr << "publisher " << index << ": connect failed" << std::endl;
+        return;
+    }
+    const std::string role = "ROLE:PUBLISHER bench" + std::to_string(index) + " FRAMED\n";
+    sendAll(fd, reinterpret_cast<const uint8_t*>(role.data()), role.size());
+
+    // 码率换算成帧间隔
+    const uint64_t frameBits = static_cast<uint64_t>(options.frameBytes) * 8;
+    const auto interval = std::chrono::nanoseconds(frameBits * 1000000000ull / std::max<uint64_t>(options.bitrateKbps * 1000, 1));
+    std::vector<uint8_t> frame(video_framing::kHeaderBytes + options.frameBytes, 0x5a);
+
+    auto next = std::chrono::steady_clock::now();
+    for (uint64_t seq = 0; g_running.load(std::memory_order_relaxed); ++seq) {
+        std::this_thread::sleep_until(next);
+        next += interval;
+
+        video_framing::FrameHeader header;
+        header.flags = video_framing::kFlagWallclock | (seq % options.gop == 0 ? video_framing::kFlagKeyframe : 0);
+        header.timestamp = static_cast<uint64_t>(unixMicros());
+        header.length = static_cast<uint32_t>(options.frameBytes);
+        video_framing::encodeHeader(header, frame.data());
+        if (options.frameBytes >= 8) {
+            video_recording::writeU64(frame.data() + video_framing::kHeaderBytes, seq);
+        }
+        if (!sendAll(fd, frame.data(), frame.size())) {
+            std::cerr << "publisher " << index << ": send failed" << std::endl;
+            break;
+        }
+        sentFrames.fetch_add(1, std::memory_order_relaxed);
+        sentBytes.fetch_add(frame.size(), std::memory_order_relaxed);
+    }
+    close(fd);
+    addThreadCpu();
+}
+
+void subscriberThread(const Options& options, SubscriberResult& result) {
+    const int fd = connectTo(options.connectHost, options.port);
+    if (fd < 0) {
+        std::cerr << "subscriber: connect failed" << std::endl;
+        return;
+    }
+    const std::string role = "ROLE:SUBSCRIBER bench" + std::to_string(result.stream) + " FRAMED\n";
+    sendAll(fd, reinterpret_cast<const uint8_t*>(role.data()), role.size());
+    result.connected = true;
+
+    // 收到超时后检查停止标志
+    timeval timeout{0, 200 * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::vector<uint8_t> buffer(std::max<std::size_t>(options.frameBytes * 4, 256 * 1024));
+    std::size_t filled = 0;
+    bool sawStreams = false;
+    bool haveSeq = false;
+    uint64_t lastSeq = 0;
+    while (g_running.load(std::memory_order_relaxed)) {
+        if (filled == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        const ssize_t n = recv(fd, buffer.data() + filled, buffer.size() - filled, 0);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        filled += static_cast<std::size_t>(n);
+        const int64_t nowUs = unixMicros();
+
+        std::size_t pos = 0;
+        if (!sawStreams) {
+            // 先是一行 "STREAMS name=number\n"
+            const auto* end = static_cast<const uint8_t*>(std::memchr(buffer.data(), '\n', filled));
+            if (end == nullptr) {
+                continue;
+            }
+            pos = static_cast<std::size_t>(end - buffer.data()) + 1;
+            sawStreams = true;
+        }
+        while (filled - pos >= video_framing::kHeaderBytes) {
+            video_framing::FrameHeader header;
+            if (!video_framing::decodeHeader(buffer.data() + pos, header)) {
+                std::cerr << "subscriber: bad frame header" << std::endl;
+                close(fd);
+                addThreadCpu();
+                return;
+            }
+            const std::size_t total = video_framing::kHeaderBytes + header.length;
+            if (filled - pos < total) {
+                break;
+            }
+            if (header.length >= 8) {
+                const uint64_t seq = video_recording::readU64(buffer.data() + pos + video_framing::kHeaderBytes);
+                if (haveSeq && seq > lastSeq + 1) {
+                    result.lost += seq - lastSeq - 1;
+                }
+                if (!haveSeq || seq > lastSeq) {
+                    lastSeq = seq;
+                }
+                haveSeq = true;
+            }
+            if (header.flags & video_framing::kFlagWallclock) {
+                const int64_t elapsedUs = nowUs - static_cast<int64_t>(header.timestamp);
+                result.latency.record(static_cast<uint64_t>(std::max<int64_t>(elapsedUs, 0)) * 1000);
+            }
+            ++result.frames;
+            result.bytes += total;
+            pos += total;
+        }
+        std::memmove(buffer.data(), buffer.data() + pos, filled - pos);
+        filled -= pos;
+    }
+    close(fd);
+    addThreadCpu();
+}
+
+uint64_t processCpuNs() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto ns = [](const timeval& tv) {
+        return static_cast<uint64_t>(tv.tv_sec) * 1000000000ull + static_cast<uint64_t>(tv.tv_usec) * 1000ull;
+    };
+    return ns(usage.ru_utime) + ns(usage.ru_stime);
+}
+
+long maxRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+double micros(uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--direct") {
+            options.video.directFanout = true;
+        } else if (!hasValue) {
+            return false;
+        } else if (arg == "--publishers") {
+            options.publishers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--subscribers") {
+            options.subscribers = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--bitrate") {
+            options.bitrateKbps = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--frame-bytes") {
+            options.frameBytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--gop") {
+            options.gop = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--duration") {
+            options.durationSeconds = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--port") {
+            options.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--connect") {
+            const std::string target = argv[++i];
+            const auto colon = target.rfind(':');
+            if (colon == std::string::npos) {
+                return false;
+            }
+            options.connectHost = target.substr(0, colon);
+            options.port = static_cast<uint16_t>(std::strtoul(target.c_str() + colon + 1, nullptr, 10));
+        } else if (arg == "--relay-workers") {
+            options.video.relayWorkers = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--drop-policy") {
+            options.video.dropPolicy = argv[++i];
+        } else if (arg == "--queue") {
+            options.video.subscriberQueuePackets = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--pending-kb") {
+            options.video.maxPendingKb = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--transport") {
+            options.video.transport = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options.publishers > 0 && options.frameBytes > 0 && options.durationSeconds > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--publishers N] [--subscribers M] [--bitrate kbps] [--frame-bytes B] [--gop frames]"
+                     " [--duration s] [--port P] [--connect host:port] [--relay-workers W] [--direct]"
+                     " [--drop-policy policy] [--queue packets] [--pending-kb KB] [--transport hpsocket|epoll]" << std::endl;
+        return 2;
+    }
+
+    // 进程内的中转服务（--connect 时不启动）
+    std::unique_ptr<VideoManager> manager;
+    if (options.connectHost.empty()) {
+        options.connectHost = "127.0.0.1";
+        manager = std::make_unique<VideoManager>(options.video);
+        if (!manager->start(options.port)) {
+            std::cerr << "Failed to start video relay on port " << options.port << std::endl;
+            return 1;
+        }
+    }
+
+    // 订阅端先连上，推流端开始后不会被 GOP 预填干扰
+    std::vector<std::unique_ptr<SubscriberResult>> results;
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < options.subscribers; ++i) {
+        results.push_back(std::make_unique<SubscriberResult>());
+        results.back()->stream = i % options.publishers;
+    }
+    for (auto& result : results) {
+        threads.emplace_back(subscriberThread, std::cref(options), std::ref(*result));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    std::atomic<uint64_t> sentFrames{0};
+    std::atomic<uint64_t> sentBytes{0};
+    const uint64_t cpuBefore = processCpuNs();
+    const auto started = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < options.publishers; ++i) {
+        threads.emplace_back(publisherThread, std::cref(options), i, std::ref(sentFrames), std::ref(sentBytes));
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.durationSeconds));
+    g_running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    const uint64_t cpuNs = processCpuNs() - cpuBefore;
+    const uint64_t clientCpuNs = g_clientCpuNs.load();
+
+    std::vector<SubscriberStats> serverStats;
+    if (manager) {
+        serverStats = manager->subscriberStats();
+        manager->stop();
+    }
+
+    // 报告
+    const double frameRate = static_cast<double>(options.bitrateKbps) * 1000.0 / (static_cast<double>(options.frameBytes) * 8.0);
+    std::printf("publishers %zu  subscribers %zu  %llu kbps/stream  %zu B/frame (%.1f fps)  %.1f s%s%s\n",
+                options.publishers, options.subscribers, static_cast<unsigned long long>(options.bitrateKbps),
+                options.frameBytes, frameRate, seconds,
+                manager ? (options.video.directFanout ? "  direct fan-out" : "") : "  (external server)",
+                manager ? ("  transport " + options.video.transport).c_str() : "");
+    std::printf("published %llu frames, %.1f Mbit/s\n", static_cast<unsigned long long>(sentFrames.load()),
+                static_cast<double>(sentBytes.load()) * 8.0 / seconds / 1e6);
+
+    uint64_t totalFrames = 0;
+    uint64_t totalBytes = 0;
+    uint64_t totalLost = 0;
+    monitoring::HistogramSnapshot overall;     // 各订阅端分桶合并
+    std::printf("\n%-4s %-8s %10s %10s %8s %10s %10s %10s %10s\n",
+                "sub", "stream", "frames", "Mbit/s", "lost", "p50 us", "p90 us", "p99 us", "max us");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = *results[i];
+        const auto snapshot = result.latency.snapshot();
+        std::printf("%-4zu bench%-3zu %10llu %10.1f %8llu %10.1f %10.1f %10.1f %10.1f%s\n", i, result.stream,
+                    static_cast<unsigned long long>(result.frames), static_cast<double>(result.bytes) * 8.0 / seconds / 1e6,
+                    static_cast<unsigned long long>(result.lost), micros(snapshot.percentile(0.5)),
+                    micros(snapshot.percentile(0.9)), micros(snapshot.percentile(0.99)), micros(snapshot.max),
+                    result.connected ? "" : "  (not connected)");
+        totalFrames += result.frames;
+        totalBytes += result.bytes;
+        totalLost += result.lost;
+
+        overall.buckets.resize(snapshot.buckets.size());
+        for (std::size_t b = 0; b < snapshot.buckets.size(); ++b) {
+            overall.buckets[b] += snapshot.buckets[b];
+        }
+        overall.count += snapshot.count;
+        overall.sum += snapshot.sum;
+        overall.max = std::max(overall.max, snapshot.max);
+    }
+    std::printf("\nrelay throughput  %llu frames  %.0f frames/s  %.1f Mbit/s\n", static_cast<unsigned long long>(totalFrames),
+                static_cast<double>(totalFrames) / seconds, static_cast<double>(totalBytes) * 8.0 / seconds / 1e6);
+    std::printf("latency           p50 %.1f us  p90 %.1f us  p99 %.1f us  p99.9 %.1f us\n", micros(overall.percentile(0.5)),
+                micros(overall.percentile(0.9)), micros(overall.percentile(0.99)), micros(overall.percentile(0.999)));
+
+    uint64_t serverDropped = 0;
+    for (const auto& stats : serverStats) {
+        serverDropped += stats.dropped;
+    }
+    std::printf("drops             %llu frames missing at subscribers", static_cast<unsigned long long>(totalLost));
+    if (manager) {
+        std::printf(", %llu dropped by relay queues", static_cast<unsigned long long>(serverDropped));
+    }
+    std::printf("\n");
+
+    if (manager) {
+        // 进程 CPU 扣掉压测线程自身，剩下的算中转服务的
+        const uint64_t relayCpuNs = cpuNs > clientCpuNs ? cpuNs - clientCpuNs : 0;
+        const double cores = static_cast<double>(relayCpuNs) / 1e9 / seconds;
+        std::printf("relay cpu         %.1f%% of a core, %.2f%% per stream\n", cores * 100.0,
+                    cores * 100.0 / static_cast<double>(options.publishers));
+    }
+    std::printf("memory high-water %ld KB RSS (benchmark process)\n", maxRssKb());
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+// 遥测连接的发送优先级：每个连接两条通道
+//   控制通道：命令应答和实时帧，到了就交给传输层
+//   批量通道：历史帧和新连接的快照，按块（chunkBytes）交给传输层，且只在传输层待发字节低于一块时才交下一块，
+//             其余留在这里；发送完成回调（onSend）再调 pump() 继续
+// 交给传输层的字节就排死了顺序，所以批量数据在传输层里最多积压一块，应答不会排在整串快照后面
+// （epoll 后端配合 TCP_NOTSENT_LOWAT，否则直接写进内核的数据不计入 pendingBytes，几 MB 的内核缓冲区照样排在应答前面）
+// 帧格式（长度前缀帧和换行结尾的应答混在同一个流里）不允许在帧中间插入，应答只能插在批量帧之间：
+// 一个批量帧开始交付后先把它交完，再看控制通道
+// 批量通道有上限（maxBulkFrames），满了丢最旧的、还没开始交付的帧
+// 控制通道也有上限（maxControlFrames）：应答和实时帧不能丢，积压到上限说明客户端不读了，断开连接（之后的帧直接丢弃）
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "network/tcp_server.hpp"
+
+enum class SendLane {
+    Control,    // 命令应答、实时帧
+    Bulk,       // 历史帧、快照
+};
+
+class OutboundLanes {
+public:
+    using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+    // 实际的发送（经过 TelemetryPublisher 的发送完成跟踪）；traceId 只在一帧的最后一块上传
+    using SendFn = std::function<bool(const uint8_t* data, std::size_t length, uint64_t traceId)>;
+
+    // push 的结果
+    struct PushResult {
+        std::size_t dropped{0};     // 因批量通道满丢弃的帧数
+        bool overflowed{false};     // 这次入队使控制通道超限，已断开连接（每个连接只报一次）
+    };
+
+    OutboundLanes(network::ConnectionId id, network::TcpServer& server, SendFn send, std::size_t chunkBytes, std::size_t maxBulkFrames,
+                  std::size_t maxControlFrames)
+        : id_(id)
+        , server_(server)
+        , send_(std::move(send))
+        , chunkBytes_(chunkBytes != 0 ? chunkBytes : 16 * 1024)
+        , maxBulkFrames_(maxBulkFrames != 0 ? maxBulkFrames : 1)
+        , maxControlFrames_(maxControlFrames != 0 ? maxControlFrames : 1) {}
+
+    OutboundLanes(const OutboundLanes&) = delete;
+    OutboundLanes& operator=(const OutboundLanes&) = delete;
+
+    // 入队并尽量发出
+    PushResult push(SendLane lane, Buffer data, uint64_t traceId = 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PushResult result;
+        if (overflowed_) {
+            return result;  // 已经在断开，等 onClose
+        }
+        if (lane == SendLane::Control) {
+            if (control_.size() >= maxControlFrames_) {
+                // disconnect 是异步的（随后 onClose），持锁调用没问题
+                overflowed_ = true;
+                control_.clear();
+                bulk_.clear();
+                server_.disconnect(id_);
+                result.overflowed = true;
+                return result;
+            }
+            control_.push_back(Item{std::move(data), 0, traceId});
+        } else {
+            // 队首的帧可能已经交了一部分，不能丢
+            while (bulk_.size() >= maxBulkFrames_ && bulk_.size() > (bulkStarted() ? 1u : 0u)) {
+                bulk_.erase(bulk_.begin() + (bulkStarted() ? 1 : 0));
+                ++result.dropped;
+            }
+            bulk_.push_back(Item{std::move(data), 0, traceId});
+        }
+        pumpLocked();
+        return result;
+    }
+
+    // 传输层发送完成后调用，继续交付批量通道
+    void pump() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pumpLocked();
+    }
+
+private:
+    struct Item {
+        Buffer data;
+        std::size_t offset;     // 已交给传输层的字节数
+        uint64_t traceId;
+    };
+
+    bool bulkStarted() const {
+        return !bulk_.empty() && bulk_.front().offset != 0;
+    }
+
+    bool bulkAllowed() const {
+        return server_.pendingBytes(id_) < chunkBytes_;
+    }
+
+    // 传输层不会在 send() 里同步回调，持锁发送是安全的，也保证了同一连接上的交付顺序
+    void pumpLocked() {
+        while (true) {
+            // 交了一半的批量帧先交完（帧中间不能插应答）
+            if (bulkStarted()) {
+                if (!bulkAllowed() || !sendChunk(bulk_.front())) {
+                    return;
+                }
+                continue;
+            }
+            if (!control_.empty()) {
+                const Item item = std::move(control_.front());
+                control_.pop_front();
+                send_(item.data->data(), item.data->size(), item.traceId);
+                continue;
+            }
+            if (bulk_.empty() || !bulkAllowed() || !sendChunk(bulk_.front())) {
+                return;
+            }
+        }
+    }
+
+    // 交一块；整帧交完出队
+    bool sendChunk(Item& item) {
+        const std::size_t remaining = item.data->size() - item.offset;
+        const std::size_t length = remaining < chunkBytes_ ? remaining : chunkBytes_;
+        const bool last = length == remaining;
+        if (!send_(item.data->data() + item.offset, length, last ? item.traceId : 0)) {
+            return false;   // 连接已断，等 onClose
+        }
+        item.offset += length;
+        if (last) {
+            bulk_.pop_front();
+        }
+        return true;
+    }
+
+    const network::ConnectionId id_;
+    network::TcpServer& server_;
+    const SendFn send_;
+    const std::size_t chunkBytes_;
+    const std::size_t maxBulkFrames_;
+    const std::size_t maxControlFrames_;
+
+    std::mutex mutex_;
+    bool overflowed_{false};
+    std::deque<Item> control_;
+    std::deque<Item> bulk_;
+};
@@ -11,7 +11,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include "core/logger.hpp"
 #include "infrastructure/sensors/sensor_data.hpp"
+#include "monitoring/tracing.hpp"
 
 class DeviceCommandRouter 
 {
@@ -27,7 +29,7 @@ public:
                         DiagnosticProvider diagnostics, // 诊断信息提供者
                         ReloadCallback reloadCallback)  // 配置重载回调
         : sensorGateway_(gateway)
-        , monitor_(monitor)
+        , health_(monitor.registerComponent("command_router"))
         , diagnosticsProvider_(std::move(diagnostics))
         , reloadCallback_(std::move(reloadCallback)) {}
 
@@ -106,11 +108,19 @@ private:
                 handleDirectWrite(msg);
                 return R"({"status":"ok","message":"register write queued"})";
             }
+            else if (type == "log_level")
+            {
+                return handleLogLevel(msg).dump();
+            }
+            else if (type == "trace")
+            {
+                return handleTrace(msg).dump();
+            }
             return R"({"status":"error","message":"unknown command"})";
         } 
         catch (const std::exception& ex) 
         {
-            monitor_.update("command_router", false, ex.what());
+            health_.update(false, ex.what());
             return R"({"status":"error","message":"invalid payload"})";
         }
     }
@@ -128,7 +138,7 @@ private:
         sensorGateway_.writeRegister(11, static_cast<uint16_t>(rain * 100));
         sensorGateway_.writeRegister(12, static_cast<uint16_t>(temp * 100));
         sensorGateway_.writeRegister(13, static_cast<uint16_t>(light * 100));
-        monitor_.update("command_router", true, "threshold updated");
+        health_.update(true, "threshold updated");
     }
 
     // 处理 light_control 命令
@@ -136,7 +146,7 @@ private:
     void handleLightControl(const nlohmann::json& msg) {
         double light = msg.value("light", 0.0);
         sensorGateway_.writeRegister(14, static_cast<uint16_t>(light * 100));
-        monitor_.update("command_router", true, "light control updated");
+        health_.update(true, "light control updated");
     }
 
     // 处理 mode_select 命令
@@ -144,7 +154,7 @@ private:
     void handleModeSelect(const nlohmann::json& msg) {
         int mode = msg.value("mode", 0);
         sensorGateway_.writeRegister(15, static_cast<uint16_t>(mode));
-        monitor_.update("command_router", true, "mode updated");
+        health_.update(true, "mode updated");
     }
 
     // 处理 write_register 命令
@@ -157,8 +167,81 @@ private:
         }
     }
 
+    // 处理 log_level 命令（运行时调整日志级别，不需要重启）
+    // 命令格式: {"type":"log_level","component":"redis_client","level":"debug"}
+    // 省略 component（或为 "*"）时修改全局级别；level 为 "default" 时该组件恢复为跟随全局级别，"*" 则清除所有组件的覆盖
+    // 只接受已经登记的组件（打过日志或在配置里设置过），客户端不能拿随意的名字占满组件表
+    nlohmann::json handleLogLevel(const nlohmann::json& msg) {
+        auto& logger = core::Logger::instance();
+        const std::string component = msg.value("component", "");
+        const std::string levelText = msg.value("level", "");
+        const bool global = component.empty() || component == "*";
+
+        if (!global && !logger.hasComponent(component)) {
+            return {{"status", "error"}, {"message", "unknown log component"}};
+        }
+        if (!levelText.empty()) {
+            const bool reset = (levelText == "default");
+            const auto level = core::tryParseLogLevel(levelText);
+            if (!reset && !level) {
+                return {{"status", "error"}, {"message", "unknown log level"}};
+            }
+
+            if (!global) {
+                logger.setComponentLevel(component, reset ? std::nullopt : level);
+            } else if (!reset) {
+                logger.setLevel(*level);
+            } else if (component == "*") {
+                for (const auto& [name, ignored] : logger.componentLevels()) {
+                    logger.setComponentLevel(name, std::nullopt);
+                }
+            } else {
+                return {{"status", "error"}, {"message", "global level cannot be reset"}};
+            }
+            health_.update(true, "log level updated");
+        }
+
+        // 返回当前生效的级别（只带 component 不带 level 时相当于查询）
+        nlohmann::json components = nlohmann::json::object();
+        for (const auto& [name, level] : logger.componentLevels()) {
+            components[name] = levelName(level);
+        }
+        return {{"status", "ok"}, {"level", levelName(logger.level())}, {"components", components}};
+    }
+
+    // 处理 trace 命令（帧延迟追踪的开关和采样）
+    // 命令格式: {"type":"trace","enabled":true,"sampleEvery":10,"slowFrameMs":20}
+    // 各字段都可省略；事件从观测端口的 GET /trace 只读导出（遥测端口没有认证，不接受客户端给的文件路径）
+    nlohmann::json handleTrace(const nlohmann::json& msg) {
+        auto& tracer = monitoring::Tracer::instance();
+        if (msg.contains("dump")) {
+            return {{"status", "error"}, {"message", "dump is not supported, use GET /trace on the metrics port"}};
+        }
+        if (auto it = msg.find("sampleEvery"); it != msg.end()) {
+            tracer.setSampleEvery(it->get<uint32_t>());
+        }
+        if (auto it = msg.find("slowFrameMs"); it != msg.end()) {
+            tracer.setSlowFrameMs(it->get<uint32_t>());
+        }
+        if (auto it = msg.find("enabled"); it != msg.end()) {
+            tracer.setEnabled(it->get<bool>());
+        }
+
+        nlohmann::json reply{{"status", "ok"},
+                             {"enabled", tracer.enabled()},
+                             {"sampleEvery", tracer.sampleEvery()},
+                             {"slowFrameMs", tracer.slowFrameMs()},
+                             {"capacity", tracer.capacity()}};
+        health_.update(true, "trace settings updated");
+        return reply;
+    }
+
+    static const char* levelName(core::LogLevel level) {
+        return core::binlog::levelName(static_cast<uint8_t>(level));
+    }
+
     SensorGateway& sensorGateway_;  // 传感器网关引用（连接modbus，读实时数据、写数据等）
-    monitoring::HealthMonitor& monitor_;    // 健康监控引用
+    monitoring::HealthMonitor::Handle health_;    // 健康监控引用
     DiagnosticProvider diagnosticsProvider_;    // 诊断信息回调
     ReloadCallback reloadCallback_; // 配置重载回调
     std::unordered_map<uint64_t, std::string> buffers_; // TCP 粘包处理：为每个连接维护一个缓冲区
@@ -180,7 +263,7 @@ private:
 // // 4. 诊断查询
 // {"type":"diagnostics"}
 // Response: {
-//   "telemetry": {"subscribers": true},
+//   "telemetry": {"subscribers": true, "tcpClients": 1, "ringReaders": false},
 //   "pipeline": {"realtimeSeconds": 5, "historicalSeconds": 60}
 // }
 
@@ -192,6 +275,18 @@ private:
 // {"type":"write_register","address":20,"value":5000}
 // Response: {"status":"ok","message":"register write queued"}
 
+// // 7. 调整日志级别（运行时生效）
+// {"type":"log_level","component":"redis_client","level":"debug"}
+// {"type":"log_level","level":"warn"}                               // 全局级别
+// {"type":"log_level","component":"redis_client","level":"default"} // 恢复跟随全局
+// {"type":"log_level"}                                              // 查询
+// Response: {"status":"ok","level":"WARN","components":{"redis_client":"DEBUG"}}
+
+// // 8. 帧延迟追踪
+// {"type":"trace","enabled":true,"sampleEvery":10}                  // 开启，每 10 帧采样 1 帧
+// Response: {"status":"ok","enabled":true,"sampleEvery":10,"slowFrameMs":50,"capacity":16384}
+// 导出：curl http://<metrics>/trace > trace.json（chrome://tracing 打开）
+
 
 
 // 粘包分包问题
@@ -1,14 +1,22 @@
 // 管理 TCP 客户端连接，接收命令，发送遥测数据给所有连接的客户端。
-// 这个模块继承自 HPSocket 的 ServerListener，重写回调方法
+// 这个模块继承自 ServerListener，重写回调方法；底层传输后端由 publisher.transport 选择（hpsocket / epoll）
+// 配置了 publisher.localSocket 时本机客户端也可以走 Unix 域套接字（同样的帧格式和命令），按 SO_PEERCRED 校验对端
+// 每个连接的发送分两条通道（见 transport/outbound_lanes.hpp）：命令应答和实时帧优先，历史帧和快照分块交付
+// 配置了 publisher.shmRing 时，每帧还写进共享内存遥测环，供本机消费者只读映射（见 transport/telemetry_ring.hpp）
 
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <arpa/inet.h>
@@ -17,7 +25,11 @@
 #include "core/logger.hpp"
 #include "domain/telemetry_models.hpp"
 #include "monitoring/health_monitor.hpp"
+#include "monitoring/metrics.hpp"
+#include "monitoring/tracing.hpp"
+#include "transport/outbound_lanes.hpp"
 #include "transport/sensor_data_settings.hpp"
+#include "transport/telemetry_ring.hpp"
 #include "network/server_listener_tcp.hpp"
 
 class TelemetryPublisher : public ServerListener {
@@ -29,71 +41,117 @@ public:
                        monitoring::HealthMonitor& monitor)
         : config_(config)
         , router_(router)
-        , monitor_(monitor)
-        , server_(this) {   // 把 this 传给 HPSocket，用于回调
+        , health_(monitor.registerComponent("telemetry_publisher"))
+        , server_(network::makeTcpServer({config.transport, config.maxConnections, config.workerThreads, config.listenerShards,
+                                          config.notSentLowatKb * 1024, config.localSocket, config.localAllowedUids, config.localAllowedGids}, *this)) {   // 把 this 传给传输层，用于回调
+        // 连接表按传输层的分片分组，发布时各分片并行发送
+        setShardCount(server_ ? server_->shardCount() : 1);
+    }
+
+    // 先停传输层：它的 onClose 回调还会用到下面的成员
+    ~TelemetryPublisher() override
+    {
+        server_.reset();
     }
 
     // 启动 TCP 服务器
     bool start() 
     {
-        //配置
-        server_->SetMaxConnectionCount(config_.maxConnections); //最多连接数
-        server_->SetWorkerThreadCount(config_.workerThreads);   //工作线程数
-
-        //启动监听 （0.0.0.0:5555）
-        if (!server_->Start(config_.bindAddress.c_str(), config_.port)) 
+        //启动监听 （0.0.0.0:5555），最多连接数和工作线程数在创建时已传给传输层
+        if (!server_ || !server_->start(config_.bindAddress, config_.port)) 
         {
             LOG_ERROR("telemetry_publisher", "Failed to start server on ", config_.bindAddress, ":", config_.port);
             return false;
         }
-        monitor_.update("telemetry_publisher", true, "Server listening");
-        LOG_INFO("telemetry_publisher", "Listening on ", config_.bindAddress, ":", config_.port);
+        health_.update(true, "Server listening");
+        LOG_INFO("telemetry_publisher", "Listening on ", config_.bindAddress, ":", config_.port, " (", server_->backend(), ")");
+
+        // 共享内存环打不开不影响 TCP 发布
+        if (!config_.shmRing.empty()) {
+            std::string error;
+            std::lock_guard<std::mutex> lock(ringMutex_);
+            if (ring_.open(config_.shmRing, static_cast<std::size_t>(config_.shmRingKb) * 1024, error)) {
+                ringOpen_.store(true, std::memory_order_relaxed);
+                LOG_INFO("telemetry_publisher", "Publishing frames to shared memory ring ", config_.shmRing);
+            } else {
+                LOG_WARN("telemetry_publisher", "Shared memory ring disabled: ", error);
+            }
+        }
         return true;
     }
 
     //停止监听
     void stop() 
     {
-        server_->Stop();
-        monitor_.update("telemetry_publisher", false, "Server stopped");
+        if (server_) {
+            server_->stop();
+        }
+        {
+            std::lock_guard<std::mutex> lock(ringMutex_);
+            ringOpen_.store(false, std::memory_order_relaxed);
+            ring_.close();
+        }
+        health_.update(false, "Server stopped");
     }
 
-    // 检查是否有客户端订阅（客户端连接）
+    // 检查是否有订阅者（TCP 客户端或共享内存环的读端）
     bool hasSubscribers() const 
     {
-        return server_->GetConnectionCount() > 0;
+        return clientCount() > 0 || ringHasReaders();
+    }
+
+    // 已连接的 TCP 客户端数
+    std::size_t clientCount() const
+    {
+        return server_ ? server_->connectionCount() : 0;
     }
 
-    // 发布遥测数据给所有连接的客户端
+    // 共享内存环上有没有读端（读端打开环时持有共享 flock）
+    bool ringHasReaders() const
+    {
+        if (!ringOpen_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(ringMutex_);
+        return ring_.hasReaders();
+    }
+
+    // 发布遥测数据给所有连接的客户端和共享内存环
     void publish(const domain::TelemetryFrame& frame) 
     {
-        // 优化：没有订阅者（客户端连接）就不发
-        if (!hasSubscribers()) {
+        // 优化：没有订阅者（客户端连接或环的读端）就不编码也不发
+        const bool clients = clientCount() > 0;
+        const bool ringReaders = ringHasReaders();
+        if (!clients && !ringReaders) {
             return;
         }
 
-        // 序列化 frame 为 JSON
-        auto payload = domain::toJson(frame).dump();    //dump：json转成字符串（里面的参数，比如有时候会传4，表示缩进空格数，方便阅读）
-
-        // 构造网络数据包：[4字节json长度][JSON内容]
-        std::vector<uint8_t> buffer(sizeof(uint32_t) + payload.size());
-
-        // 网络字节序（大端）：高字节在前
-        uint32_t len = static_cast<uint32_t>(payload.size());
-        uint32_t netLen = htonl(len);
+        // 广播是投递到各分片线程异步做的，耗时记到最后一个分片交付完（见 broadcast）
+        const auto start = std::chrono::steady_clock::now();
 
-        // 复制长度前缀到缓冲区前 4 个字节
-        std::memcpy(buffer.data(), &netLen, sizeof(uint32_t));
+        auto shared = encode(frame);
 
-        // 复制 JSON 数据到缓冲区后续位置
-        std::memcpy(buffer.data() + sizeof(uint32_t), payload.data(), payload.size());
+        // 环里放不带长度前缀的 JSON（记录头里有长度）
+        if (ringReaders) {
+            std::lock_guard<std::mutex> lock(ringMutex_);
+            if (ring_.publish(shared->data() + sizeof(uint32_t), shared->size() - sizeof(uint32_t)) != 0) {
+                ringFrames_.inc();
+            } else if (ring_.isOpen()) {
+                ringDropped_.inc();
+                LOG_WARN("telemetry_publisher", "Frame of ", shared->size(), " bytes exceeds shared memory ring limit ", ring_.maxPayload());
+            }
+        }
 
-        //广播给所有连接的客户端（对每个客户端执行Send回调）
-        forEachConnection([&](CONNID id) {
-            server_->Send(id, buffer.data(), static_cast<int>(buffer.size()));
-        });
+        // 实时帧走控制通道，历史帧和快照走批量通道
+        if (clients) {
+            const bool realtime = frame.channel == domain::TelemetryChannel::Realtime && !frame.snapshot;
+            broadcast(shared, realtime ? SendLane::Control : SendLane::Bulk, start);
+        } else {
+            publishLatency_.recordSince(start);
+        }
+        framesPublished_.inc();
 
-        monitor_.update("telemetry_publisher", true, "Frame delivered to clients");
+        health_.update(true, "Frame delivered to clients");
     }
 
     // 设置快照提供者（新客户端连接时发送历史快照）
@@ -103,51 +161,188 @@ public:
     }
 
 protected:
-    // HPSocket 回调：新客户端连接
-    EnHandleResult OnAccept(ITcpServer* pSender, CONNID dwConnID, UINT_PTR soClient) override 
+    // 传输层回调：新客户端连接
+    network::HandleResult onAccept(network::TcpServer& pSender, network::ConnectionId dwConnID) override 
     {
+        // 发送通道要在连接加入连接数组（广播能看到它）之前建好
+        {
+            auto lanes = std::make_shared<OutboundLanes>(
+                dwConnID, pSender,
+                [this, dwConnID](const uint8_t* data, std::size_t length, uint64_t traceId) {
+                    return send(dwConnID, data, length, traceId);
+                },
+                static_cast<std::size_t>(config_.bulkChunkKb) * 1024, config_.bulkQueueFrames, config_.controlQueueFrames);
+            std::unique_lock<std::shared_mutex> lock(lanesMutex_);
+            lanes_[dwConnID] = std::move(lanes);
+        }
+
         // 先调用父类的处理（把连接加入连接数组，更新最后连接id）
-        auto result = ServerListener::OnAccept(pSender, dwConnID, soClient);
-        monitor_.update("telemetry_publisher", true, "Client connected: " + std::to_string(dwConnID));
+        auto result = ServerListener::onAccept(pSender, dwConnID);
+        connections_.add(1);
+        health_.update(true, "Client connected: " + std::to_string(dwConnID));
 
-        // 新客户端连接上来时，发送历史快照
+        // 新客户端连接上来时，发送历史快照（只走 TCP，环上的读端自己从最后一帧开始读）
         if (snapshotProvider_) 
         {
             // 获取所有历史数据
             for (const auto& frame : snapshotProvider_()) 
             {
-                publish(frame); //发送给所有连接的客户端
+                broadcast(encode(frame), SendLane::Bulk); //发送给所有连接的客户端
             }
         }
         return result;
     }
 
-    // HPSocket 回调：客户端断开连接
-    EnHandleResult OnClose(ITcpServer* pSender, CONNID dwConnID, EnSocketOperation op, int errorCode) override 
+    // 传输层回调：客户端断开连接
+    void onClose(network::TcpServer& pSender, network::ConnectionId dwConnID, int errorCode) override 
     {
-        monitor_.update("telemetry_publisher", true, "Client disconnected: " + std::to_string(dwConnID));
-        return ServerListener::OnClose(pSender, dwConnID, op, errorCode);
+        health_.update(true, "Client disconnected: " + std::to_string(dwConnID));
+        connections_.add(-1);
+        sendTracker_.onClosed(static_cast<uint64_t>(dwConnID));
+        ServerListener::onClose(pSender, dwConnID, errorCode);
+        std::unique_lock<std::shared_mutex> lock(lanesMutex_);
+        lanes_.erase(dwConnID);
     }
 
-    // HPSocket 回调：接收到数据
-    EnHandleResult OnReceive(ITcpServer* pSender, CONNID dwConnID, const BYTE* pData, int iLength) override 
+    // 传输层回调：接收到数据
+    network::HandleResult onReceive(network::TcpServer& pSender, network::ConnectionId dwConnID, const uint8_t* pData, std::size_t iLength) override 
     {
         // 转换为字符串
         std::string chunk(reinterpret_cast<const char*>(pData), iLength);
 
         // 委托给命令路由器处理（解析包，写入寄存器）
         router_.feed(static_cast<uint64_t>(dwConnID), chunk, [&](const std::string& reply) {
-            // 发送响应（添加 \n 作为分隔符）
+            // 发送响应（添加 \n 作为分隔符），走控制通道，不排在快照后面
             auto payload = reply + "\n";
-            pSender->Send(dwConnID, reinterpret_cast<const BYTE*>(payload.data()), static_cast<int>(payload.size()));
+            if (auto lanes = lanesOf(dwConnID)) {
+                onPushed(dwConnID, lanes->push(SendLane::Control, std::make_shared<const std::vector<uint8_t>>(payload.begin(), payload.end())));
+            }
         });
-        return HR_OK;
+        return network::HandleResult::Ok;
+    }
+
+    // 传输层回调：数据已写入内核（用于追踪帧的发送完成时间）
+    void onSend(network::TcpServer& pSender, network::ConnectionId dwConnID, std::size_t iLength) override
+    {
+        sendTracker_.onSent(static_cast<uint64_t>(dwConnID), iLength);
+
+        // 传输层积压下去了，继续交付批量通道
+        if (auto lanes = lanesOf(dwConnID)) {
+            lanes->pump();
+        }
     }
 
 private:
+    // 编码成网络数据包：[4字节json长度][JSON内容]
+    static std::shared_ptr<const std::vector<uint8_t>> encode(const domain::TelemetryFrame& frame)
+    {
+        std::vector<uint8_t> buffer;
+        {
+            monitoring::TraceSpan span("encode");
+
+            // 序列化 frame 为 JSON
+            auto payload = domain::toJson(frame).dump();    //dump：json转成字符串（里面的参数，比如有时候会传4，表示缩进空格数，方便阅读）
+
+            // 构造网络数据包：[4字节json长度][JSON内容]
+            buffer.resize(sizeof(uint32_t) + payload.size());
+
+            // 网络字节序（大端）：高字节在前
+            uint32_t len = static_cast<uint32_t>(payload.size());
+            uint32_t netLen = htonl(len);
+
+            // 复制长度前缀到缓冲区前 4 个字节
+            std::memcpy(buffer.data(), &netLen, sizeof(uint32_t));
+
+            // 复制 JSON 数据到缓冲区后续位置
+            std::memcpy(buffer.data() + sizeof(uint32_t), payload.data(), payload.size());
+        }
+
+        return std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+    }
+
+    // 广播给所有连接的客户端：每个分片在自己的 I/O 线程上发，分片之间并行、不争锁
+    //（只有一个分片的后端直接在当前线程发）
+    // 带 start 时，最后一个分片把帧交给所有连接的发送通道后记一次 publishLatency_
+    void broadcast(const std::shared_ptr<const std::vector<uint8_t>>& shared, SendLane lane,
+                   std::optional<std::chrono::steady_clock::time_point> start = std::nullopt)
+    {
+        // 被追踪的帧在每个连接上记录发送完成时间（onSend 回调）
+        auto* trace = monitoring::TraceScope::current();
+        const uint64_t traceId = (trace != nullptr && trace->trackSends()) ? trace->traceId() : 0;
+
+        const std::size_t shards = shardCount();
+        auto remaining = start ? std::make_shared<std::atomic<std::size_t>>(shards) : nullptr;
+        for (std::size_t shard = 0; shard < shards; ++shard) {
+            server_->post(shard, [this, shared, traceId, shard, lane, start, remaining] {
+                std::size_t sent = 0;
+                forEachConnection(shard, [&](network::ConnectionId id) {
+                    if (auto lanes = lanesOf(id)) {
+                        onPushed(id, lanes->push(lane, shared, traceId));
+                        ++sent;
+                    }
+                });
+                bytesPublished_.inc(shared->size() * sent);
+                if (remaining && remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    publishLatency_.recordSince(*start);
+                }
+            });
+        }
+    }
+
+    // 入队结果计数：批量通道丢帧，控制通道超限断开
+    void onPushed(network::ConnectionId id, const OutboundLanes::PushResult& result)
+    {
+        if (result.dropped != 0) {
+            bulkDropped_.inc(result.dropped);
+        }
+        if (result.overflowed) {
+            controlOverflow_.inc();
+            LOG_WARN("telemetry_publisher", "Client ", id, " is not reading: control queue exceeded ", config_.controlQueueFrames,
+                     " frames, disconnecting");
+        }
+    }
+
+    std::shared_ptr<OutboundLanes> lanesOf(network::ConnectionId id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(lanesMutex_);
+        const auto it = lanes_.find(id);
+        return it != lanes_.end() ? it->second : nullptr;
+    }
+
+    // 所有发往客户端的数据都经过这里（由各连接的 OutboundLanes 调用），保证发送完成跟踪的字节计数连续
+    bool send(network::ConnectionId id, const uint8_t* data, std::size_t length, uint64_t traceId = 0)
+    {
+        const std::size_t pending = traceId != 0 ? server_->pendingBytes(id) : 0;
+        sendTracker_.onQueued(static_cast<uint64_t>(id), length, traceId, pending);
+        return server_->send(id, data, length);
+    }
+
     core::PublisherConfig config_;
     DeviceCommandRouter& router_;   // 获取客户端发来的包，解析后写入modbus寄存器
-    monitoring::HealthMonitor& monitor_;    //健康检查
+    monitoring::HealthMonitor::Handle health_;    //健康检查
     SnapshotProvider snapshotProvider_; //std::function类型的回调函数
-    CTcpServerPtr server_;  // HPSocket 服务器对象（构造时传入监听器）
+    std::unique_ptr<network::TcpServer> server_;  // 传输层服务器对象（构造时传入回调）
+    monitoring::SendCompletionTracker sendTracker_; // 被追踪帧的发送完成
+    mutable std::mutex ringMutex_;                       // 环只能有一个写端：实时和历史线程都会 publish
+    telemetry_ring::Writer ring_;                   // 共享内存遥测环（publisher.shmRing）
+    std::atomic<bool> ringOpen_{false};
+    mutable std::shared_mutex lanesMutex_;
+    std::unordered_map<network::ConnectionId, std::shared_ptr<OutboundLanes>> lanes_;   // 每个连接的发送通道
+
+    monitoring::Histogram& publishLatency_ = monitoring::MetricsRegistry::instance().histogram(
+        "aqua_publish_seconds", "Telemetry frame time from encode until every shard has queued it to its connections");
+    monitoring::Counter& framesPublished_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_publish_frames_total", "Telemetry frames published");
+    monitoring::Counter& bytesPublished_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_publish_bytes_total", "Telemetry bytes queued to clients");
+    monitoring::Counter& bulkDropped_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_publish_bulk_dropped_total", "Historical and snapshot frames dropped because a client's bulk lane was full");
+    monitoring::Counter& controlOverflow_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_publish_control_overflow_total", "Telemetry clients disconnected because their control queue exceeded controlQueueFrames");
+    monitoring::Counter& ringFrames_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_publish_ring_frames_total", "Telemetry frames written to the shared memory ring");
+    monitoring::Counter& ringDropped_ = monitoring::MetricsRegistry::instance().counter(
+        "aqua_publish_ring_dropped_total", "Telemetry frames too large for the shared memory ring");
+    monitoring::Gauge& connections_ = monitoring::MetricsRegistry::instance().gauge(
+        "aqua_publisher_connections", "Connected telemetry clients");
 };
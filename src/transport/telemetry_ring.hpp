@@ -0,0 +1,397 @@
+// 共享内存遥测环：TelemetryPublisher 把编码好的帧（JSON，不带 TCP 的 4 字节长度前缀）写进一个 mmap 文件（建议 /dev/shm），
+// 本机的 HMI、历史库代理只读映射后直接读取：每帧零拷贝（回调拿到的是映射区里的指针），有帧可读时不需要任何系统调用
+// 单写多读，读端互不影响；写端不等读端，读端落后超过一圈会被覆盖（计入 overruns 并跳到最新帧）
+// 读端打开期间对环文件持有共享 flock（只读打开也能加，进程退出自动释放），写端用非阻塞的排他 flock 试探有没有读端
+// 布局：
+//   Header（固定 256 字节）| 数据区（capacity 字节，2 的幂）
+//   记录 = {长度 u32, 类型 u32（0 帧 / 1 填充到区尾）, 序号 u64} + 负载，按 16 字节对齐（区尾剩余总能放下填充记录头）；放不下时先写填充记录再从区首开始
+// 同步（同 Agrona 的广播缓冲区）：写端先推进 tailIntent 再写数据，写完推进 tail；读端读完后确认 tailIntent 还没追上自己
+// 唤醒：写端每次发布后 futex 计数加一并 FUTEX_WAKE；读端没有新帧时才在这个计数上 FUTEX_WAIT（只读映射也可以等待）
+// 写端重启时格式相同就沿用原来的 tail，已经映射的读端不用重新打开；写端停止时置 active = 0
+// 写端换了容量时原地重建：文件只增不减（已映射的读端不会 SIGBUS），先清 magic 再改 capacity；
+// 读端按打开时记下的容量访问，发现 magic / capacity 变了就当作写端换了，自己重新打开
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace telemetry_ring {
+
+inline constexpr uint32_t kMagic = 0x52545141;     // "AQTR"
+inline constexpr uint32_t kVersion = 1;
+inline constexpr std::size_t kHeaderBytes = 256;
+inline constexpr std::size_t kRecordHeaderBytes = 16;
+inline constexpr uint32_t kTypeFrame = 0;
+inline constexpr uint32_t kTypePadding = 1;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;                      // 数据区字节数（2 的幂）
+    alignas(64) std::atomic<uint64_t> tailIntent;   // 写端即将写到的位置（单调递增的字节数）
+    std::atomic<uint64_t> tail;             // 已发布的位置
+    std::atomic<uint64_t> latest;           // 最后一帧的起点（新读端从这里开始）
+    std::atomic<uint64_t> sequence;         // 最后一帧的序号（从 1 开始）
+    alignas(64) std::atomic<uint32_t> futex;        // 每次发布加一
+    std::atomic<uint32_t> active;           // 写端在运行
+};
+
+static_assert(sizeof(Header) <= kHeaderBytes, "ring header must fit in its reserved space");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "telemetry ring needs a lock-free 64-bit atomic");
+
+inline std::size_t alignRecord(std::size_t bytes) {
+    return (bytes + kRecordHeaderBytes - 1) & ~(kRecordHeaderBytes - 1);
+}
+
+inline uint8_t* dataOf(Header* header) {
+    return reinterpret_cast<uint8_t*>(header) + kHeaderBytes;
+}
+
+inline const uint8_t* dataOf(const Header* header) {
+    return reinterpret_cast<const uint8_t*>(header) + kHeaderBytes;
+}
+
+inline long futexCall(const std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout) {
+    // 跨进程共享，不能用 FUTEX_PRIVATE_FLAG
+    return ::syscall(SYS_futex, reinterpret_cast<const uint32_t*>(word), op, value, timeout, nullptr, 0);
+}
+
+// 写端（TelemetryPublisher 使用，只能有一个）
+class Writer {
+public:
+    Writer() = default;
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer() { close(); }
+
+    // 创建或接管 path；capacityBytes 向上取 2 的幂
+    bool open(const std::string& path, std::size_t capacityBytes, std::string& error) {
+        close();
+        std::size_t capacity = 4096;
+        while (capacity < capacityBytes) {
+            capacity <<= 1;
+        }
+        const std::size_t size = kHeaderBytes + capacity;
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        struct stat st{};
+        // 只增不减：读端可能还映射着旧的长度，截短会让它们访问到文件末尾之外（SIGBUS）
+        const bool grow = fd >= 0 && ::fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) < size;
+        if (fd < 0 || (grow && ::ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+            error = "cannot create " + path + ": " + std::strerror(errno);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return false;
+        }
+        void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            error = "cannot map " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        header_ = static_cast<Header*>(mapped);
+        size_ = size;
+        fd_ = fd;   // 留着试探读端的 flock
+
+        if (header_->magic == kMagic && header_->version == kVersion && header_->capacity == capacity) {
+            // 接着上次的位置写：上次可能停在写了一半的记录上，把 tailIntent 退回到 tail
+            header_->tailIntent.store(header_->tail.load(std::memory_order_relaxed), std::memory_order_release);
+        } else {
+            // 先让已映射的读端认不出这个环，再改容量和位置
+            header_->magic = 0;
+            std::atomic_thread_fence(std::memory_order_release);
+            header_->active.store(0, std::memory_order_relaxed);
+            header_->capacity = capacity;
+            header_->tailIntent.store(0, std::memory_order_relaxed);
+            header_->tail.store(0, std::memory_order_relaxed);
+            header_->latest.store(0, std::memory_order_relaxed);
+            header_->sequence.store(0, std::memory_order_relaxed);
+            header_->futex.store(0, std::memory_order_relaxed);
+            header_->version = kVersion;
+            std::atomic_thread_fence(std::memory_order_release);
+            header_->magic = kMagic;
+        }
+        header_->active.store(1, std::memory_order_release);
+        return true;
+    }
+
+    void close() {
+        if (header_ == nullptr) {
+            return;
+        }
+        // 文件保留：读端看到 active = 0 后自行决定等待还是退出
+        header_->active.store(0, std::memory_order_release);
+        header_->futex.fetch_add(1, std::memory_order_release);
+        futexCall(&header_->futex, FUTEX_WAKE, INT_MAX, nullptr);
+        ::munmap(header_, size_);
+        ::close(fd_);
+        header_ = nullptr;
+        size_ = 0;
+        fd_ = -1;
+    }
+
+    bool isOpen() const { return header_ != nullptr; }
+
+    // 有没有打开着的读端（试探一次排他锁，两次系统调用）
+    bool hasReaders() const {
+        if (fd_ < 0) {
+            return false;
+        }
+        if (::flock(fd_, LOCK_EX | LOCK_NB) == 0) {
+            ::flock(fd_, LOCK_UN);
+            return false;
+        }
+        return errno == EWOULDBLOCK;
+    }
+
+    // 单帧上限：数据区的四分之一（保证填充加记录总能放下，也给读端留出余量）
+    std::size_t maxPayload() const { return header_ ? header_->capacity / 4 - kRecordHeaderBytes : 0; }
+
+    // 发布一帧，返回序号（帧太大或未打开返回 0）
+    uint64_t publish(const uint8_t* payload, std::size_t length) {
+        if (header_ == nullptr || length > maxPayload()) {
+            return 0;
+        }
+        const uint64_t capacity = header_->capacity;
+        const std::size_t recordBytes = alignRecord(kRecordHeaderBytes + length);
+        uint64_t position = header_->tail.load(std::memory_order_relaxed);
+        const std::size_t offset = static_cast<std::size_t>(position & (capacity - 1));
+        const std::size_t toEnd = static_cast<std::size_t>(capacity) - offset;
+        const std::size_t padding = recordBytes > toEnd ? toEnd : 0;
+
+        // 先宣布要覆盖的范围，读端据此判断自己读到的数据是否已被改写（同 seqlock 的写端）
+        header_->tailIntent.store(position + padding + recordBytes, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint8_t* data = dataOf(header_);
+        if (padding != 0) {
+            writeRecordHeader(data + offset, static_cast<uint32_t>(padding - kRecordHeaderBytes), kTypePadding, 0);
+            position += padding;
+        }
+        const uint64_t sequence = header_->sequence.load(std::memory_order_relaxed) + 1;
+        uint8_t* record = data + (position & (capacity - 1));
+        writeRecordHeader(record, static_cast<uint32_t>(length), kTypeFrame, sequence);
+        std::memcpy(record + kRecordHeaderBytes, payload, length);
+
+        header_->latest.store(position, std::memory_order_relaxed);
+        header_->sequence.store(sequence, std::memory_order_relaxed);
+        header_->tail.store(position + recordBytes, std::memory_order_release);
+
+        // 写端每帧一次 FUTEX_WAKE（遥测帧率很低）；读端有帧可读时不进内核
+        header_->futex.fetch_add(1, std::memory_order_release);
+        futexCall(&header_->futex, FUTEX_WAKE, INT_MAX, nullptr);
+        return sequence;
+    }
+
+private:
+    static void writeRecordHeader(uint8_t* out, uint32_t length, uint32_t type, uint64_t sequence) {
+        std::memcpy(out, &length, sizeof(length));
+        std::memcpy(out + 4, &type, sizeof(type));
+        std::memcpy(out + 8, &sequence, sizeof(sequence));
+    }
+
+    Header* header_{nullptr};
+    std::size_t size_{0};
+    int fd_{-1};
+};
+
+// 读端客户端库（只读映射，可以有任意多个）
+class Reader {
+public:
+    struct Stats {
+        uint64_t frames{0};
+        uint64_t lost{0};           // 序号空洞（被覆盖没读到的帧）
+        uint64_t overruns{0};       // 落后超过一圈或回调期间数据被改写
+    };
+
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    ~Reader() { close(); }
+
+    // 映射 path；fromLatest 为 true 时先收到当前最后一帧，否则只收之后发布的帧
+    bool open(const std::string& path, bool fromLatest, std::string& error) {
+        unmap();
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "cannot open " + path;
+            return false;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < kHeaderBytes) {
+            ::close(fd);
+            error = "ring too small";
+            return false;
+        }
+        const auto size = static_cast<std::size_t>(st.st_size);
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            error = "mmap failed";
+            return false;
+        }
+        const auto* header = static_cast<const Header*>(mapped);
+        if (header->magic != kMagic || header->version != kVersion) {
+            ::munmap(mapped, size);
+            ::close(fd);
+            error = "unknown ring format";
+            return false;
+        }
+        const uint64_t capacity = header->capacity;
+        if (capacity < kRecordHeaderBytes || (capacity & (capacity - 1)) != 0 || kHeaderBytes + capacity > size) {
+            ::munmap(mapped, size);
+            ::close(fd);
+            error = "truncated ring";
+            return false;
+        }
+        ::flock(fd, LOCK_SH);   // 告诉写端有读端（写端试探时只占一瞬间）
+        header_ = header;
+        size_ = size;
+        fd_ = fd;
+        path_ = path;
+        reopenPath_.clear();
+        capacity_ = capacity;
+        cursor_ = fromLatest ? header_->latest.load(std::memory_order_acquire) : header_->tail.load(std::memory_order_acquire);
+        lastSequence_ = 0;
+        return true;
+    }
+
+    void close() {
+        unmap();
+        reopenPath_.clear();
+    }
+
+    // 写端是否在运行
+    bool active() const { return header_ != nullptr && header_->active.load(std::memory_order_acquire) != 0; }
+
+    const Stats& stats() const { return stats_; }
+
+    // 读出所有已发布的帧：fn(序号, 负载指针, 长度)，指针指向共享内存，只在回调期间有效
+    // 返回读到的帧数；不进内核
+    template <typename Fn>
+    std::size_t poll(Fn&& fn) {
+        if (header_ != nullptr && (header_->magic != kMagic || header_->capacity != capacity_)) {
+            // 写端换了容量重建了环：当作写端换了，按新的容量重新映射，从新环的末尾开始读
+            reopenPath_ = path_;
+            unmap();
+        }
+        if (header_ == nullptr) {
+            std::string error;
+            if (reopenPath_.empty() || !open(reopenPath_, false, error)) {
+                return 0;   // 重建还没完成，下次 poll 再试
+            }
+        }
+        const uint64_t capacity = capacity_;    // 只用打开时的容量，不会越过自己映射的范围
+        const uint8_t* data = dataOf(header_);
+        std::size_t count = 0;
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        if (cursor_ > tail) {
+            cursor_ = tail;     // 写端重建了环
+        }
+        while (cursor_ < tail) {
+            if (!valid(cursor_)) {
+                resync();
+                tail = header_->tail.load(std::memory_order_acquire);
+                continue;
+            }
+            const uint8_t* record = data + (cursor_ & (capacity - 1));
+            uint32_t length = 0;
+            uint32_t type = 0;
+            uint64_t sequence = 0;
+            std::memcpy(&length, record, sizeof(length));
+            std::memcpy(&type, record + 4, sizeof(type));
+            std::memcpy(&sequence, record + 8, sizeof(sequence));
+            const uint64_t next = cursor_ + alignRecord(kRecordHeaderBytes + length);
+            const uint64_t offset = cursor_ & (capacity - 1);
+            if (!valid(cursor_) || length > capacity - offset - kRecordHeaderBytes || next > tail) {
+                resync();
+                tail = header_->tail.load(std::memory_order_acquire);
+                continue;
+            }
+            if (type == kTypeFrame) {
+                if (lastSequence_ != 0 && sequence > lastSequence_ + 1) {
+                    stats_.lost += sequence - lastSequence_ - 1;
+                }
+                lastSequence_ = sequence;
+                fn(sequence, record + kRecordHeaderBytes, static_cast<std::size_t>(length));
+                ++stats_.frames;
+                ++count;
+                if (!valid(cursor_)) {
+                    ++stats_.overruns;  // 回调期间被覆盖，回调看到的数据可能不完整
+                }
+            }
+            cursor_ = next;
+        }
+        return count;
+    }
+
+    // 没有新帧时等待，最多 timeoutMs 毫秒（负数一直等）；有新帧或写端停止返回 true
+    bool wait(int timeoutMs) const {
+        if (header_ == nullptr) {
+            if (!reopenPath_.empty()) {
+                // 等写端重建完环（poll 里重新打开），不要让调用方空转
+                const int sleepMs = timeoutMs < 0 || timeoutMs > 100 ? 100 : timeoutMs;
+                timespec pause{0, static_cast<long>(sleepMs) * 1000000};
+                ::nanosleep(&pause, nullptr);
+            }
+            return false;
+        }
+        const uint32_t observed = header_->futex.load(std::memory_order_acquire);
+        if (header_->tail.load(std::memory_order_acquire) != cursor_) {
+            return true;
+        }
+        timespec timeout{timeoutMs / 1000, static_cast<long>(timeoutMs % 1000) * 1000000};
+        futexCall(&header_->futex, FUTEX_WAIT, observed, timeoutMs < 0 ? nullptr : &timeout);
+        return header_->tail.load(std::memory_order_acquire) != cursor_ || !active();
+    }
+
+private:
+    void unmap() {
+        if (header_ != nullptr) {
+            ::munmap(const_cast<Header*>(header_), size_);
+            ::close(fd_);   // 同时释放 flock
+        }
+        header_ = nullptr;
+        size_ = 0;
+        fd_ = -1;
+    }
+
+    // 从 position 开始的数据还没被写端改写
+    bool valid(uint64_t position) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return position + capacity_ > header_->tailIntent.load(std::memory_order_acquire);
+    }
+
+    // 落后超过一圈：跳到最后一帧
+    void resync() {
+        ++stats_.overruns;
+        cursor_ = header_->latest.load(std::memory_order_acquire);
+    }
+
+    const Header* header_{nullptr};
+    std::size_t size_{0};
+    int fd_{-1};
+    std::string path_;
+    std::string reopenPath_;    // 环被重建后等着重新打开的路径
+    uint64_t capacity_{0};      // 打开时的容量（写端重建环时 header 里的会变）
+    uint64_t cursor_{0};
+    uint64_t lastSequence_{0};
+    Stats stats_;
+};
+
+} // namespace telemetry_ring